@@ -111,3 +111,36 @@ void JSReportExtraMemoryCost(JSContextRef ctx, size_t size)
     APIEntryShim entryShim(exec);
     exec->globalData().heap.reportExtraMemoryCost(size);
 }
+
+COMPILE_ASSERT(static_cast<int>(kJSGCReasonAllocation) == static_cast<int>(GCReasonAllocation), JSGCReason_matches_GCReason);
+COMPILE_ASSERT(static_cast<int>(kJSGCReasonExtraMemoryCost) == static_cast<int>(GCReasonExtraMemoryCost), JSGCReason_matches_GCReason);
+COMPILE_ASSERT(static_cast<int>(kJSGCReasonExplicit) == static_cast<int>(GCReasonExplicit), JSGCReason_matches_GCReason);
+
+static JSGCReason toJSGCReason(GCReason reason)
+{
+    return static_cast<JSGCReason>(reason);
+}
+
+size_t JSGetGCEvents(JSContextRef ctx, JSGCEvent* events, size_t maxEvents)
+{
+    ExecState* exec = toJS(ctx);
+    APIEntryShim entryShim(exec);
+
+    const GCEventLog& log = exec->globalData().heap.gcEventLog();
+    if (!events)
+        return log.size();
+    return log.copyEvents(events, maxEvents, toJSGCReason);
+}
+
+void JSGetParseStatistics(JSContextRef ctx, JSParseStatistics* statistics)
+{
+    ExecState* exec = toJS(ctx);
+    APIEntryShim entryShim(exec);
+
+    const ParseStatistics& parseStatistics = exec->globalData().parseStatistics;
+    statistics->fullParses = parseStatistics.fullParses;
+    statistics->lazyReparses = parseStatistics.lazyReparses;
+    statistics->lazyReparsedCharacters = parseStatistics.lazyReparsedCharacters;
+    statistics->functionCacheHits = parseStatistics.functionCacheHits;
+    statistics->cachedFunctions = parseStatistics.cachedFunctions;
+}
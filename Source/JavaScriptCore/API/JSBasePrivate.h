@@ -45,6 +45,78 @@ region.
 */
 JS_EXPORT void JSReportExtraMemoryCost(JSContextRef ctx, size_t size) AVAILABLE_IN_WEBKIT_VERSION_4_0;
 
+/*!
+@enum JSGCReason
+@abstract What started a garbage collection.
+@constant kJSGCReasonAllocation The allocations since the previous collection used up the heap.
+@constant kJSGCReasonExtraMemoryCost Objects reported a lot of memory outside of the heap.
+@constant kJSGCReasonExplicit The collection was requested, for example by JSGarbageCollect.
+*/
+typedef enum {
+    kJSGCReasonAllocation,
+    kJSGCReasonExtraMemoryCost,
+    kJSGCReasonExplicit
+} JSGCReason;
+
+/*!
+@struct JSGCEvent
+@abstract A garbage collection of the heap of a context group.
+@field startTime When the collection started, in seconds since the epoch.
+@field markDuration How long marking took, in seconds.
+@field sweepDuration How long sweeping and releasing empty blocks took, in seconds.
+@field sizeBefore The bytes of the cells in use before the collection.
+@field sizeAfter The bytes of the cells alive after the collection.
+@field capacityBefore The bytes of the heap blocks before the collection.
+@field capacityAfter The bytes of the heap blocks after the collection.
+@field reason What started the collection.
+*/
+typedef struct {
+    double startTime;
+    double markDuration;
+    double sweepDuration;
+    size_t sizeBefore;
+    size_t sizeAfter;
+    size_t capacityBefore;
+    size_t capacityAfter;
+    JSGCReason reason;
+} JSGCEvent;
+
+/*!
+@function
+@abstract Gets the last garbage collections of the heap of a context group.
+@param ctx The execution context to use.
+@param events The array the collections are copied to, oldest first, or NULL.
+@param maxEvents The number of collections events can hold.
+@result The number of collections copied, or when events is NULL the number of collections kept.
+@discussion The heap keeps a small number of the most recent collections.
+*/
+JS_EXPORT size_t JSGetGCEvents(JSContextRef ctx, JSGCEvent* events, size_t maxEvents);
+
+/*!
+@struct JSParseStatistics
+@abstract The work of the parser for all scripts of a context group.
+@field fullParses The number of programs and eval code parsed as a whole.
+@field lazyReparses The number of function bodies parsed again when they were first called.
+@field lazyReparsedCharacters The length of the function bodies parsed again.
+@field functionCacheHits The number of function bodies skipped through the cache of their source.
+@field cachedFunctions The number of function bodies added to the cache of their source.
+*/
+typedef struct {
+    unsigned fullParses;
+    unsigned lazyReparses;
+    unsigned lazyReparsedCharacters;
+    unsigned functionCacheHits;
+    unsigned cachedFunctions;
+} JSParseStatistics;
+
+/*!
+@function
+@abstract Gets the counters of the parser of a context group.
+@param ctx The execution context to use.
+@param statistics The structure the counters are copied to.
+*/
+JS_EXPORT void JSGetParseStatistics(JSContextRef ctx, JSParseStatistics* statistics);
+
 #ifdef __cplusplus
 }
 #endif
@@ -607,6 +607,18 @@ private:
         return m_functionCache ? m_functionCache->get(openBracePos) : 0;
     }
 
+    void didHitFunctionCache()
+    {
+        m_lexer->sourceProvider()->parseStatistics().functionCacheHits++;
+        m_globalData->parseStatistics.functionCacheHits++;
+    }
+
+    void didCacheFunction()
+    {
+        m_lexer->sourceProvider()->parseStatistics().cachedFunctions++;
+        m_globalData->parseStatistics.cachedFunctions++;
+    }
+
     SourceProviderCache* m_functionCache;
 };
 
@@ -1314,6 +1326,7 @@ template <JSParser::FunctionRequirements requirements, bool nameIsInContainingSc
     if (const SourceProviderCacheItem* cachedInfo = TreeBuilder::CanUseFunctionCache ? findCachedFunctionInfo(openBracePos) : 0) {
         // If we know about this function already, we can use the cached info and skip the parser to the end of the function.
         body = context.createFunctionBody(strictMode());
+        didHitFunctionCache();
 
         functionScope->restoreFunctionInfo(cachedInfo);
         failIfFalse(popScope(functionScope, TreeBuilder::NeedsFreeVariableInfo));
@@ -1353,6 +1366,7 @@ template <JSParser::FunctionRequirements requirements, bool nameIsInContainingSc
     if (newInfo) {
         unsigned approximateByteSize = newInfo->approximateByteSize();
         m_functionCache->add(openBracePos, newInfo.release(), approximateByteSize);
+        didCacheFunction();
     }
 
     next();
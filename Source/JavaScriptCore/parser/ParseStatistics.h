@@ -0,0 +1,51 @@
+/*
+ *  Copyright (C) 2011 Beijing Feynman Software Technology Co., Ltd.
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#ifndef ParseStatistics_h
+#define ParseStatistics_h
+
+namespace JSC {
+
+    // Counts the work of the parser, kept for every script (see
+    // SourceProvider) and, for all of them together, by the JSGlobalData.
+    struct ParseStatistics {
+        ParseStatistics()
+            : fullParses(0)
+            , lazyReparses(0)
+            , lazyReparsedCharacters(0)
+            , functionCacheHits(0)
+            , cachedFunctions(0)
+        {
+        }
+
+        // Program and eval code, parsed as a whole. The bodies of the
+        // functions in it are only checked for syntax.
+        unsigned fullParses;
+        // Function bodies parsed again when they were first called.
+        unsigned lazyReparses;
+        unsigned lazyReparsedCharacters;
+        // Function bodies skipped through the SourceProviderCache.
+        unsigned functionCacheHits;
+        // Function bodies added to the SourceProviderCache.
+        unsigned cachedFunctions;
+    };
+
+} // namespace JSC
+
+#endif // ParseStatistics_h
@@ -24,6 +24,7 @@
 #include "Parser.h"
 
 #include "Debugger.h"
+#include "JSGlobalData.h"
 #include "JSParser.h"
 #include "Lexer.h"
 
@@ -60,6 +61,21 @@ void Parser::parse(JSGlobalData* globalData, FunctionParameters* parameters, JSP
     }
 }
 
+void Parser::didParse(JSGlobalData* globalData, const SourceCode& source)
+{
+    source.provider()->parseStatistics().fullParses++;
+    globalData->parseStatistics.fullParses++;
+}
+
+void Parser::didReparse(JSGlobalData* globalData, const SourceCode& source)
+{
+    ParseStatistics& statistics = source.provider()->parseStatistics();
+    statistics.lazyReparses++;
+    statistics.lazyReparsedCharacters += source.length();
+    globalData->parseStatistics.lazyReparses++;
+    globalData->parseStatistics.lazyReparsedCharacters += source.length();
+}
+
 void Parser::didFinishParsing(SourceElements* sourceElements, ParserArenaData<DeclarationStacks::VarStack>* varStack, 
                               ParserArenaData<DeclarationStacks::FunctionStack>* funcStack, CodeFeatures features, int lastLine, int numConstants, IdentifierSet& capturedVars)
 {
@@ -61,6 +61,9 @@ namespace JSC {
     private:
         void parse(JSGlobalData*, FunctionParameters*, JSParserStrictness strictness, JSParserMode mode, int* errLine, UString* errMsg);
 
+        void didParse(JSGlobalData*, const SourceCode&);
+        void didReparse(JSGlobalData*, const SourceCode&);
+
         // Used to determine type of error to report.
         bool isFunctionBodyNode(ScopeNode*) { return false; }
         bool isFunctionBodyNode(FunctionBodyNode*) { return true; }
@@ -85,8 +88,11 @@ namespace JSC {
         UString errMsg;
 
         m_source = &source;
-        if (ParsedNode::scopeIsFunction)
+        if (ParsedNode::scopeIsFunction) {
             lexicalGlobalObject->globalData().lexer->setIsReparsing();
+            didReparse(&lexicalGlobalObject->globalData(), source);
+        } else
+            didParse(&lexicalGlobalObject->globalData(), source);
         parse(&lexicalGlobalObject->globalData(), parameters, strictness, ParsedNode::isFunctionNode ? JSParseFunctionCode : JSParseProgramCode, &errLine, &errMsg);
 
         RefPtr<ParsedNode> result;
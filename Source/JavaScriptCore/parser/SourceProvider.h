@@ -29,6 +29,7 @@
 #ifndef SourceProvider_h
 #define SourceProvider_h
 
+#include "ParseStatistics.h"
 #include "SourceProviderCache.h"
 #include "UString.h"
 #include <wtf/PassOwnPtr.h>
@@ -40,11 +41,14 @@ namespace JSC {
 
     class SourceProvider : public RefCounted<SourceProvider> {
     public:
-        SourceProvider(const UString& url, SourceProviderCache* cache = 0)
+        // Like the cache, the statistics may be kept by whoever outlives the
+        // provider, so that they add up over all providers of one script.
+        SourceProvider(const UString& url, SourceProviderCache* cache = 0, ParseStatistics* statistics = 0)
             : m_url(url)
             , m_validated(false)
             , m_cache(cache ? cache : new SourceProviderCache)
             , m_cacheOwned(!cache)
+            , m_parseStatistics(statistics ? statistics : &m_ownParseStatistics)
         {
         }
         virtual ~SourceProvider()
@@ -66,6 +70,8 @@ namespace JSC {
 
         SourceProviderCache* cache() const { return m_cache; }
         void notifyCacheSizeChanged(int delta) { if (!m_cacheOwned) cacheSizeChanged(delta); }
+
+        ParseStatistics& parseStatistics() { return *m_parseStatistics; }
         
     private:
         virtual void cacheSizeChanged(int delta) { UNUSED_PARAM(delta); }
@@ -74,6 +80,8 @@ namespace JSC {
         bool m_validated;
         SourceProviderCache* m_cache;
         bool m_cacheOwned;
+        ParseStatistics* m_parseStatistics;
+        ParseStatistics m_ownParseStatistics;
     };
 
     class UStringSourceProvider : public SourceProvider {
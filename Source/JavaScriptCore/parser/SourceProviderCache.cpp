@@ -26,10 +26,104 @@
 #include "config.h"
 #include "SourceProviderCache.h"
 
+#include "Identifier.h"
 #include "SourceProviderCacheItem.h"
+#include <string.h>
+#include <wtf/SHA1.h>
 
 namespace JSC {
 
+// Bumped whenever the layout of the serialized data changes.
+static const unsigned encodedCacheMagic = 0x4a534643; // "JSFC"
+static const unsigned encodedCacheVersion = 2;
+
+typedef Vector<uint8_t, 20> SourceDigest;
+
+// The SHA-1 of the source characters. The captured variables restored from
+// the data are only right for exactly the source they were recorded for, a
+// short hash that collides would make closures resolve the wrong variables.
+static void computeSourceDigest(const UChar* source, int length, SourceDigest& digest)
+{
+    SHA1 sha1;
+    sha1.addBytes(reinterpret_cast<const uint8_t*>(source), length * sizeof(UChar));
+    sha1.computeHash(digest);
+}
+
+class EncodedCacheWriter {
+public:
+    EncodedCacheWriter(Vector<char>& buffer) : m_buffer(buffer) { }
+
+    void appendInt(int value) { m_buffer.append(reinterpret_cast<const char*>(&value), sizeof(value)); }
+    void appendBytes(const uint8_t* bytes, size_t size) { m_buffer.append(reinterpret_cast<const char*>(bytes), size); }
+
+    void appendIdentifiers(const Vector<RefPtr<StringImpl> >& identifiers)
+    {
+        appendInt(identifiers.size());
+        for (size_t i = 0; i < identifiers.size(); ++i) {
+            StringImpl* identifier = identifiers[i].get();
+            appendInt(identifier->length());
+            m_buffer.append(reinterpret_cast<const char*>(identifier->characters()), identifier->length() * sizeof(UChar));
+        }
+    }
+
+private:
+    Vector<char>& m_buffer;
+};
+
+class EncodedCacheReader {
+public:
+    EncodedCacheReader(const char* data, size_t size)
+        : m_data(data)
+        , m_end(data + size)
+    {
+    }
+
+    bool readInt(int& value)
+    {
+        if (static_cast<size_t>(m_end - m_data) < sizeof(value))
+            return false;
+        memcpy(&value, m_data, sizeof(value));
+        m_data += sizeof(value);
+        return true;
+    }
+
+    bool readBytes(uint8_t* bytes, size_t size)
+    {
+        if (static_cast<size_t>(m_end - m_data) < size)
+            return false;
+        memcpy(bytes, m_data, size);
+        m_data += size;
+        return true;
+    }
+
+    bool readIdentifiers(JSGlobalData* globalData, Vector<RefPtr<StringImpl> >& identifiers)
+    {
+        int count;
+        if (!readInt(count) || count < 0)
+            return false;
+        for (int i = 0; i < count; ++i) {
+            int length;
+            if (!readInt(length) || length <= 0)
+                return false;
+            if (static_cast<size_t>(m_end - m_data) / sizeof(UChar) < static_cast<size_t>(length))
+                return false;
+            Vector<UChar> characters(length);
+            memcpy(characters.data(), m_data, length * sizeof(UChar));
+            m_data += length * sizeof(UChar);
+            // The parser compares the names by pointer, they have to be
+            // the atoms of the identifier table.
+            identifiers.append(Identifier(globalData, characters.data(), length).impl());
+        }
+        return true;
+    }
+
+    bool atEnd() const { return m_data == m_end; }
+
+private:
+    const char* m_data;
+    const char* m_end;
+};
+
 SourceProviderCache::~SourceProviderCache()
 {
     clear();
@@ -53,4 +147,87 @@ void SourceProviderCache::add(int sourcePosition, PassOwnPtr<SourceProviderCache
     m_contentByteSize += size;
 }
 
+void SourceProviderCache::encode(Vector<char>& buffer, const UChar* source, int length) const
+{
+    EncodedCacheWriter writer(buffer);
+    writer.appendInt(encodedCacheMagic);
+    writer.appendInt(encodedCacheVersion);
+    writer.appendInt(length);
+    SourceDigest digest;
+    computeSourceDigest(source, length, digest);
+    writer.appendBytes(digest.data(), digest.size());
+    writer.appendInt(m_map.size());
+
+    HashMap<int, SourceProviderCacheItem*>::const_iterator end = m_map.end();
+    for (HashMap<int, SourceProviderCacheItem*>::const_iterator it = m_map.begin(); it != end; ++it) {
+        const SourceProviderCacheItem* item = it->second;
+        writer.appendInt(it->first);
+        writer.appendInt(item->closeBraceLine);
+        writer.appendInt(item->closeBracePos);
+        writer.appendInt(item->usesEval);
+        writer.appendIdentifiers(item->usedVariables);
+        writer.appendIdentifiers(item->writtenVariables);
+    }
+}
+
+bool SourceProviderCache::decode(JSGlobalData* globalData, const char* data, size_t size, const UChar* source, int length)
+{
+    EncodedCacheReader reader(data, size);
+    int magic, version, encodedLength, count;
+    if (!reader.readInt(magic) || static_cast<unsigned>(magic) != encodedCacheMagic)
+        return false;
+    if (!reader.readInt(version) || static_cast<unsigned>(version) != encodedCacheVersion)
+        return false;
+    if (!reader.readInt(encodedLength) || encodedLength != length)
+        return false;
+    SourceDigest digest;
+    computeSourceDigest(source, length, digest);
+    uint8_t encodedDigest[20];
+    if (!reader.readBytes(encodedDigest, sizeof(encodedDigest)) || memcmp(encodedDigest, digest.data(), sizeof(encodedDigest)))
+        return false;
+    if (!reader.readInt(count) || count < 0)
+        return false;
+
+    // Nothing is added before all of the data was checked.
+    Vector<std::pair<int, SourceProviderCacheItem*> > items;
+    bool valid = true;
+    for (int i = 0; i < count; ++i) {
+        int openBracePos, closeBraceLine, closeBracePos, usesEval;
+        if (!reader.readInt(openBracePos) || !reader.readInt(closeBraceLine) || !reader.readInt(closeBracePos) || !reader.readInt(usesEval)) {
+            valid = false;
+            break;
+        }
+        // The parser resumes right after the close brace, make sure the
+        // positions still match the braces of the body.
+        if (openBracePos < 0 || closeBracePos <= openBracePos || closeBracePos >= length
+            || source[openBracePos] != '{' || source[closeBracePos] != '}' || closeBraceLine < 1) {
+            valid = false;
+            break;
+        }
+        OwnPtr<SourceProviderCacheItem> item = adoptPtr(new SourceProviderCacheItem(closeBraceLine, closeBracePos));
+        item->usesEval = usesEval;
+        if (!reader.readIdentifiers(globalData, item->usedVariables) || !reader.readIdentifiers(globalData, item->writtenVariables)) {
+            valid = false;
+            break;
+        }
+        items.append(std::make_pair(openBracePos, item.leakPtr()));
+    }
+
+    if (!valid || !reader.atEnd()) {
+        for (size_t i = 0; i < items.size(); ++i)
+            delete items[i].second;
+        return false;
+    }
+
+    for (size_t i = 0; i < items.size(); ++i) {
+        if (m_map.contains(items[i].first)) {
+            delete items[i].second;
+            continue;
+        }
+        unsigned itemSize = items[i].second->approximateByteSize();
+        add(items[i].first, adoptPtr(items[i].second), itemSize);
+    }
+    return true;
+}
+
 }
@@ -25,9 +25,12 @@
 
 #include <wtf/HashMap.h>
 #include <wtf/PassOwnPtr.h>
+#include <wtf/Vector.h>
+#include <wtf/unicode/Unicode.h>
 
 namespace JSC {
 
+class JSGlobalData;
 class SourceProviderCacheItem;
 
 class SourceProviderCache {
@@ -40,6 +43,14 @@ public:
     void add(int sourcePosition, PassOwnPtr<SourceProviderCacheItem>, unsigned size);
     const SourceProviderCacheItem* get(int sourcePosition) const { return m_map.get(sourcePosition); }
 
+    // Serializes the cached functions so that a later load of the same
+    // source can skip their bodies from the first parse. The data records
+    // the length and the SHA-1 digest of the source it was made for.
+    void encode(Vector<char>&, const UChar* source, int length) const;
+    // Adds the functions serialized by encode(). Fails, leaving the cache
+    // as it was, if the data is malformed or was made for another source.
+    bool decode(JSGlobalData*, const char* data, size_t size, const UChar* source, int length);
+
 private:
     HashMap<int, SourceProviderCacheItem*> m_map;
     unsigned m_contentByteSize;
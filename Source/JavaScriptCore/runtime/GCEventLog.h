@@ -0,0 +1,102 @@
+/*
+ *  Copyright (C) 2011 Beijing Feynman Software Technology Co., Ltd.
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#ifndef GCEventLog_h
+#define GCEventLog_h
+
+#include <algorithm>
+#include <wtf/Noncopyable.h>
+
+namespace JSC {
+
+    enum GCReason {
+        GCReasonAllocation,      // The allocations crossed the high water mark.
+        GCReasonExtraMemoryCost, // Objects reported a lot of memory outside of the heap.
+        GCReasonExplicit         // collectAllGarbage() or collectAllGarbageLazily() was called.
+    };
+
+    // Times are in seconds, sizes in bytes. The size counts the cells which
+    // are alive or were allocated since the previous collection, the
+    // capacity counts the blocks of the heap. The sweep time of a lazy
+    // collection only covers freeing the empty blocks.
+    struct GCEvent {
+        double startTime;
+        double markDuration;
+        double sweepDuration;
+        size_t sizeBefore;
+        size_t sizeAfter;
+        size_t capacityBefore;
+        size_t capacityAfter;
+        GCReason reason;
+    };
+
+    // Keeps the last few collections of a heap, so that pauses seen in the
+    // field can be matched with collections without a debug build.
+    class GCEventLog {
+        WTF_MAKE_NONCOPYABLE(GCEventLog);
+    public:
+        static const size_t capacity = 64;
+
+        GCEventLog()
+            : m_next(0)
+            , m_count(0)
+        {
+        }
+
+        void append(const GCEvent& event)
+        {
+            m_events[m_next] = event;
+            m_next = (m_next + 1) % capacity;
+            if (m_count < capacity)
+                ++m_count;
+        }
+
+        size_t size() const { return m_count; }
+
+        // Copies the last maxEvents events to events, oldest first, and
+        // returns how many were copied. Event is an API struct with the
+        // fields of GCEvent, its reason is made by convertReason.
+        template<typename Event, typename Reason>
+        size_t copyEvents(Event* events, size_t maxEvents, Reason (*convertReason)(GCReason)) const
+        {
+            size_t count = std::min(maxEvents, m_count);
+            size_t first = (m_next + capacity - count) % capacity;
+            for (size_t i = 0; i < count; ++i) {
+                const GCEvent& event = m_events[(first + i) % capacity];
+                events[i].startTime = event.startTime;
+                events[i].markDuration = event.markDuration;
+                events[i].sweepDuration = event.sweepDuration;
+                events[i].sizeBefore = event.sizeBefore;
+                events[i].sizeAfter = event.sizeAfter;
+                events[i].capacityBefore = event.capacityBefore;
+                events[i].capacityAfter = event.capacityAfter;
+                events[i].reason = convertReason(event.reason);
+            }
+            return count;
+        }
+
+    private:
+        GCEvent m_events[capacity];
+        size_t m_next;
+        size_t m_count;
+    };
+
+} // namespace JSC
+
+#endif // GCEventLog_h
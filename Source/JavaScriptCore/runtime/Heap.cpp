@@ -31,6 +31,7 @@
 #include "JSONObject.h"
 #include "Tracing.h"
 #include <algorithm>
+#include <wtf/CurrentTime.h>
 
 #define COLLECT_ON_EVERY_SLOW_ALLOCATION 0
 
@@ -102,7 +103,7 @@ void Heap::reportExtraMemoryCostSlowCase(size_t cost)
     // collecting more frequently as long as it stays alive.
 
     if (m_extraCost > maxExtraCost && m_extraCost > m_markedSpace.highWaterMark() / 2)
-        collectAllGarbage();
+        reset(DoSweep, GCReasonExtraMemoryCost);
     m_extraCost += cost;
 }
 
@@ -119,7 +120,7 @@ void* Heap::allocateSlowCase(size_t bytes)
     ASSERT(m_operationInProgress == NoOperation);
 #endif
 
-    reset(DoNotSweep);
+    reset(DoLazySweep, GCReasonAllocation);
 
     m_operationInProgress = Allocation;
     void* result = m_markedSpace.allocate(bytes);
@@ -361,19 +362,46 @@ bool Heap::isBusy()
 
 void Heap::collectAllGarbage()
 {
-    reset(DoSweep);
+    reset(DoSweep, GCReasonExplicit);
 }
 
-void Heap::reset(SweepToggle sweepToggle)
+void Heap::collectAllGarbageLazily()
+{
+    reset(DoLazySweep, GCReasonExplicit);
+}
+
+bool Heap::sweepIncrementally(size_t blockCount)
+{
+    ASSERT(JSLock::currentThreadIsHoldingLock());
+    ASSERT(m_operationInProgress == NoOperation);
+    if (m_operationInProgress != NoOperation)
+        return m_markedSpace.hasDeferredSweep();
+
+    m_operationInProgress = Collection;
+    bool moreToSweep = m_markedSpace.sweepIncrementally(blockCount);
+    m_operationInProgress = NoOperation;
+    return moreToSweep;
+}
+
+void Heap::reset(SweepToggle sweepToggle, GCReason reason)
 {
     ASSERT(globalData()->identifierTable == wtfThreadData().currentIdentifierTable());
     JAVASCRIPTCORE_GC_BEGIN();
 
+    GCEvent event;
+    event.reason = reason;
+    event.sizeBefore = m_markedSpace.size();
+    event.capacityBefore = m_markedSpace.capacity();
+    event.startTime = currentTime();
+
     markRoots();
     m_handleHeap.finalizeWeakHandles();
 
     JAVASCRIPTCORE_GC_MARKED();
 
+    double markEndTime = currentTime();
+    event.markDuration = markEndTime - event.startTime;
+
     m_markedSpace.reset();
     m_extraCost = 0;
 
@@ -381,16 +409,30 @@ void Heap::reset(SweepToggle sweepToggle)
     sweepToggle = DoSweep;
 #endif
 
+    double sweepStartTime = currentTime();
     if (sweepToggle == DoSweep) {
         m_markedSpace.sweep();
         m_markedSpace.shrink();
+    } else if (sweepToggle == DoLazySweep) {
+        // The dead cells are destroyed by the allocator before it reuses
+        // their atoms, or a few blocks at a time by sweepIncrementally().
+        // Blocks emptied by a collection the allocator asked for are about
+        // to be filled again, otherwise they go back to the system now.
+        if (reason != GCReasonAllocation)
+            m_markedSpace.shrink();
+        m_markedSpace.deferSweep();
     }
+    event.sweepDuration = currentTime() - sweepStartTime;
 
     // To avoid pathological GC churn in large heaps, we set the allocation high
     // water mark to be proportional to the current size of the heap. The exact
     // proportion is a bit arbitrary. A 2X multiplier gives a 1:1 (heap size :
     // new bytes allocated) proportion, and seems to work well in benchmarks.
-    size_t proportionalBytes = 2 * m_markedSpace.size();
+    event.sizeAfter = m_markedSpace.size();
+    event.capacityAfter = m_markedSpace.capacity();
+    m_gcEventLog.append(event);
+
+    size_t proportionalBytes = 2 * event.sizeAfter;
     m_markedSpace.setHighWaterMark(max(proportionalBytes, minBytesPerCycle));
 
     JAVASCRIPTCORE_GC_END();
@@ -22,6 +22,7 @@
 #ifndef Heap_h
 #define Heap_h
 
+#include "GCEventLog.h"
 #include "HandleHeap.h"
 #include "HandleStack.h"
 #include "MarkStack.h"
@@ -75,6 +76,15 @@ namespace JSC {
         bool isBusy(); // true if an allocation or collection is in progress
         void* allocate(size_t);
         void collectAllGarbage();
+        // Like collectAllGarbage(), but only frees the empty blocks. The dead
+        // cells of the others are left to the allocator and to
+        // sweepIncrementally(), so the pause is shorter.
+        void collectAllGarbageLazily();
+        // Destroys the dead cells of up to blockCount blocks which the last
+        // lazy collection left unswept, returns true while some are left.
+        bool sweepIncrementally(size_t blockCount);
+
+        const GCEventLog& gcEventLog() const { return m_gcEventLog; }
 
         void reportExtraMemoryCost(size_t cost);
 
@@ -117,8 +127,8 @@ namespace JSC {
         void markProtectedObjects(HeapRootMarker&);
         void markTempSortVectors(HeapRootMarker&);
 
-        enum SweepToggle { DoNotSweep, DoSweep };
-        void reset(SweepToggle);
+        enum SweepToggle { DoNotSweep, DoSweep, DoLazySweep };
+        void reset(SweepToggle, GCReason);
 
         RegisterFile& registerFile();
 
@@ -140,6 +150,8 @@ namespace JSC {
         HandleStack m_handleStack;
 
         size_t m_extraCost;
+
+        GCEventLog m_gcEventLog;
     };
 
     inline bool Heap::isMarked(const JSCell* cell)
@@ -36,6 +36,7 @@
 #include "JITStubs.h"
 #include "JSValue.h"
 #include "NumericStrings.h"
+#include "ParseStatistics.h"
 #include "SmallStrings.h"
 #include "Terminator.h"
 #include "TimeoutChecker.h"
@@ -199,6 +200,7 @@ namespace JSC {
 
         Lexer* lexer;
         Parser* parser;
+        ParseStatistics parseStatistics;
         Interpreter* interpreter;
 #if ENABLE(JIT)
         OwnPtr<JITThunks> jitStubs;
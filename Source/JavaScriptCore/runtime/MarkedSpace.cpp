@@ -89,6 +89,9 @@ void* MarkedSpace::allocateFromSizeClass(SizeClass& sizeClass)
 
 void MarkedSpace::shrink()
 {
+    // The blocks to sweep may be among the empty ones.
+    m_blocksToSweep.clear();
+
     // We record a temporary list of empties to avoid modifying m_blocks while iterating it.
     DoublyLinkedList<MarkedBlock> empties;
 
@@ -116,11 +119,32 @@ void MarkedSpace::clearMarks()
 
 void MarkedSpace::sweep()
 {
+    m_blocksToSweep.clear();
+
     BlockIterator end = m_blocks.end();
     for (BlockIterator it = m_blocks.begin(); it != end; ++it)
         (*it)->sweep();
 }
 
+void MarkedSpace::deferSweep()
+{
+    m_blocksToSweep.clear();
+    m_blocksToSweep.reserveCapacity(m_blocks.size());
+
+    BlockIterator end = m_blocks.end();
+    for (BlockIterator it = m_blocks.begin(); it != end; ++it)
+        m_blocksToSweep.append(*it);
+}
+
+bool MarkedSpace::sweepIncrementally(size_t blockCount)
+{
+    while (blockCount-- && !m_blocksToSweep.isEmpty()) {
+        m_blocksToSweep.last()->sweep();
+        m_blocksToSweep.removeLast();
+    }
+    return !m_blocksToSweep.isEmpty();
+}
+
 size_t MarkedSpace::objectCount() const
 {
     size_t result = 0;
@@ -150,6 +174,9 @@ size_t MarkedSpace::capacity() const
 
 void MarkedSpace::reset()
 {
+    // Dead cells stay unmarked, so the allocator destroys what was left to
+    // sweep along with the cells that died since.
+    m_blocksToSweep.clear();
     m_waterMark = 0;
 
     for (size_t cellSize = preciseStep; cellSize < preciseCutoff; cellSize += preciseStep)
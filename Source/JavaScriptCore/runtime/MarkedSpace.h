@@ -71,6 +71,14 @@ namespace JSC {
         void sweep();
         void shrink();
 
+        // Leaves the dead cells of the blocks that survived shrink() to be
+        // destroyed when their atoms are allocated again, or a few blocks at
+        // a time by sweepIncrementally(), which returns false once nothing
+        // is left to sweep.
+        void deferSweep();
+        bool sweepIncrementally(size_t blockCount);
+        bool hasDeferredSweep() const { return !m_blocksToSweep.isEmpty(); }
+
         size_t size() const;
         size_t capacity() const;
         size_t objectCount() const;
@@ -112,6 +120,7 @@ namespace JSC {
         SizeClass m_preciseSizeClasses[preciseCount];
         SizeClass m_impreciseSizeClasses[impreciseCount];
         HashSet<MarkedBlock*> m_blocks;
+        Vector<MarkedBlock*> m_blocksToSweep;
         size_t m_waterMark;
         size_t m_highWaterMark;
         JSGlobalData* m_globalData;
@@ -0,0 +1,4 @@
+#ifndef WebCore_FWD_ParseStatistics_h
+#define WebCore_FWD_ParseStatistics_h
+#include <JavaScriptCore/ParseStatistics.h>
+#endif
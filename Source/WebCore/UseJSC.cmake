@@ -10,6 +10,7 @@ LIST(APPEND WebCore_IDL_INCLUDES
 LIST(APPEND WebCore_SOURCES
     bindings/js/DOMObjectHashTableMap.cpp
     bindings/js/DOMWrapperWorld.cpp
+    bindings/js/FunctionPreparser.cpp
     bindings/js/GCController.cpp
     bindings/js/IDBBindingUtilities.cpp
     bindings/js/JSAttrCustom.cpp
@@ -57,7 +57,7 @@ namespace WebCore {
 
     private:
         CachedScriptSourceProvider(CachedScript* cachedScript)
-            : ScriptSourceProvider(stringToUString(cachedScript->response().url()), cachedScript->sourceProviderCache())
+            : ScriptSourceProvider(stringToUString(cachedScript->response().url()), cachedScript->sourceProviderCache(), cachedScript->parseStatistics())
             , m_cachedScript(cachedScript)
         {
             m_cachedScript->addClient(this);
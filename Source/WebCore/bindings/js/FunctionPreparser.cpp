@@ -0,0 +1,115 @@
+/*
+** $Id$
+**
+** FunctionPreparser.cpp: compiles event listeners before their first event.
+**
+** Copyright (C) 2003 ~ 2010 Beijing Feynman Software Technology Co., Ltd.
+**
+** All rights reserved by Feynman Software.
+*/
+
+#include "config.h"
+#include "FunctionPreparser.h"
+
+#include "DOMWrapperWorld.h"
+#include "JSDOMWindow.h"
+#include <runtime/Executable.h>
+#include <runtime/JSFunction.h>
+#include <runtime/JSGlobalData.h>
+#include <runtime/JSLock.h>
+#include <wtf/CurrentTime.h>
+#include <wtf/MainThread.h>
+#include <wtf/OwnPtr.h>
+#include <wtf/StdLibExtras.h>
+
+using namespace JSC;
+
+namespace WebCore {
+
+// Pages which keep adding listeners should not grow the queue without end.
+static const size_t maxPendingFunctions = 512;
+
+FunctionPreparser& functionPreparser()
+{
+    DEFINE_STATIC_LOCAL(FunctionPreparser, staticFunctionPreparser, ());
+    return staticFunctionPreparser;
+}
+
+FunctionPreparser::FunctionPreparser()
+    : m_policy(PreparseNothing)
+    , m_preparsedFunctions(0)
+{
+}
+
+void FunctionPreparser::setPolicy(Policy policy)
+{
+    m_policy = policy;
+    if (m_policy == PreparseNothing)
+        clear();
+}
+
+void FunctionPreparser::clear()
+{
+    deleteAllValues(m_queuedFunctions);
+    m_queuedFunctions.clear();
+    m_pendingFunctions.clear();
+}
+
+void FunctionPreparser::didAddEventListener(JSObject* function, DOMWrapperWorld* world)
+{
+    if (m_policy != PreparseEventListeners || !function || m_pendingFunctions.size() >= maxPendingFunctions)
+        return;
+    // Workers have heaps of their own, the queue is drained on the main
+    // thread with the heap of its worlds.
+    if (!isMainThread() || !world || world->globalData() != JSDOMWindow::commonJSGlobalData())
+        return;
+    if (!function->inherits(&JSFunction::s_info))
+        return;
+    JSFunction* jsFunction = static_cast<JSFunction*>(function);
+    if (jsFunction->isHostFunction() || jsFunction->jsExecutable()->isGeneratedForCall())
+        return;
+
+    QueuedFunctionMap::iterator it = m_queuedFunctions.find(function);
+    if (it != m_queuedFunctions.end()) {
+        // The same function added for another event or target.
+        if (it->second->get() == function)
+            return;
+        // A collected function which had the same address.
+        delete it->second;
+        m_queuedFunctions.remove(it);
+    }
+
+    m_queuedFunctions.set(function, new WeakGCPtr<JSObject>(*JSDOMWindow::commonJSGlobalData(), function));
+    m_pendingFunctions.append(function);
+}
+
+bool FunctionPreparser::preparse(double timeLimit)
+{
+    JSLock lock(SilenceAssertionsOnly);
+    JSGlobalData& globalData = *JSDOMWindow::commonJSGlobalData();
+
+    double startTime = currentTime();
+    while (!m_pendingFunctions.isEmpty() && currentTime() - startTime < timeLimit) {
+        JSObject* key = m_pendingFunctions.last();
+        m_pendingFunctions.removeLast();
+        // Already taken by a later entry for the same address.
+        OwnPtr<WeakGCPtr<JSObject> > pending = adoptPtr(m_queuedFunctions.take(key));
+        if (!pending)
+            continue;
+
+        // Collected, or called meanwhile.
+        JSFunction* function = static_cast<JSFunction*>(pending->get());
+        if (!function || function->jsExecutable()->isGeneratedForCall())
+            continue;
+
+        ScopeChainNode* scopeChain = function->scope();
+        JSGlobalObject* globalObject = scopeChain->globalObject.get();
+        DynamicGlobalObjectScope globalObjectScope(globalData, globalObject);
+        // A failure is reported again when the function is called.
+        if (!function->jsExecutable()->compileForCall(globalObject->globalExec(), scopeChain))
+            ++m_preparsedFunctions;
+    }
+    return !m_pendingFunctions.isEmpty();
+}
+
+} // namespace WebCore
@@ -0,0 +1,78 @@
+/*
+** $Id$
+**
+** FunctionPreparser.h: compiles event listeners before their first event.
+**
+** Copyright (C) 2003 ~ 2010 Beijing Feynman Software Technology Co., Ltd.
+**
+** All rights reserved by Feynman Software.
+*/
+
+#ifndef FunctionPreparser_h
+#define FunctionPreparser_h
+
+#include <runtime/WeakGCPtr.h>
+#include <wtf/HashMap.h>
+#include <wtf/Noncopyable.h>
+#include <wtf/Vector.h>
+
+namespace JSC {
+    class JSObject;
+}
+
+namespace WebCore {
+
+    class DOMWrapperWorld;
+
+    // The body of a function is only parsed and compiled on its first call,
+    // so the first click on a script heavy page waits for its handler to be
+    // compiled. With the PreparseEventListeners policy the functions added
+    // as event listeners are queued, and the port compiles them through
+    // preparse() while the views are idle.
+    class FunctionPreparser {
+        WTF_MAKE_NONCOPYABLE(FunctionPreparser); WTF_MAKE_FAST_ALLOCATED;
+        friend FunctionPreparser& functionPreparser();
+
+    public:
+        enum Policy {
+            PreparseNothing,
+            PreparseEventListeners
+        };
+
+        void setPolicy(Policy);
+        Policy policy() const { return m_policy; }
+
+        // Queues the function of a listener added to an event target of
+        // world, if the policy asks for it. Only functions of the main
+        // thread's heap are queued, and each of them once.
+        void didAddEventListener(JSC::JSObject* function, DOMWrapperWorld* world);
+
+        bool hasPendingFunctions() const { return !m_pendingFunctions.isEmpty(); }
+        // Compiles the queued functions, the most recently added first, until
+        // timeLimit seconds have passed. Returns whether some are left.
+        bool preparse(double timeLimit);
+
+        unsigned preparsedFunctions() const { return m_preparsedFunctions; }
+
+    private:
+        FunctionPreparser(); // Use functionPreparser() instead
+
+        void clear();
+
+        Policy m_policy;
+        // In the order they were added. A function may be listed twice when
+        // it was collected and a new one took its address, it only has one
+        // handle.
+        Vector<JSC::JSObject*> m_pendingFunctions;
+        // The functions are not kept alive for the preparser's sake.
+        typedef HashMap<JSC::JSObject*, JSC::WeakGCPtr<JSC::JSObject>*> QueuedFunctionMap;
+        QueuedFunctionMap m_queuedFunctions;
+        unsigned m_preparsedFunctions;
+    };
+
+    // Function to obtain the global function preparser.
+    FunctionPreparser& functionPreparser();
+
+} // namespace WebCore
+
+#endif // FunctionPreparser_h
@@ -769,6 +769,7 @@ JSValue JSDOMWindow::addEventListener(ExecState* exec)
         return jsUndefined();
 
     impl()->addEventListener(ustringToAtomicString(exec->argument(0).toString(exec)), JSEventListener::create(asObject(listener), this, false, currentWorld(exec)), exec->argument(2).toBoolean(exec));
+    functionPreparser().didAddEventListener(asObject(listener), currentWorld(exec));
     return jsUndefined();
 }
 
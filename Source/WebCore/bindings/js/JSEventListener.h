@@ -21,6 +21,7 @@
 #define JSEventListener_h
 
 #include "EventListener.h"
+#include "FunctionPreparser.h"
 #include "JSDOMWindow.h"
 #include <runtime/WeakGCPtr.h>
 
@@ -96,7 +97,9 @@ namespace WebCore {
         if (!listener.isObject())
             return 0;
 
-        return JSEventListener::create(asObject(listener), wrapper, true, currentWorld(exec));
+        DOMWrapperWorld* world = currentWorld(exec);
+        functionPreparser().didAddEventListener(asObject(listener), world);
+        return JSEventListener::create(asObject(listener), wrapper, true, world);
     }
 
 
@@ -160,6 +160,8 @@ sub GenerateEventListenerCall
     my $className = shift;
     my $functionName = shift;
     my $passRefPtrHandling = ($functionName eq "add") ? "" : ".get()";
+    # Only listeners which are really added are worth compiling ahead
+    my $preparseCall = ($functionName eq "add") ? "\n    functionPreparser().didAddEventListener(asObject(listener), currentWorld(exec));" : "";
 
     $implIncludes{"JSEventListener.h"} = 1;
 
@@ -180,7 +182,7 @@ END
     JSValue listener = exec->argument(1);
     if (!listener.isObject())
         return JSValue::encode(jsUndefined());
-    imp->${functionName}EventListener(ustringToAtomicString(exec->argument(0).toString(exec)), JSEventListener::create(asObject(listener), $wrapperObject, false, currentWorld(exec))$passRefPtrHandling, exec->argument(2).toBoolean(exec));
+    imp->${functionName}EventListener(ustringToAtomicString(exec->argument(0).toString(exec)), JSEventListener::create(asObject(listener), $wrapperObject, false, currentWorld(exec))$passRefPtrHandling, exec->argument(2).toBoolean(exec));$preparseCall
     return JSValue::encode(jsUndefined());
 END
     return @GenerateEventListenerImpl;
@@ -564,8 +564,13 @@ bool MainResourceLoader::loadNow(ResourceRequest& r)
         handleDataLoadSoon(r);
     else if (shouldLoadEmpty || frameLoader()->representationExistsForURLScheme(url.protocol()))
         handleEmptyLoad(url, !shouldLoadEmpty);
-    else
+    else {
+#if PLATFORM(MG)
+        // Lets the curl scheduler start documents ahead of queued subresources.
+        r.setTargetType(m_frame->tree()->parent() ? ResourceRequest::TargetIsSubframe : ResourceRequest::TargetIsMainFrame);
+#endif
         m_handle = ResourceHandle::create(m_frame->loader()->networkingContext(), r, this, false, true);
+    }
 
     return false;
 }
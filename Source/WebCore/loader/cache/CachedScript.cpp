@@ -36,14 +36,27 @@
 
 #if USE(JSC)  
 #include <parser/SourceProvider.h>
+#if ENABLE(DISK_CACHE)
+#include "JSDOMWindowBase.h"
+#include <parser/SourceProviderCache.h>
+#endif
 #endif
 
 namespace WebCore {
 
+#if USE(JSC) && ENABLE(DISK_CACHE)
+// The parser grows the cache in bursts, while the page runs its scripts.
+static const double cachedMetadataSaveDelay = 3.0;
+#endif
+
 CachedScript::CachedScript(const String& url, const String& charset)
     : CachedResource(url, Script)
     , m_decoder(TextResourceDecoder::create("application/javascript", charset))
     , m_decodedDataDeletionTimer(this, &CachedScript::decodedDataDeletionTimerFired)
+#if USE(JSC) && ENABLE(DISK_CACHE)
+    , m_sourceProviderCacheChanged(false)
+    , m_cachedMetadataSaveTimer(this, &CachedScript::cachedMetadataSaveTimerFired)
+#endif
 {
     // It's javascript we want.
     // But some websites think their scripts are <some wrong mimetype here>
@@ -114,6 +127,10 @@ void CachedScript::error(CachedResource::Status status)
 
 void CachedScript::destroyDecodedData()
 {
+#if USE(JSC) && ENABLE(DISK_CACHE)
+    // The source is needed to validate the saved cache later on.
+    saveCachedMetadata();
+#endif
     m_script = String();
     unsigned extraSize = 0;
 #if USE(JSC)
@@ -137,13 +154,61 @@ JSC::SourceProviderCache* CachedScript::sourceProviderCache() const
 {   
     if (!m_sourceProviderCache) 
         m_sourceProviderCache = adoptPtr(new JSC::SourceProviderCache); 
+#if ENABLE(DISK_CACHE)
+    if (!m_cachedMetadata.isEmpty())
+        const_cast<CachedScript*>(this)->loadCachedMetadata();
+#endif
     return m_sourceProviderCache.get(); 
 }
 
 void CachedScript::sourceProviderCacheSizeChanged(int delta)
 {
     setDecodedSize(decodedSize() + delta);
+#if ENABLE(DISK_CACHE)
+    if (delta > 0) {
+        m_sourceProviderCacheChanged = true;
+        m_cachedMetadataSaveTimer.startOneShot(cachedMetadataSaveDelay);
+    }
+#endif
+}
+
+#if ENABLE(DISK_CACHE)
+void CachedScript::setCachedMetadata(const Vector<char>& metadata)
+{
+    m_cachedMetadata = metadata;
 }
+
+void CachedScript::loadCachedMetadata()
+{
+    const String& source = script();
+    unsigned oldSize = m_sourceProviderCache->byteSize();
+    // If it was saved for another version of the script or is damaged,
+    // the functions are parsed again and the cache is saved anew.
+    m_sourceProviderCache->decode(JSDOMWindowBase::commonJSGlobalData(), m_cachedMetadata.data(), m_cachedMetadata.size(), source.characters(), source.length());
+    m_cachedMetadata.clear();
+    setDecodedSize(decodedSize() + m_sourceProviderCache->byteSize() - oldSize);
+}
+
+void CachedScript::saveCachedMetadata()
+{
+    m_cachedMetadataSaveTimer.stop();
+    if (!m_sourceProviderCacheChanged || !m_sourceProviderCache || m_script.isNull())
+        return;
+    m_sourceProviderCacheChanged = false;
+
+    if (memoryCache()->disabled() || !memoryCache()->isDiskCache() || !inCache())
+        return;
+
+    Vector<char> metadata;
+    m_sourceProviderCache->encode(metadata, m_script.characters(), m_script.length());
+    memoryCache()->httpCache()->setCachedMetadata(this, metadata);
+}
+
+void CachedScript::cachedMetadataSaveTimerFired(Timer<CachedScript>*)
+{
+    saveCachedMetadata();
+}
+#endif
 #endif
 
 } // namespace WebCore
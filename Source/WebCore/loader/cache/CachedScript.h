@@ -30,6 +30,8 @@
 #include "Timer.h"
 
 #if USE(JSC)
+#include <parser/ParseStatistics.h>
+
 namespace JSC {
     class SourceProviderCache;
 }
@@ -60,9 +62,21 @@ namespace WebCore {
         // Allows JSC to cache additional information about the source.
         JSC::SourceProviderCache* sourceProviderCache() const;
         void sourceProviderCacheSizeChanged(int delta);
+        // The parser counters of every evaluation of this script.
+        JSC::ParseStatistics* parseStatistics() { return &m_parseStatistics; }
+#if ENABLE(DISK_CACHE)
+        // The source provider cache saved with the disk cache entry, it is
+        // decoded when the cache is created for the next source provider.
+        void setCachedMetadata(const Vector<char>&);
+#endif
 #endif
     private:
         void decodedDataDeletionTimerFired(Timer<CachedScript>*);
+#if USE(JSC) && ENABLE(DISK_CACHE)
+        void loadCachedMetadata();
+        void saveCachedMetadata();
+        void cachedMetadataSaveTimerFired(Timer<CachedScript>*);
+#endif
         virtual PurgePriority purgePriority() const { return PurgeLast; }
 
         String m_script;
@@ -70,6 +84,12 @@ namespace WebCore {
         Timer<CachedScript> m_decodedDataDeletionTimer;
 #if USE(JSC)        
         mutable OwnPtr<JSC::SourceProviderCache> m_sourceProviderCache;
+        JSC::ParseStatistics m_parseStatistics;
+#if ENABLE(DISK_CACHE)
+        Vector<char> m_cachedMetadata;
+        bool m_sourceProviderCacheChanged;
+        Timer<CachedScript> m_cachedMetadataSaveTimer;
+#endif
 #endif
     };
 }
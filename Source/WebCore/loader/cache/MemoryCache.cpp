@@ -174,6 +174,11 @@ void MemoryCache::revalidationFailed(CachedResource* revalidatingResource)
     revalidatingResource->clearResourceToRevalidate();
 }
 
+CachedResource* MemoryCache::resourceInMemoryForURL(const KURL& resourceURL) const
+{
+    return m_resources.get(removeFragmentIdentifierIfNeeded(resourceURL));
+}
+
 CachedResource* MemoryCache::resourceForURL(const KURL& resourceURL,CachedResource::Type type,const String& charset)
 {
     if (disabled())
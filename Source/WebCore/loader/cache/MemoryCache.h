@@ -115,6 +115,8 @@ public:
     };
     
     CachedResource* resourceForURL(const KURL& url, CachedResource::Type type,const String& charset);
+    // Unlike resourceForURL(), never loads the resource from the disk cache.
+    CachedResource* resourceInMemoryForURL(const KURL&) const;
     
     bool add(CachedResource* resource);
     void remove(CachedResource* resource) { evict(resource); }
@@ -12,6 +12,7 @@
 
 #include "HttpCache.h"
 #include "CachedResource.h"
+#include "CachedScript.h"
 #include "SharedBuffer.h"
 #include "cache_type.h"
 #include <curl/curl.h>
@@ -130,13 +131,18 @@ namespace disk_cache{
 // disk cache entry data indices..
 enum {
   mResponseInfoIndex,
-  mResponseContentIndex
+  mResponseContentIndex,
+  mMetadataIndex
 };
 
+// The largest piece of a stream written with the backend locked.
+static const unsigned writeChunkSize = 16 * 1024;
+
 //HttpCache::ActiveEntriesMap HttpCache::m_activeEntries;
 
 HttpCache::HttpCache(unsigned capacity, const char* cacheDir) : 
-    m_path(cacheDir),m_maxBytes(capacity),m_cacheType(net::DISK_CACHE)
+    m_path(cacheDir),m_maxBytes(capacity),m_cacheType(net::DISK_CACHE),
+    m_currentWrite(0), m_pendingWriteBytes(0), m_stopWriter(false), m_writerSuspended(false), m_writerThread(0)
 {
     // init backend, so to load map file
     m_backend = CreateCacheBackend(m_path, true, m_maxBytes, m_cacheType);
@@ -147,6 +153,9 @@ HttpCache::~HttpCache()
     static int k, l;
 
     DISKCACHE_DEBUG_OUTPUT("~HttpCache");
+    // Let the writer finish what is queued, the entries are still wanted.
+    stopWriter();
+
     // If we have any active entries remaining, then we need to deactivate them.
     while (!m_activeEntries.isEmpty()) {
         ActiveEntry* entry = m_activeEntries.begin()->second;
@@ -268,48 +277,288 @@ HttpCache::ActiveEntry* HttpCache::findDiskEntry(const WTF::String& key)
     return ActivateEntry(key, disk_entry);
 }
 
-bool HttpCache::writeEntry(Entry* entry, WebCore::CachedResource* resource)
+// Runs on the writer thread. The backend is not thread safe, so every call
+// into it takes m_backendMutex, but only for one chunk of the body at a
+// time: the main thread waits for at most one chunk of flash I/O.
+bool HttpCache::writeEntry(PendingWrite* write)
 {
-    if(!entry)
-        return false;
+    if (write->metadataOnly)
+        return writeMetadata(write);
 
-    //get HTTP header
-    resource->setHttpHeader();
-    const WTF::String header = resource->httpHeader();
-    
-    char* data = (char*)malloc(header.length());
-    for (unsigned int i = 0; i < header.length(); ++i )
-        data[i] = header[i];
-
-    //const char* buf = header.utf8().data();
-    //entry->WriteData(mResponseInfoIndex, 0, header.utf8().data(), header.length(), NULL, true);   
-    int rv;
-    if ((rv = entry->WriteData(mResponseInfoIndex, 0, data, header.length(), NULL, true)) < 0)
+    Entry* entry = NULL;
     {
-        DISKCACHE_DEBUG_OUTPUT("WriteData header error");
-        free(data);
+        MutexLocker lock(m_backendMutex);
+        if (write->replace)
+            backend()->DoomEntry(write->key);
+
+        if (!backend()->CreateEntry(write->key, &entry))
+            return false;
+
+        if (entry->WriteData(mResponseInfoIndex, 0, write->header.data(), write->header.length(), NULL, true) < 0)
+        {
+            DISKCACHE_DEBUG_OUTPUT("WriteData header error");
+            entry->Doom();
+            entry->Close();
+            return false;
+        }
+    }
+
+    // The entry keeps a reference of its own, the main thread may doom it
+    // between two chunks.
+    if (!writeStream(write, entry, mResponseContentIndex))
+    {
+        DISKCACHE_DEBUG_OUTPUT("WriteData body error");
+        MutexLocker lock(m_backendMutex);
+        entry->Doom();
+        entry->Close();
         return false;
     }
 
-    free(data);
-   
-    //get HTTP body
-    WebCore::SharedBuffer* body = resource->data();
-    if (!body) {
+    MutexLocker lock(m_backendMutex);
+    entry->Close();
+    DISKCACHE_DEBUG_OUTPUT("write entry end for %s", write->key.utf8().data());
+    return true;
+}
+
+// Runs on the writer thread. The entry may have been evicted or replaced
+// meanwhile, then the metadata is simply dropped.
+bool HttpCache::writeMetadata(PendingWrite* write)
+{
+    Entry* entry = NULL;
+    {
+        MutexLocker lock(m_backendMutex);
+        if (!backend()->OpenEntry(write->key, &entry))
+            return false;
+    }
+
+    bool ok = writeStream(write, entry, mMetadataIndex);
+    if (!ok)
+        DISKCACHE_DEBUG_OUTPUT("WriteData metadata error");
+
+    MutexLocker lock(m_backendMutex);
+    entry->Close();
+    return ok;
+}
+
+// Writes the body of write to one stream of entry, segment by segment; the
+// body is never flattened. Stops early once the write is cancelled.
+bool HttpCache::writeStream(PendingWrite* write, Entry* entry, int index)
+{
+    const char* segment;
+    unsigned offset = 0;
+    bool truncate = true;
+    while (unsigned length = write->body->getSomeData(segment, offset)) {
+        if (length > writeChunkSize)
+            length = writeChunkSize;
+
+        {
+            MutexLocker lock(m_writeMutex);
+            if (write->cancelled)
+                return false;
+        }
+
+        MutexLocker lock(m_backendMutex);
+        if (entry->WriteData(index, offset, segment, length, NULL, truncate) < 0)
+            return false;
+        offset += length;
+        truncate = false;
+    }
+    // an empty stream still truncates the old content
+    if (truncate) {
+        MutexLocker lock(m_backendMutex);
+        return entry->WriteData(index, 0, 0, 0, NULL, true) >= 0;
+    }
+    return true;
+}
+
+// Takes a snapshot of the resource on the main thread.
+bool HttpCache::queueWrite(const WTF::String& key, WebCore::CachedResource* resource, bool replace)
+{
+    WebCore::SharedBuffer* data = resource->data();
+    if (!data) {
         DISKCACHE_DEBUG_OUTPUT("body is null");
         return false;
     }
 
-    if ( (rv = entry->WriteData(mResponseContentIndex, 0, body->data(), body->size(), NULL, true) ) < 0 )
-    {
-        DISKCACHE_DEBUG_OUTPUT("WriteData body error");
+    if (!hasRoomForWrite(data->size())) {
+        DISKCACHE_DEBUG_OUTPUT("write queue full, dropping %s", key.utf8().data());
         return false;
     }
 
-    //entry->Close();
-    DISKCACHE_DEBUG_OUTPUT("write entry end for %s", resource->url().utf8().data());
+    //get HTTP header
+    resource->setHttpHeader();
+
+    return addEntry(key, resource->httpHeader().latin1(), data, replace);
+}
+
+// The body is copied into a buffer only the writer thread uses, the
+// caller's buffer may be flattened or purged at any time.
+bool HttpCache::addEntry(const WTF::String& key, const WTF::CString& header, WebCore::SharedBuffer* body, bool replace)
+{
+    if (!body || !hasRoomForWrite(body->size()))
+        return false;
+
+    PendingWrite* write = new PendingWrite;
+    write->key = key.crossThreadString();
+    write->header = header;
+    write->body = WebCore::SharedBuffer::create();
+    const char* segment;
+    unsigned offset = 0;
+    while (unsigned length = body->getSomeData(segment, offset)) {
+        write->body->append(segment, length);
+        offset += length;
+    }
+    write->replace = replace;
+    write->metadataOnly = false;
+    write->cancelled = false;
+
+    return queuePendingWrite(write);
+}
+
+bool HttpCache::hasRoomForWrite(unsigned bytes)
+{
+    MutexLocker lock(m_writeMutex);
+    return m_pendingWrites.size() < maxPendingWrites && m_pendingWriteBytes + bytes <= maxPendingWriteBytes;
+}
+
+bool HttpCache::queuePendingWrite(PendingWrite* write)
+{
+    MutexLocker lock(m_writeMutex);
+    // checked again, the caller did not hold the lock
+    if (m_pendingWrites.size() >= maxPendingWrites || m_pendingWriteBytes + write->body->size() > maxPendingWriteBytes) {
+        delete write;
+        return false;
+    }
+    if (!m_writerThread) {
+        m_writerThread = createThread(writerThreadStart, this, "WebCore: DiskCache");
+        if (!m_writerThread) {
+            delete write;
+            return false;
+        }
+    }
+    m_pendingWriteBytes += write->body->size();
+    m_pendingWrites.append(write);
+    m_writeCondition.signal();
     return true;
+}
+
+// Drops queued writes of key. A write already in progress is doomed by the
+// writer once it is done.
+void HttpCache::cancelWrites(const WTF::String& key)
+{
+    MutexLocker lock(m_writeMutex);
+    Deque<PendingWrite*>::iterator it = m_pendingWrites.begin();
+    while (it != m_pendingWrites.end()) {
+        PendingWrite* write = *it;
+        if (write->key == key) {
+            m_pendingWriteBytes -= write->body->size();
+            m_pendingWrites.remove(it);
+            delete write;
+            it = m_pendingWrites.begin();
+        } else
+            ++it;
+    }
+    if (m_currentWrite && m_currentWrite->key == key)
+        m_currentWrite->cancelled = true;
+}
+
+void HttpCache::cancelAllWrites()
+{
+    MutexLocker lock(m_writeMutex);
+    while (!m_pendingWrites.isEmpty())
+        delete m_pendingWrites.takeFirst();
+    m_pendingWriteBytes = 0;
+    if (m_currentWrite)
+        m_currentWrite->cancelled = true;
+}
+
+void HttpCache::suspendWriter()
+{
+    MutexLocker lock(m_writeMutex);
+    m_writerSuspended = true;
+}
+
+void HttpCache::resumeWriter()
+{
+    MutexLocker lock(m_writeMutex);
+    m_writerSuspended = false;
+    m_writeCondition.signal();
+}
+
+size_t HttpCache::pendingWriteCount()
+{
+    MutexLocker lock(m_writeMutex);
+    return m_pendingWrites.size();
+}
+
+unsigned HttpCache::pendingWriteBytes()
+{
+    MutexLocker lock(m_writeMutex);
+    return m_pendingWriteBytes;
+}
+
+void HttpCache::stopWriter()
+{
+    {
+        MutexLocker lock(m_writeMutex);
+        if (!m_writerThread)
+            return;
+        m_stopWriter = true;
+        m_writeCondition.signal();
+    }
+    waitForThreadCompletion(m_writerThread, 0);
+    m_writerThread = 0;
+}
+
+void* HttpCache::writerThreadStart(void* data)
+{
+    static_cast<HttpCache*>(data)->writerThread();
+    return 0;
+}
+
+void HttpCache::writerThread()
+{
+    bool written = false;
+    while (true) {
+        {
+            MutexLocker lock(m_writeMutex);
+            while ((m_pendingWrites.isEmpty() || m_writerSuspended) && !m_stopWriter && !written)
+                m_writeCondition.wait(m_writeMutex);
+            if (!m_pendingWrites.isEmpty() && (!m_writerSuspended || m_stopWriter)) {
+                m_currentWrite = m_pendingWrites.takeFirst();
+                m_pendingWriteBytes -= m_currentWrite->body->size();
+            }
+        }
+
+        if (!m_currentWrite) {
+            // The queue ran empty, write the index back once for the
+            // whole batch rather than once per entry.
+            if (written) {
+                MutexLocker lock(m_backendMutex);
+                backend()->FlushIndex();
+                written = false;
+                continue;
+            }
+            // m_stopWriter is set and there is nothing left to write
+            break;
+        }
 
+        bool ok = writeEntry(m_currentWrite);
+        written = written || ok;
+
+        PendingWrite* write;
+        {
+            MutexLocker lock(m_writeMutex);
+            write = m_currentWrite;
+            m_currentWrite = 0;
+        }
+        // removed from the cache while it was being written
+        if (ok && write->cancelled) {
+            MutexLocker lock(m_backendMutex);
+            backend()->DoomEntry(write->key);
+        }
+        delete write;
+    }
 }
 
 #ifdef EXPOSE_COMPILE_WARNING
@@ -325,63 +574,73 @@ static void dumpString(const WTF::String& str)
 }
 #endif
 
-// Parse Entry to CachedResource
-// We need 
-bool HttpCache::parseEntryToCachedResource(const String& responseURL,Entry* disk_entry, WebCore::CachedResource* resource)
+// Reads the streams of a disk entry, with m_backendMutex held.
+bool HttpCache::readDiskEntry(Entry* disk_entry, WTF::String& header, RefPtr<WebCore::SharedBuffer>& body, Vector<char>* metadata)
 {
     int size = disk_entry->GetDataSize(mResponseInfoIndex);
-
-    char* buffer = (char*)malloc(size);
-    int rv = disk_entry->ReadData(mResponseInfoIndex, 0, buffer, size, NULL);
-
-    if (rv != size) {
+    Vector<char> buffer(size);
+    if (disk_entry->ReadData(mResponseInfoIndex, 0, buffer.data(), size, NULL) != size) {
         DISKCACHE_DEBUG_OUTPUT("readData of response header failed\n");
-        free(buffer);
         return false;
     }
-
-    //set m_response in resource
-    WTF::String header(buffer, size);
-
-    free(buffer);
-
-    WebCore::setResponseFromDiskCache(responseURL, header, resource);
+    header = WTF::String(buffer.data(), size);
 
     size = disk_entry->GetDataSize(mResponseContentIndex);
-
-    buffer = (char*)malloc(size);
-
-    rv = disk_entry->ReadData(mResponseContentIndex, 0, buffer, size, NULL);
-    if (rv!=size)
+    buffer.resize(size);
+    if (disk_entry->ReadData(mResponseContentIndex, 0, buffer.data(), size, NULL) != size)
     {
         DISKCACHE_DEBUG_OUTPUT("readData of response content failed");
-        free(buffer);
         return false;
     }
-    //设置resource的data
-    RefPtr<WebCore::SharedBuffer> body = WebCore::SharedBuffer::create(buffer, size);
-
-    WebCore::memoryCache()->resourceAccessed(resource);
-    //resource->increaseAccessCount();
-
-    resource->data(body, true);
+    body = WebCore::SharedBuffer::adoptVector(buffer);
+
+    if (metadata) {
+        // the metadata is optional, a failed read only costs the parse time
+        size = disk_entry->GetDataSize(mMetadataIndex);
+        metadata->resize(size > 0 ? size : 0);
+        if (size > 0 && disk_entry->ReadData(mMetadataIndex, 0, metadata->data(), size, NULL) != size)
+            metadata->clear();
+    }
+    return true;
+}
 
-    free(buffer);
+// A resource is looked up again before the writer got to it, for example
+// by a second view. The snapshot is copied, the writer thread may be
+// reading it at the same time.
+bool HttpCache::readPendingEntry(const WTF::String& key, WTF::String& header, RefPtr<WebCore::SharedBuffer>& body)
+{
+    MutexLocker lock(m_writeMutex);
+    PendingWrite* found = 0;
+    for (Deque<PendingWrite*>::iterator it = m_pendingWrites.begin(); it != m_pendingWrites.end(); ++it) {
+        if ((*it)->key == key && !(*it)->metadataOnly)
+            found = *it;
+    }
+    // the current write is older than anything still queued
+    if (!found && m_currentWrite && m_currentWrite->key == key && !m_currentWrite->metadataOnly && !m_currentWrite->cancelled)
+        found = m_currentWrite;
+    if (!found)
+        return false;
 
-    DISKCACHE_DEBUG_OUTPUT("parseEntryToCachedResource end");
+    header = WTF::String(found->header.data(), found->header.length());
+    body = WebCore::SharedBuffer::create();
+    const char* segment;
+    unsigned offset = 0;
+    while (unsigned length = found->body->getSomeData(segment, offset)) {
+        body->append(segment, length);
+        offset += length;
+    }
     return true;
 }
 
-
-//
-// Search the cached resource according to url.
-// Return false if not found
-//
-bool HttpCache::cachedResource(const WTF::String& url, WebCore::CachedResource* resource)
+bool HttpCache::readEntry(const WTF::String& key, WTF::String& header, RefPtr<WebCore::SharedBuffer>& body, Vector<char>* metadata)
 {
-    //generate key
-    //key is the url for normal
-    const WTF::String key = generateCacheKey(url);
+    if (readPendingEntry(key, header, body)) {
+        if (metadata)
+            metadata->clear();
+        return true;
+    }
+
+    MutexLocker lock(m_backendMutex);
 
     //search entry
     //Firstly, search from m_activeEntries
@@ -397,10 +656,42 @@ bool HttpCache::cachedResource(const WTF::String& url, WebCore::CachedResource*
         }
     }
 
+    return readDiskEntry(entry->disk_entry, header, body, metadata);
+}
+
+//
+// Search the cached resource according to url.
+// Return false if not found
+//
+bool HttpCache::cachedResource(const WTF::String& url, WebCore::CachedResource* resource)
+{
+    //generate key
+    //key is the url for normal
+    const WTF::String key = generateCacheKey(url);
+
+    WTF::String header;
+    RefPtr<WebCore::SharedBuffer> body;
+    Vector<char> metadata;
+    if (!readEntry(key, header, body, &metadata))
+        return false;
+
     if (!resource)
         return false;
 
-    return parseEntryToCachedResource(key, entry->disk_entry, resource);
+    //set m_response in resource
+    //to avoid diskcache url combination incorrect, so we add responseURL to make sure url is right.
+    WebCore::setResponseFromDiskCache(key, header, resource);
+
+    if (resource->type() == WebCore::CachedResource::Script && !metadata.isEmpty())
+        static_cast<WebCore::CachedScript*>(resource)->setCachedMetadata(metadata);
+
+    WebCore::memoryCache()->resourceAccessed(resource);
+    //resource->increaseAccessCount();
+
+    resource->data(body.release(), true);
+
+    DISKCACHE_DEBUG_OUTPUT("cachedResource end");
+    return true;
 }
 
 //
@@ -412,24 +703,12 @@ bool HttpCache::addCachedResource(WebCore::CachedResource* resource)
 
     DISKCACHE_DEBUG_OUTPUT("##url:%s##\n", key.utf8().data());
 
-    //call backend to create an entry
-    Entry* disk_entry = NULL;
-    if (!backend()->CreateEntry(key, &disk_entry))
-        return false;
-
-    if (!writeEntry(disk_entry, resource))
+    if (!queueWrite(key, resource, false))
     {
-        DISKCACHE_DEBUG_OUTPUT("WriteEntry failed\n");
-        backend()->DoomEntry(key);
+        DISKCACHE_DEBUG_OUTPUT("queueWrite failed\n");
         return false;
     }
 
-    //add ActiveEntry to m_activeEntries
-    if (!ActivateEntry(key, disk_entry))
-    {
-        DISKCACHE_DEBUG_OUTPUT("Activate Entry error");
-    }
-
     return true;
 }
 
@@ -438,30 +717,33 @@ bool HttpCache::updateCachedResource(WebCore::CachedResource* resource)
     if(!resource)
         return false;
 
-    Entry* disk_entry = NULL;
     const WTF::String key = generateCacheKey(resource->url());
 
-    ActiveEntry* active_entry = findActiveEntry(key);
-    if (!active_entry)
+    // the new data supersedes anything still queued for this entry
+    cancelWrites(key);
+
     {
-        DISKCACHE_DEBUG_OUTPUT("key:%s\n", key.utf8().data());
-        active_entry = findDiskEntry(key);
+        MutexLocker lock(m_backendMutex);
+        // the writer replaces the entry, so close our handle to it first
+        ActiveEntry* active_entry = findActiveEntry(key);
         if (!active_entry)
         {
-            DISKCACHE_DEBUG_OUTPUT("not find in disk");
-            return false;
-
-        } else {
-            disk_entry = active_entry->disk_entry;
-        }
-
-    } else {
-        disk_entry = active_entry->disk_entry;
+            DISKCACHE_DEBUG_OUTPUT("key:%s\n", key.utf8().data());
+            Entry* disk_entry = NULL;
+            if (!backend()->OpenEntry(key, &disk_entry))
+            {
+                DISKCACHE_DEBUG_OUTPUT("not find in disk");
+                return false;
+            }
+            disk_entry->Close();
+        } else
+            deactivateEntry(active_entry);
     }
 
-    if (!writeEntry(disk_entry, resource))
+    if (!queueWrite(key, resource, true))
     {
-        DISKCACHE_DEBUG_OUTPUT("WriteEntry failed");
+        DISKCACHE_DEBUG_OUTPUT("queueWrite failed");
+        MutexLocker lock(m_backendMutex);
         backend()->DoomEntry(key);
         return false;
     }
@@ -470,6 +752,26 @@ bool HttpCache::updateCachedResource(WebCore::CachedResource* resource)
     return true;
 }
 
+bool HttpCache::setCachedMetadata(WebCore::CachedResource* resource, const Vector<char>& metadata)
+{
+    if (!resource || metadata.isEmpty())
+        return false;
+
+    if (!hasRoomForWrite(metadata.size())) {
+        DISKCACHE_DEBUG_OUTPUT("write queue full, dropping metadata");
+        return false;
+    }
+
+    PendingWrite* write = new PendingWrite;
+    write->key = generateCacheKey(resource->url()).crossThreadString();
+    write->body = WebCore::SharedBuffer::create(metadata.data(), metadata.size());
+    write->replace = false;
+    write->metadataOnly = true;
+    write->cancelled = false;
+
+    return queuePendingWrite(write);
+}
+
 bool HttpCache::removeCachedResource(WebCore::CachedResource* resource)
 {
     if(!resource) {
@@ -479,6 +781,9 @@ bool HttpCache::removeCachedResource(WebCore::CachedResource* resource)
 
     //generate key
     const WTF::String key = generateCacheKey(resource->url());
+    cancelWrites(key);
+
+    MutexLocker lock(m_backendMutex);
     ActiveEntriesMap::iterator it = m_activeEntries.find(key);
     if (it == m_activeEntries.end()) {
         if(backend())
@@ -505,16 +810,21 @@ bool HttpCache::removeCachedResource(WebCore::CachedResource* resource)
 
 bool HttpCache::setCacheCapacity(unsigned size)
 {
+    MutexLocker lock(m_backendMutex);
     return backend()->SetMaxSize(size);
 }
 
 bool HttpCache::cacheCapacity(unsigned* size)
 {
+    MutexLocker lock(m_backendMutex);
     return backend()->GetMaxSize((int *)size);
 }
 
 bool HttpCache::clearCache()
 {
+    cancelAllWrites();
+
+    MutexLocker lock(m_backendMutex);
     while (!m_activeEntries.isEmpty()) {
         ActiveEntry* entry = m_activeEntries.begin()->second;
         deactivateEntry(entry);
@@ -524,6 +834,7 @@ bool HttpCache::clearCache()
 
 void HttpCache::getUsedCapacity(unsigned int* size)
 {
+    MutexLocker lock(m_backendMutex);
     if (size)
         *size = backend()->GetUsedSize();
 }
@@ -6,9 +6,13 @@
 #include "disk_cache.h"
 #include "PlatformString.h"
 #include "CachedResource.h"
+#include "SharedBuffer.h"
 
+#include <wtf/Deque.h>
 #include <wtf/HashMap.h>
 #include <wtf/HashSet.h>
+#include <wtf/Threading.h>
+#include <wtf/text/CString.h>
 
 namespace disk_cache{
 
@@ -26,6 +30,7 @@ public:
     bool cachedResource(const WTF::String& url, WebCore::CachedResource* resource);
 
     // add WebCore::CachedResource
+    // The entry is written by a background thread, false means it was not queued.
     bool addCachedResource(WebCore::CachedResource* resource);
 
     // remove WebCore::CachedResource
@@ -33,6 +38,11 @@ public:
 
     bool updateCachedResource(WebCore::CachedResource* resource);
 
+    // Stores data derived from the resource, for example the function
+    // cache of a script, next to its entry. It is dropped together with
+    // the entry when the resource changes. Written by the background thread.
+    bool setCachedMetadata(WebCore::CachedResource* resource, const Vector<char>& metadata);
+
     bool setCacheCapacity(unsigned);
 
     bool cacheCapacity(unsigned* size);
@@ -41,6 +51,23 @@ public:
 
     void getUsedCapacity(unsigned int* size);
 
+    // Writes beyond these limits are dropped rather than queued, so a burst of
+    // loads can not pile up unbounded copies of their data.
+    static const size_t maxPendingWrites = 32;
+    static const unsigned maxPendingWriteBytes = 4 * 1024 * 1024;
+
+    // Queues an entry for the writer thread, false means it was not queued.
+    bool addEntry(const WTF::String& key, const WTF::CString& header, WebCore::SharedBuffer* body, bool replace = false);
+
+    // Reads an entry back, from the write queue while it is still queued.
+    bool readEntry(const WTF::String& key, WTF::String& header, RefPtr<WebCore::SharedBuffer>& body, Vector<char>* metadata = 0);
+
+    // Holds queued writes back, used by the tests to fill the queue.
+    void suspendWriter();
+    void resumeWriter();
+    size_t pendingWriteCount();
+    unsigned pendingWriteBytes();
+
 private:
     struct ActiveEntry {
         Entry* disk_entry;
@@ -69,11 +96,33 @@ private:
     const WTF::String generateCacheKey(const WTF::String& url);
 
     ActiveEntry* findDiskEntry(const WTF::String& key);
-    bool writeEntry(Entry* entry, WebCore::CachedResource* resource);
-
 
-    //to avoid diskcache url combination incorrect, so we add responseURL to make sure url is right.
-    bool parseEntryToCachedResource(const String& responseURL, Entry* entry, WebCore::CachedResource* resource);
+    // A snapshot of a resource waiting for the writer thread.
+    struct PendingWrite {
+        WTF::String key;
+        WTF::CString header;
+        RefPtr<WebCore::SharedBuffer> body;
+        bool replace;
+        // only the metadata of an existing entry is written, from body
+        bool metadataOnly;
+        bool cancelled;
+    };
+
+    bool queueWrite(const WTF::String& key, WebCore::CachedResource* resource, bool replace);
+    bool hasRoomForWrite(unsigned bytes);
+    bool queuePendingWrite(PendingWrite* write);
+    void cancelWrites(const WTF::String& key);
+    void cancelAllWrites();
+    void stopWriter();
+
+    static void* writerThreadStart(void*);
+    void writerThread();
+    bool writeEntry(PendingWrite* write);
+    bool writeMetadata(PendingWrite* write);
+    bool writeStream(PendingWrite* write, Entry* entry, int index);
+
+    bool readPendingEntry(const WTF::String& key, WTF::String& header, RefPtr<WebCore::SharedBuffer>& body);
+    bool readDiskEntry(Entry* entry, WTF::String& header, RefPtr<WebCore::SharedBuffer>& body, Vector<char>* metadata);
 
     Backend* backend(){return m_backend;}
 
@@ -81,6 +130,21 @@ private:
     int m_maxBytes;
     net::CacheType m_cacheType;
     Backend* m_backend;
+
+    // The backend is not thread safe, it is used by the main thread and the
+    // writer thread under m_backendMutex. The writer takes it once per chunk
+    // of data, never for a whole entry.
+    Mutex m_backendMutex;
+
+    // Writes queued for the writer thread, guarded by m_writeMutex.
+    Mutex m_writeMutex;
+    ThreadCondition m_writeCondition;
+    Deque<PendingWrite*> m_pendingWrites;
+    PendingWrite* m_currentWrite;
+    unsigned m_pendingWriteBytes;
+    bool m_stopWriter;
+    bool m_writerSuspended;
+    ThreadIdentifier m_writerThread;
 };
 //#if CACHE_DEBUG
 #ifdef EXPOSE_COMPILE_WARNING
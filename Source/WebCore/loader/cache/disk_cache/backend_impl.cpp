@@ -678,6 +678,12 @@ void BackendImpl::GetStats(StatsItems* stats) {
 */
 // ------------------------------------------------------------------------
 
+void BackendImpl::FlushIndex()
+{
+    if (index_)
+        index_->Flush();
+}
+
 bool BackendImpl::SetMaxSize(int max_bytes)
 {
 //  COMPILE_ASSERT(sizeof(max_bytes) == sizeof(max_size_), unsupported_int_model);
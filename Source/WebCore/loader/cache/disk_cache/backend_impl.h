@@ -96,6 +96,8 @@ public:
         return (unsigned int)(data_->header.num_bytes);
     }
 
+    virtual void FlushIndex();
+
   // Sets the cache type for this backend.
     void SetType(net::CacheType type);
 
@@ -36,6 +36,9 @@ class MappedFile : public File {
         bool Load(const FileBlock* block);
         bool Store(const FileBlock* block);
 
+        // Starts writing the mapped view back to the file, without waiting.
+        bool Flush();
+
     protected:
         virtual ~MappedFile();
 
@@ -73,6 +73,8 @@ class Backend {
 
         virtual unsigned int GetUsedSize() = 0;
 
+        // Schedules the index to be written back to disk.
+        virtual void FlushIndex() = 0;
 
 };
 
@@ -94,4 +94,11 @@ bool MappedFile::Store(const FileBlock* block)
     return Write(block->buffer(), block->size(), offset);
 }
 
+bool MappedFile::Flush()
+{
+    if (!buffer_)
+        return false;
+    return !WebCore::msyncFile(buffer_, view_size_, MS_ASYNC);
+}
+
 }  // namespace disk_cache
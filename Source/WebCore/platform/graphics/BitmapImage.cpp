@@ -103,10 +103,15 @@ void BitmapImage::destroyDecodedDataIfNecessary(bool destroyAll)
 void BitmapImage::destroyMetadataAndNotify(int framesCleared)
 {
     m_isSolidColor = false;
+
+    // Platform data may hold decoded pixels of its own, counted in m_decodedSize.
+    unsigned platformBytes = m_decodedSize;
     invalidatePlatformData();
+    platformBytes -= m_decodedSize;
 
     int deltaBytes = framesCleared * -frameBytes(m_size);
     m_decodedSize += deltaBytes;
+    deltaBytes -= platformBytes;
     if (framesCleared > 0) {
         deltaBytes -= m_decodedPropertiesSize;
         m_decodedPropertiesSize = 0;
@@ -156,6 +156,12 @@ public:
     virtual GdkPixbuf* getGdkPixbuf();
 #endif
 
+#if PLATFORM(MG)
+    // The srcRect part of the current frame scaled to size, cached across
+    // paints and counted in decodedSize().
+    PassRefPtr<MDBitmap> scaledFrame(const IntRect& srcRect, const IntSize& size);
+#endif
+
     virtual NativeImagePtr nativeImageForCurrentFrame() { return frameAtIndex(currentFrame()); }
     bool frameHasAlphaAtIndex(size_t); 
 
@@ -271,6 +277,10 @@ protected:
     mutable RetainPtr<CFDataRef> m_tiffRep; // Cached TIFF rep for frame 0.  Only built lazily if someone queries for one.
 #endif
 
+#if PLATFORM(MG)
+    MDScaledBitmapCache m_scaledBitmaps; // Scaled copies of complete frames, dropped in invalidatePlatformData().
+#endif
+
     Color m_solidColor;  // If we're a 1x1 solid color, this is the color to use to fill.
     bool m_isSolidColor;  // Whether or not we are a 1x1 solid image.
     bool m_checkedForSolidColor; // Whether we've checked the frame for solid color.
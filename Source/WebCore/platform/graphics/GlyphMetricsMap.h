@@ -102,6 +102,15 @@ template<> inline FloatRect GlyphMetricsMap<FloatRect>::unknownMetrics()
     return FloatRect(0, 0, cGlyphSizeUnknown, cGlyphSizeUnknown);
 }
 
+#if PLATFORM(MG)
+const unsigned cGlyphValueUnknown = 0xFFFFFFFF;
+
+template<> inline unsigned GlyphMetricsMap<unsigned>::unknownMetrics()
+{
+    return cGlyphValueUnknown;
+}
+#endif
+
 template<class T> typename GlyphMetricsMap<T>::GlyphMetricsPage* GlyphMetricsMap<T>::locatePageSlowCase(unsigned pageNumber)
 {
     GlyphMetricsPage* page;
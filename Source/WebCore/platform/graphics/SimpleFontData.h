@@ -119,6 +119,11 @@ public:
     float syntheticBoldOffset() const { return m_syntheticBoldOffset; }
 #endif
 
+#if PLATFORM(MG)
+    // The MiniGUI Glyph32 value of glyph in this font.
+    unsigned glyphValue(Glyph) const;
+#endif
+
     Glyph spaceGlyph() const { return m_spaceGlyph; }
     bool isZeroWidthSpaceGlyph(Glyph glyph) const { return glyph == m_zeroWidthSpaceGlyph && glyph; }
 
@@ -211,6 +216,9 @@ private:
 
     mutable OwnPtr<GlyphMetricsMap<FloatRect> > m_glyphToBoundsMap;
     mutable GlyphMetricsMap<float> m_glyphToWidthMap;
+#if PLATFORM(MG)
+    mutable GlyphMetricsMap<unsigned> m_glyphToValueMap;
+#endif
 
     bool m_treatAsFixedPitch;
 
@@ -25,6 +25,8 @@
 #include "Gradient.h"
 #include "ImageBuffer.h"
 #include "Pattern.h"
+#include <wtf/Vector.h>
+
 #define SYNTHETIC_OBLIQUE_ANGLE 14
 
 #if ENABLE(CAIRO_MG)
@@ -224,6 +226,32 @@ static inline void cairoDrawGlyphs(GraphicsContext* context, const SimpleFontDat
 
 #endif
 
+// Draws glyphs of the MiniGUI font selected into hdc. The glyph buffer holds
+// glyph IDs, not text, so they are drawn by their cached Glyph32 values.
+// MiniGUI places the glyphs of a DrawGlyphString call at the font's own
+// advances, so a run goes on while WebCore laid the glyphs out the same way
+// and is drawn with one call. A glyph moved by letter spacing or
+// justification ends the run, the next one starts where WebCore put it.
+static void drawGlyphRun(HDC hdc, const SimpleFontData* font, const GlyphBuffer& glyphBuffer,
+        int from, int numGlyphs, int x, int y)
+{
+    const GlyphBufferGlyph* glyphs = glyphBuffer.glyphs(from);
+    Vector<Glyph32, 256> values;
+    int runX = x;
+    for (int i = 0; i < numGlyphs; i++) {
+        int advance = static_cast<int>(glyphBuffer.advanceAt(from + i));
+        values.append(font->glyphValue(glyphs[i]));
+        x += advance;
+        if (advance != static_cast<int>(font->widthForGlyph(glyphs[i]))) {
+            DrawGlyphString(hdc, runX, y, values.data(), values.size(), NULL, NULL);
+            values.clear();
+            runX = x;
+        }
+    }
+    if (!values.isEmpty())
+        DrawGlyphString(hdc, runX, y, values.data(), values.size(), NULL, NULL);
+}
+
 void Font::drawGlyphs(GraphicsContext* context, const SimpleFontData* font, 
         const GlyphBuffer& glyphBuffer, int from, int numGlyphs, 
         const FloatPoint& point) const
@@ -267,13 +295,7 @@ void Font::drawGlyphs(GraphicsContext* context, const SimpleFontData* font,
     int x = (int)ceil(xPoint.x());
     int y = (int)ceil(xPoint.y());
 
-    for (int i = 0; i < numGlyphs; i++) {
-
-        Glyph32 glyph = GetGlyphValue(curFont, 
-                (const char*)glyphBuffer.glyphs(from + i), 2/*sizeof(UChar)*/, NULL, 0);
-        DrawGlyph(hdc, x, y, glyph, NULL, NULL);
-        x += glyphBuffer.advanceAt(from + i);
-    };
+    drawGlyphRun(hdc, font, glyphBuffer, from, numGlyphs, x, y);
 
     SelectFont(hdc, oldFont);
     SetTextColor(hdc, oldFgColor);
@@ -32,6 +32,8 @@
 #include <cairo-minigui.h>
 #include "ContextShadow.h"
 #include "GraphicsContextCairo.h"
+#include "PlatformContextCairo.h"
+#include <wtf/OwnPtr.h>
 #endif
 
 namespace WebCore {
@@ -55,6 +57,14 @@ public:
 #if ENABLE(CAIRO_MG)
     ContextShadow shadow;
     Vector<ContextShadow> shadowStack;
+
+    // The cairo context handed out by newCairoContext(), kept for the
+    // lifetime of this context as long as it draws into the same DC.
+    void releaseCairoContext();
+
+    OwnPtr<GraphicsContextCairo> cairoContext;
+    HDC cairoDC;
+    bool cairoContextInUse;
 #endif
 };
 
@@ -108,8 +118,21 @@ static inline void fillRectSourceOver(HDC dc, const FloatRect& rect, const Color
 GraphicsContextPlatformPrivate::GraphicsContextPlatformPrivate()
     :  viewdc(0)
     , context(0)
+#if ENABLE(CAIRO_MG)
+    , cairoDC(0)
+    , cairoContextInUse(false)
+#endif
+{
+}
+
+#if ENABLE(CAIRO_MG)
+void GraphicsContextPlatformPrivate::releaseCairoContext()
 {
+    ASSERT(!cairoContextInUse);
+    cairoContext.clear();
+    cairoDC = 0;
 }
+#endif
 
 GraphicsContextPlatformPrivate::~GraphicsContextPlatformPrivate()
 {
@@ -135,24 +158,49 @@ HDC *GraphicsContext::platformContext() const
 }
 
 #if ENABLE(CAIRO_MG) 
+static GraphicsContextCairo* createCairoContext(HDC hdc)
+{
+    RefPtr<cairo_surface_t> mgSurface = cairo_minigui_surface_create(hdc);
+    RefPtr<cairo_t> mgCr = adoptRef(cairo_create(mgSurface.get()));
+    return new GraphicsContextCairo(mgCr.get());
+}
+
+// Text runs, rounded rects and shadows are drawn through cairo many times
+// per paint, so the cairo context over the DC is created once and reused.
+// Every caller gets it in a freshly saved state which deleteCairoContext()
+// restores again.
 GraphicsContextCairo* GraphicsContext::newCairoContext(GraphicsContext *context)
 {
     if (context && !context->isCairoCanvas()) {
+        GraphicsContextPlatformPrivate* data = context->m_data;
         HDC hdc = *(HDC* )context->platformContext();
-        RefPtr<cairo_surface_t> mgSurface = cairo_minigui_surface_create(hdc);
-        RefPtr<cairo_t> mgCr = adoptRef(cairo_create(mgSurface.get()));
-        GraphicsContextCairo *cairoContext = new GraphicsContextCairo(mgCr.get());
-        if (cairoContext) {
-            if (context->fillGradient()) {
-                cairoContext->setFillGradient(context->fillGradient());
-            } else if (context->fillPattern()) {
-                cairoContext->setFillPattern(context->fillPattern());
-            } else {
-                cairoContext->setFillColor(context->fillColor(), ColorSpaceDeviceRGB);
+        GraphicsContextCairo *cairoContext;
+
+        if (data->cairoContextInUse)
+            cairoContext = createCairoContext(hdc);
+        else {
+            if (!data->cairoContext || data->cairoDC != hdc) {
+                data->releaseCairoContext();
+                data->cairoContext = adoptPtr(createCairoContext(hdc));
+                data->cairoDC = hdc;
             }
+            data->cairoContextInUse = true;
+            cairoContext = data->cairoContext.get();
+
+            // MiniGUI may have drawn into the DC since cairo last saw it.
+            cairo_surface_mark_dirty(cairo_get_target(((PlatformContextCairo* )cairoContext->platformContext())->cr()));
+            cairoContext->save();
+        }
 
-            cairoContext->setCTM(context->getCTM());
+        if (context->fillGradient()) {
+            cairoContext->setFillGradient(context->fillGradient());
+        } else if (context->fillPattern()) {
+            cairoContext->setFillPattern(context->fillPattern());
+        } else {
+            cairoContext->setFillColor(context->fillColor(), ColorSpaceDeviceRGB);
         }
+
+        cairoContext->setCTM(context->getCTM());
         return cairoContext;
     }
     return NULL;
@@ -160,7 +208,15 @@ GraphicsContextCairo* GraphicsContext::newCairoContext(GraphicsContext *context)
 
 void GraphicsContext::deleteCairoContext(GraphicsContextCairo *context)
 {
-    if (context && context->isCairoCanvas())
+    if (!context || !context->isCairoCanvas())
+        return;
+
+    if (context == m_data->cairoContext.get()) {
+        ASSERT(m_data->cairoContextInUse);
+        context->restore();
+        cairo_surface_flush(cairo_get_target(((PlatformContextCairo* )context->platformContext())->cr()));
+        m_data->cairoContextInUse = false;
+    } else
         delete context;
 }
 #endif
@@ -723,6 +779,10 @@ void GraphicsContext::endTransparencyLayer()
     }
 
     BitBlt(memdc, 0, 0, 0, 0, m_data->context, 0, 0, 0);
+#if ENABLE(CAIRO_MG)
+    if (m_data->cairoDC == memdc)
+        m_data->releaseCairoContext();
+#endif
     DeleteCompatibleDC(memdc);
 }
 
@@ -22,6 +22,7 @@
 #include "MIMETypeRegistry.h"
 #include <wtf/text/CString.h>
 #include "NotImplemented.h"
+#include "PixelRowsMg.h"
 
 namespace WebCore {
 
@@ -115,20 +116,11 @@ PassRefPtr<ByteArray> getImageData(const IntRect& rect, const ImageBufferData& d
 
     unsigned char* destRows = dataDst + desty * destBytesPerRow + destx * 4;
     for (int y = 0; y < numRows; ++y) {
-        unsigned* row = reinterpret_cast<unsigned*>(dataSrc + stride * (y + originy));
-        for (int x = 0; x < numColumns; x++) {
-            int basex = x * 4;
-            unsigned* pixel = row + x + originx;
-            Color pixelColor;
-            if (multiplied == Unmultiplied)
-                pixelColor = colorFromPremultipliedARGB(*pixel);
-            else
-                pixelColor = Color(*pixel);
-            destRows[basex]     = pixelColor.red();
-            destRows[basex + 1] = pixelColor.green();
-            destRows[basex + 2] = pixelColor.blue();
-            destRows[basex + 3] = pixelColor.alpha();
-        }
+        const unsigned* row = reinterpret_cast<const unsigned*>(dataSrc + stride * (y + originy)) + originx;
+        if (multiplied == Unmultiplied)
+            unpremultiplyRow(row, destRows, numColumns);
+        else
+            swizzleRow(row, destRows, numColumns);
         destRows += destBytesPerRow;
     }
 
@@ -181,19 +173,11 @@ void putImageData(ByteArray*& source, const IntSize& sourceSize, const IntRect&
 
     unsigned char* srcRows = source->data() + originy * srcBytesPerRow + originx * 4;
     for (int y = 0; y < numRows; ++y) {
-        unsigned* row = reinterpret_cast<unsigned*>(dataDst + stride * (y + desty));
-        for (int x = 0; x < numColumns; x++) {
-            int basex = x * 4;
-            unsigned* pixel = row + x + destx;
-            Color pixelColor(srcRows[basex],
-                    srcRows[basex + 1],
-                    srcRows[basex + 2],
-                    srcRows[basex + 3]);
-            if (multiplied == Unmultiplied)
-                *pixel = premultipliedARGBFromColor(pixelColor);
-            else
-                *pixel = pixelColor.rgb();
-        }
+        unsigned* row = reinterpret_cast<unsigned*>(dataDst + stride * (y + desty)) + destx;
+        if (multiplied == Unmultiplied)
+            premultiplyRow(srcRows, row, numColumns);
+        else
+            swizzleRow(srcRows, row, numColumns);
         srcRows += srcBytesPerRow;
     }
 }
@@ -40,10 +40,6 @@ PassRefPtr<WebCore::SharedBuffer> loadResourceIntoBuffer(const char*);
 
 namespace WebCore {
 
-#ifndef MEMDC_FLAG_SRCPIXELALPHA
-#define MEMDC_FLAG_SRCPIXELALPHA MEMDC_FLAG_NONE
-#endif
-
 bool FrameData::clear(bool clearMetadata)
 {
     if (clearMetadata)
@@ -98,6 +94,66 @@ void BitmapImage::initPlatformData()
 
 void BitmapImage::invalidatePlatformData()
 {
+    // Callers notify the observer, this is also reached from the destructor.
+    m_decodedSize -= m_scaledBitmaps.clear();
+}
+
+#if ENABLE(HIGHQUALITYZOOM)
+static const int imageScalerType = BITMAP_SCALER_BILINEAR;
+#else
+static const int imageScalerType = 0;
+#endif
+
+// Returns the srcRect part of source stretched to size.
+static PassRefPtr<MDBitmap> scaleBitmap(MDBitmap* source, const IntRect& srcRect, const IntSize& size)
+{
+    RefPtr<MDBitmap> scaled = MDBitmap::create(size.width(), size.height(), source->hasAlpha());
+    if (!scaled || !scaled->bytes())
+        return 0;
+
+    HDC srcDC = source->createMemDC(true);
+    if (srcDC == HDC_INVALID)
+        return 0;
+    HDC scaledDC = scaled->createMemDC(true);
+    if (scaledDC == HDC_INVALID) {
+        DeleteMemDC(srcDC);
+        return 0;
+    }
+
+#if ENABLE(HIGHQUALITYZOOM)
+    SetBitmapScalerType(scaledDC, imageScalerType);
+#endif
+    StretchBlt(srcDC, srcRect.x(), srcRect.y(), srcRect.width(), srcRect.height(),
+            scaledDC, 0, 0, size.width(), size.height(), 0);
+
+    DeleteMemDC(scaledDC);
+    DeleteMemDC(srcDC);
+    return scaled.release();
+}
+
+PassRefPtr<MDBitmap> BitmapImage::scaledFrame(const IntRect& srcRect, const IntSize& size)
+{
+    RefPtr<MDBitmap> frame = frameAtIndex(m_currentFrame);
+    if (!frame || !frame->bytes())
+        return 0;
+
+    RefPtr<MDBitmap> scaled = m_scaledBitmaps.get(frame.get(), m_currentFrame, srcRect, size, imageScalerType);
+    if (scaled)
+        return scaled.release();
+
+    scaled = scaleBitmap(frame.get(), srcRect, size);
+    // Frames that are still decoding change under us, they are scaled
+    // again on the next paint.
+    if (!scaled || !frameIsCompleteAtIndex(m_currentFrame))
+        return scaled.release();
+
+    int deltaBytes = m_scaledBitmaps.add(frame.get(), m_currentFrame, srcRect, imageScalerType, scaled);
+    if (deltaBytes) {
+        m_decodedSize += deltaBytes;
+        if (imageObserver())
+            imageObserver()->decodedSizeChanged(this, deltaBytes);
+    }
+    return scaled.release();
 }
 
 PassRefPtr<SharedBuffer> loadResourceIntoBuffer(const char* name)
@@ -137,48 +193,47 @@ void Image::drawPattern(GraphicsContext* context, const FloatRect& tileRect, con
     }
 #endif
 
-    HDC origDC = mdBitmap->createMemDC(true, (int)tileRect.x(), (int)tileRect.y(), 
-            (unsigned)tileRect.width(), (unsigned)tileRect.height());
-
-    if (origDC != HDC_INVALID) {
-        FloatRect destRect = context->getCTM().mapRect(dst);
-        FloatPoint phase = context->getCTM().mapPoint(p);
-        FloatRect stRect = context->getCTM().mapRect(tileRect);
-        FloatRect zoomRect =  patternTransform.mapRect(tileRect);
-
-        HDC hdc = *(context->platformContext()); 
-        HDC scaledDC = 0;
-
-        int leftwidth = (unsigned int)tileRect.width();
-        int leftheight = (unsigned int)tileRect.height();
-        int origx = (int)roundf(phase.x());
-        int origy = (int)roundf(phase.y());
-        int scaledwidth, scaledheight;
-
-        if ((stRect.width() != zoomRect.width()) || (stRect.height() != zoomRect.height())) {
-            scaledwidth = (int)roundf(zoomRect.width());
-            scaledheight = (int)roundf(zoomRect.height());
-            if (!scaledwidth) scaledwidth = 1;
-            if (!scaledheight) scaledheight = 1;
-
-            scaledDC = CreateCompatibleDCEx(origDC, scaledwidth, scaledheight);
-            if (scaledDC == HDC_INVALID) {
-                DeleteMemDC(origDC);
-                return;
-            }
-
-            StretchBlt(origDC, 0, 0, leftwidth, leftheight, scaledDC, 0, 0, 
-                    scaledwidth, scaledheight, 0);
-        }
-        else {
-            scaledwidth = (unsigned int)tileRect.width();
-            scaledheight = (unsigned int)tileRect.height();
-            scaledDC = origDC;
-        }
-    
-        if (mdBitmap->hasAlpha())
-            SetMemDCAlpha(scaledDC, MEMDC_FLAG_SRCPIXELALPHA, 0);
+    FloatRect destRect = context->getCTM().mapRect(dst);
+    FloatPoint phase = context->getCTM().mapPoint(p);
+    FloatRect stRect = context->getCTM().mapRect(tileRect);
+    FloatRect zoomRect =  patternTransform.mapRect(tileRect);
+
+    HDC hdc = *(context->platformContext()); 
+    HDC scaledDC = 0;
+    RefPtr<MDBitmap> scaledTile; // Owns scaledDC when the tile is scaled.
+    int tilex = 0, tiley = 0;
+
+    int leftwidth = (unsigned int)tileRect.width();
+    int leftheight = (unsigned int)tileRect.height();
+    int origx = (int)roundf(phase.x());
+    int origy = (int)roundf(phase.y());
+    int scaledwidth, scaledheight;
+
+    if ((stRect.width() != zoomRect.width()) || (stRect.height() != zoomRect.height())) {
+        scaledwidth = (int)roundf(zoomRect.width());
+        scaledheight = (int)roundf(zoomRect.height());
+        if (!scaledwidth) scaledwidth = 1;
+        if (!scaledheight) scaledheight = 1;
+
+        // Bitmap images keep the scaled tile around, so that scrolling a
+        // zoomed page does not stretch the same tile on every paint.
+        IntRect tileIntRect((int)tileRect.x(), (int)tileRect.y(), leftwidth, leftheight);
+        IntSize scaledSize(scaledwidth, scaledheight);
+        scaledTile = isBitmapImage()
+            ? static_cast<BitmapImage*>(this)->scaledFrame(tileIntRect, scaledSize)
+            : scaleBitmap(mdBitmap.get(), tileIntRect, scaledSize);
+        if (!scaledTile)
+            return;
+        scaledDC = scaledTile->memDC();
+    } else {
+        scaledwidth = (unsigned int)tileRect.width();
+        scaledheight = (unsigned int)tileRect.height();
+        tilex = (int)tileRect.x();
+        tiley = (int)tileRect.y();
+        scaledDC = mdBitmap->memDC();
+    }
 
+    if (scaledDC != HDC_INVALID) {
         int ox = (int)roundf(destRect.x());
         int oy = (int)roundf(destRect.y());
 
@@ -222,16 +277,12 @@ void Image::drawPattern(GraphicsContext* context, const FloatRect& tileRect, con
                     offx = 0;
                 }
 
-                BitBlt (scaledDC, offx, offy, leftwidth, leftheight, hdc, x, y, 0);
+                BitBlt (scaledDC, tilex + offx, tiley + offy, leftwidth, leftheight, hdc, x, y, 0);
                 x += leftwidth;
             }
 
             y += leftheight;
         }
-
-        DeleteMemDC(origDC);
-        if (origDC != scaledDC)
-            DeleteMemDC(scaledDC);
     }
 }
 
@@ -319,9 +370,6 @@ void BitmapImage::draw(GraphicsContext* context, const FloatRect& dst,
     if (mdBitmap && mdBitmap->bytes()) {
         HDC hdc = *(context->platformContext()); 
 
-#if ENABLE(HIGHQUALITYZOOM)
-        SetBitmapScalerType(hdc, BITMAP_SCALER_BILINEAR);
-#endif
         if (mayFillWithSolidColor()) {
             fillWithSolidColor(context, dst, solidColor(), styleColorSpace, op);
             return;
@@ -340,38 +388,28 @@ void BitmapImage::draw(GraphicsContext* context, const FloatRect& dst,
         dx = (int)roundf(dstRect.x());
         dy = (int)roundf(dstRect.y());
 
-        HDC memdc = mdBitmap->createMemDC(true);
-        if (memdc != HDC_INVALID) {
-            if (mdBitmap->hasAlpha())
-                SetMemDCAlpha(memdc, MEMDC_FLAG_SRCPIXELALPHA, 0);
-
-            if (scaleX == 1.0f && scaleY == 1.0f) {
+        if (scaleX == 1.0f && scaleY == 1.0f) {
+            HDC memdc = mdBitmap->memDC();
+            if (memdc != HDC_INVALID)
                 BitBlt(memdc, x, y, width, height, hdc, dx, dy, 0);
-            } else {
-                int scaledwidth =  (int)roundf(dstRect.width());
-                int scaledheight =  (int)roundf(dstRect.height());
-
-                if (scaledwidth > 0 && scaledheight > 0) {
-                    HDC scaledDc = CreateCompatibleDCEx(memdc, scaledwidth, scaledheight);
-                    if (scaledDc != HDC_INVALID) {
-                        StretchBlt(memdc, x, y, width, height, scaledDc, 0, 0, scaledwidth, scaledheight, 0);
-                        BitBlt(scaledDc, 0, 0, scaledwidth, scaledheight, hdc, dx, dy, 0); 
-                        DeleteMemDC(scaledDc);
-                    }
-                    else
-                        printf ("create compatible dc for scaled failure!\n");
-                }
+            else {
+                printf("%s-%d: image display error! \n", __FILE__, __LINE__);
+            }
+        } else {
+            int scaledwidth =  (int)roundf(dstRect.width());
+            int scaledheight =  (int)roundf(dstRect.height());
+
+            if (scaledwidth > 0 && scaledheight > 0) {
+                RefPtr<MDBitmap> scaled = scaledFrame(IntRect(x, y, width, height), IntSize(scaledwidth, scaledheight));
+                HDC scaledDc = scaled ? scaled->memDC() : HDC_INVALID;
+                if (scaledDc != HDC_INVALID)
+                    BitBlt(scaledDc, 0, 0, scaledwidth, scaledheight, hdc, dx, dy, 0); 
+                else
+                    printf ("create dc for scaled image failure!\n");
             }
-            DeleteMemDC(memdc);
-        }
-        else {
-            printf("%s-%d: image display error! \n", __FILE__, __LINE__);
         }
 
         startAnimation();
-#if ENABLE(HIGHQUALITYZOOM)
-        SetBitmapScalerType(hdc, BITMAP_SCALER_DDA);
-#endif
     }
 }
 
@@ -24,6 +24,10 @@
 
 namespace WebCore {
 
+#ifndef MEMDC_FLAG_SRCPIXELALPHA
+#define MEMDC_FLAG_SRCPIXELALPHA MEMDC_FLAG_NONE
+#endif
+
 PassRefPtr<MDBitmap> MDBitmap::create(int width, int height, bool hasAlpha, unsigned char* imgBits)
 {
     RefPtr<MDBitmap> resultantBitmap = adoptRef(new MDBitmap(width, height, hasAlpha, imgBits));
@@ -46,6 +50,9 @@ PassRefPtr<MDBitmap> MDBitmap::create(PassRefPtr<MDBitmap> other)
 MDBitmap::MDBitmap(int width, int height, bool hasAlpha, unsigned char* imgBits)
 #if ENABLE(CAIRO_MG)
     : m_surface(NULL)
+    , m_memDC(HDC_INVALID)
+#else
+    : m_memDC(HDC_INVALID)
 #endif
 {
     flags = MYBMP_TYPE_RGB;
@@ -113,6 +120,16 @@ HDC MDBitmap::createMemDC(bool useSoftSurface, int offx, int offy, int width, in
             Rmask, Gmask, Bmask, Amask, curBits, pitch);
 }
 
+HDC MDBitmap::memDC()
+{
+    if (m_memDC == HDC_INVALID) {
+        m_memDC = createMemDC(true);
+        if (m_memDC != HDC_INVALID && hasAlpha())
+            SetMemDCAlpha(m_memDC, MEMDC_FLAG_SRCPIXELALPHA, 0);
+    }
+    return m_memDC;
+}
+
 #if ENABLE(CAIRO_MG)
 cairo_surface_t* MDBitmap::surface()
 {
@@ -128,9 +145,65 @@ cairo_surface_t* MDBitmap::surface()
 
 MDBitmap::~MDBitmap()
 {
+    if (m_memDC != HDC_INVALID)
+        DeleteMemDC(m_memDC);
     if (m_allocBits) {
         free(bits);
     }
 }
 
+// Bounds of the scaled copies kept for a single image.
+static const size_t maxScaledBitmaps = 4;
+static const unsigned maxScaledBitmapBytes = 4 * 1024 * 1024;
+
+PassRefPtr<MDBitmap> MDScaledBitmapCache::get(MDBitmap* source, size_t frame, const IntRect& srcRect, const IntSize& size, int scaler)
+{
+    for (size_t i = 0; i < m_entries.size(); ++i) {
+        Entry& entry = m_entries[i];
+        if (entry.source != source || entry.frame != frame || entry.scaler != scaler
+                || entry.srcRect != srcRect
+                || entry.scaled->width() != size.width() || entry.scaled->height() != size.height())
+            continue;
+
+        RefPtr<MDBitmap> scaled = entry.scaled;
+        if (i) {
+            Entry hit = entry;
+            m_entries.remove(i);
+            m_entries.prepend(hit);
+        }
+        return scaled.release();
+    }
+    return 0;
+}
+
+int MDScaledBitmapCache::add(MDBitmap* source, size_t frame, const IntRect& srcRect, int scaler, PassRefPtr<MDBitmap> prpScaled)
+{
+    RefPtr<MDBitmap> scaled = prpScaled;
+    unsigned bytes = scaled->bmpSize();
+    if (bytes > maxScaledBitmapBytes)
+        return 0;
+
+    int delta = bytes;
+    while (!m_entries.isEmpty()
+            && (m_entries.size() >= maxScaledBitmaps || m_byteSize + bytes > maxScaledBitmapBytes)) {
+        unsigned lastBytes = m_entries.last().scaled->bmpSize();
+        m_byteSize -= lastBytes;
+        delta -= lastBytes;
+        m_entries.removeLast();
+    }
+
+    Entry entry = { source, frame, srcRect, scaler, scaled };
+    m_entries.prepend(entry);
+    m_byteSize += bytes;
+    return delta;
+}
+
+unsigned MDScaledBitmapCache::clear()
+{
+    unsigned bytes = m_byteSize;
+    m_entries.clear();
+    m_byteSize = 0;
+    return bytes;
+}
+
 } //namespace WebCore
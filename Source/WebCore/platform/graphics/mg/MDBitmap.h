@@ -17,8 +17,10 @@
 #include "config.h"
 
 #include "minigui.h"
+#include "IntRect.h"
 #include <wtf/RefPtr.h>
 #include <wtf/RefCounted.h>
+#include <wtf/Vector.h>
 #if ENABLE(CAIRO_MG)
 #include <cairo.h>
 #endif
@@ -41,6 +43,13 @@ public:
 
     HDC createMemDC(bool useSoftSurface = false, int offx = 0, int offy = 0, int w = 0, int h = 0);
 
+    // A software memory DC over the whole bitmap, created on first use and
+    // kept until the bitmap goes away. It draws from bits directly, so pixel
+    // changes show through it; bits, size and flags never change once the
+    // bitmap is created. Per-pixel alpha is already enabled on it for
+    // bitmaps with alpha. Callers must not delete it or change its state.
+    HDC memDC();
+
 #if ENABLE(CAIRO_MG)
     cairo_surface_t* surface();
 #endif
@@ -52,6 +61,40 @@ private:
     RefPtr<cairo_surface_t> m_surface;
 #endif
     bool m_allocBits;
+    HDC m_memDC;
+};
+
+// Scaled copies of the frames of one image, so that drawing an image at a
+// fixed zoom does not rescale it on every paint. Entries are kept most
+// recently used first and the cache drops the oldest ones when it is full.
+class MDScaledBitmapCache {
+public:
+    MDScaledBitmapCache() : m_byteSize(0) { }
+
+    PassRefPtr<MDBitmap> get(MDBitmap* source, size_t frame, const IntRect& srcRect, const IntSize& size, int scaler);
+
+    // Returns how many bytes the cache grew by, which is negative when
+    // older entries had to be dropped for this one.
+    int add(MDBitmap* source, size_t frame, const IntRect& srcRect, int scaler, PassRefPtr<MDBitmap> scaled);
+
+    // Returns the number of bytes released.
+    unsigned clear();
+
+    unsigned byteSize() const { return m_byteSize; }
+
+private:
+    struct Entry {
+        // Only compared against, the owner clears the cache whenever its
+        // frames go away.
+        MDBitmap* source;
+        size_t frame;
+        IntRect srcRect;
+        int scaler;
+        RefPtr<MDBitmap> scaled;
+    };
+
+    Vector<Entry> m_entries;
+    unsigned m_byteSize;
 };
 
 }  // namespace WebCore
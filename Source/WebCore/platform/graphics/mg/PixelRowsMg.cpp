@@ -0,0 +1,253 @@
+/*
+** $Id$
+**
+** PixelRowsMg.cpp: row conversions between MDBitmap pixels and ImageData.
+**
+** Copyright (C) 2003 ~ 2011 Beijing Feynman Software Technology Co., Ltd. 
+** 
+** All rights reserved by Feynman Software.
+**   
+** Current maintainer: lvlei 
+**  
+** Create date: 06/04/2010 
+*/
+
+#include "config.h"
+#include "PixelRowsMg.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif (defined(__ARM_NEON__) || defined(__ARM_NEON)) && !CPU(BIG_ENDIAN)
+#include <arm_neon.h>
+#endif
+
+namespace WebCore {
+
+static const unsigned* unpremultiplyTable()
+{
+    static unsigned table[256];
+    if (!table[0]) {
+        // Transparent pixels keep their channels, like colorFromPremultipliedARGB().
+        table[0] = 1 << 16;
+        for (unsigned alpha = 1; alpha < 256; ++alpha)
+            table[alpha] = (255 * 65536 + alpha - 1) / alpha;
+    }
+    return table;
+}
+
+// c * 255 / alpha, clamped, exact for all 8 bit values.
+static inline unsigned unpremultiplyChannel(unsigned c, unsigned factor)
+{
+    unsigned value = (c * factor) >> 16;
+    return value > 255 ? 255 : value;
+}
+
+// (c * alpha + 254) / 255 without the division.
+static inline unsigned premultiplyChannel(unsigned c, unsigned alpha)
+{
+    unsigned t = c * alpha + 254;
+    return (t + (t >> 8) + 1) >> 8;
+}
+
+void unpremultiplyRowScalar(const unsigned* src, unsigned char* dst, int count)
+{
+    const unsigned* table = unpremultiplyTable();
+    for (int x = 0; x < count; ++x) {
+        unsigned pixel = src[x];
+        unsigned alpha = pixel >> 24;
+        unsigned factor = table[alpha];
+        unsigned char* out = dst + x * 4;
+        out[0] = unpremultiplyChannel((pixel >> 16) & 0xFF, factor);
+        out[1] = unpremultiplyChannel((pixel >> 8) & 0xFF, factor);
+        out[2] = unpremultiplyChannel(pixel & 0xFF, factor);
+        out[3] = alpha;
+    }
+}
+
+void unpremultiplyRow(const unsigned* src, unsigned char* dst, int count)
+{
+    int x = 0;
+#if defined(__SSE2__)
+    const __m128i mask = _mm_set1_epi32(0xFF);
+    const __m128 scale = _mm_set1_ps(255.0f);
+    for (; x + 4 <= count; x += 4) {
+        __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + x));
+        __m128i a = _mm_srli_epi32(pixels, 24);
+        __m128i r = _mm_and_si128(_mm_srli_epi32(pixels, 16), mask);
+        __m128i g = _mm_and_si128(_mm_srli_epi32(pixels, 8), mask);
+        __m128i b = _mm_and_si128(pixels, mask);
+        // Quotients up to 256 are exact in single precision, larger ones are clamped.
+        __m128 alpha = _mm_cvtepi32_ps(a);
+        __m128i ur = _mm_cvttps_epi32(_mm_div_ps(_mm_mul_ps(_mm_cvtepi32_ps(r), scale), alpha));
+        __m128i ug = _mm_cvttps_epi32(_mm_div_ps(_mm_mul_ps(_mm_cvtepi32_ps(g), scale), alpha));
+        __m128i ub = _mm_cvttps_epi32(_mm_div_ps(_mm_mul_ps(_mm_cvtepi32_ps(b), scale), alpha));
+        __m128i transparent = _mm_cmpeq_epi32(a, _mm_setzero_si128());
+        ur = _mm_or_si128(_mm_and_si128(transparent, r), _mm_andnot_si128(transparent, ur));
+        ug = _mm_or_si128(_mm_and_si128(transparent, g), _mm_andnot_si128(transparent, ug));
+        ub = _mm_or_si128(_mm_and_si128(transparent, b), _mm_andnot_si128(transparent, ub));
+        // Saturate to 0..255 while packing down to bytes.
+        __m128i rg = _mm_packus_epi16(_mm_packs_epi32(ur, ug), _mm_setzero_si128());
+        __m128i ba = _mm_packus_epi16(_mm_packs_epi32(ub, a), _mm_setzero_si128());
+        // rg holds r0..r3 g0..g3, ba holds b0..b3 a0..a3.
+        __m128i rgba = _mm_unpacklo_epi16(_mm_unpacklo_epi8(rg, _mm_srli_si128(rg, 4)),
+                                          _mm_unpacklo_epi8(ba, _mm_srli_si128(ba, 4)));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + x * 4), rgba);
+    }
+#elif (defined(__ARM_NEON__) || defined(__ARM_NEON)) && !CPU(BIG_ENDIAN)
+    const unsigned* table = unpremultiplyTable();
+    for (; x + 8 <= count; x += 8) {
+        // Bytes of an ARGB word in memory are B, G, R, A.
+        uint8x8x4_t pixels = vld4_u8(reinterpret_cast<const uint8_t*>(src + x));
+        uint32_t factors[8];
+        for (int i = 0; i < 8; ++i)
+            factors[i] = table[src[x + i] >> 24];
+        uint32x4_t lowFactors = vld1q_u32(factors);
+        uint32x4_t highFactors = vld1q_u32(factors + 4);
+        uint8x8x4_t result;
+        for (int channel = 0; channel < 3; ++channel) {
+            uint16x8_t c = vmovl_u8(pixels.val[channel]);
+            uint32x4_t low = vshrq_n_u32(vmulq_u32(vmovl_u16(vget_low_u16(c)), lowFactors), 16);
+            uint32x4_t high = vshrq_n_u32(vmulq_u32(vmovl_u16(vget_high_u16(c)), highFactors), 16);
+            result.val[2 - channel] = vqmovn_u16(vcombine_u16(vqmovn_u32(low), vqmovn_u32(high)));
+        }
+        result.val[3] = pixels.val[3];
+        vst4_u8(dst + x * 4, result);
+    }
+#endif
+    unpremultiplyRowScalar(src + x, dst + x * 4, count - x);
+}
+
+void premultiplyRowScalar(const unsigned char* src, unsigned* dst, int count)
+{
+    for (int x = 0; x < count; ++x) {
+        const unsigned char* in = src + x * 4;
+        unsigned alpha = in[3];
+        if (alpha)
+            dst[x] = alpha << 24 | premultiplyChannel(in[0], alpha) << 16 | premultiplyChannel(in[1], alpha) << 8 | premultiplyChannel(in[2], alpha);
+        else
+            dst[x] = in[0] << 16 | in[1] << 8 | in[2];
+    }
+}
+
+void premultiplyRow(const unsigned char* src, unsigned* dst, int count)
+{
+    int x = 0;
+#if defined(__SSE2__)
+    const __m128i mask = _mm_set1_epi32(0xFF);
+    const __m128i bias = _mm_set1_epi16(254);
+    const __m128i one = _mm_set1_epi16(1);
+    for (; x + 4 <= count; x += 4) {
+        __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + x * 4));
+        __m128i r = _mm_and_si128(pixels, mask);
+        __m128i g = _mm_and_si128(_mm_srli_epi32(pixels, 8), mask);
+        __m128i b = _mm_and_si128(_mm_srli_epi32(pixels, 16), mask);
+        __m128i a = _mm_srli_epi32(pixels, 24);
+        // 16 bit lanes: r0..r3 g0..g3 and b0..b3 a0..a3.
+        __m128i rg = _mm_packs_epi32(r, g);
+        __m128i bb = _mm_packs_epi32(b, _mm_setzero_si128());
+        __m128i aa = _mm_packs_epi32(a, a);
+        __m128i t = _mm_add_epi16(_mm_mullo_epi16(rg, aa), bias);
+        rg = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(t, _mm_srli_epi16(t, 8)), one), 8);
+        t = _mm_add_epi16(_mm_mullo_epi16(bb, aa), bias);
+        bb = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(t, _mm_srli_epi16(t, 8)), one), 8);
+        __m128i pr = _mm_unpacklo_epi16(rg, _mm_setzero_si128());
+        __m128i pg = _mm_unpackhi_epi16(rg, _mm_setzero_si128());
+        __m128i pb = _mm_unpacklo_epi16(bb, _mm_setzero_si128());
+        __m128i premultiplied = _mm_or_si128(_mm_or_si128(_mm_slli_epi32(a, 24), _mm_slli_epi32(pr, 16)),
+                                             _mm_or_si128(_mm_slli_epi32(pg, 8), pb));
+        // Transparent pixels keep their channels, like premultipliedARGBFromColor().
+        __m128i raw = _mm_or_si128(_mm_or_si128(_mm_slli_epi32(r, 16), _mm_slli_epi32(g, 8)), b);
+        __m128i transparent = _mm_cmpeq_epi32(a, _mm_setzero_si128());
+        premultiplied = _mm_or_si128(_mm_and_si128(transparent, raw), _mm_andnot_si128(transparent, premultiplied));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + x), premultiplied);
+    }
+#elif (defined(__ARM_NEON__) || defined(__ARM_NEON)) && !CPU(BIG_ENDIAN)
+    const uint16x8_t bias = vdupq_n_u16(254);
+    for (; x + 8 <= count; x += 8) {
+        uint8x8x4_t pixels = vld4_u8(src + x * 4);
+        uint8x8_t alpha = pixels.val[3];
+        uint8x8_t transparent = vceq_u8(alpha, vdup_n_u8(0));
+        uint8x8x4_t result;
+        for (int channel = 0; channel < 3; ++channel) {
+            uint16x8_t t = vaddq_u16(vmull_u8(pixels.val[channel], alpha), bias);
+            uint8x8_t c = vshrn_n_u16(vaddq_u16(vsraq_n_u16(t, t, 8), vdupq_n_u16(1)), 8);
+            // Bytes of an ARGB word in memory are B, G, R, A.
+            result.val[2 - channel] = vbsl_u8(transparent, pixels.val[channel], c);
+        }
+        result.val[3] = alpha;
+        vst4_u8(reinterpret_cast<uint8_t*>(dst + x), result);
+    }
+#endif
+    premultiplyRowScalar(src + x * 4, dst + x, count - x);
+}
+
+void swizzleRowScalar(const unsigned* src, unsigned char* dst, int count)
+{
+    for (int x = 0; x < count; ++x) {
+        unsigned pixel = src[x];
+        unsigned char* out = dst + x * 4;
+        out[0] = pixel >> 16;
+        out[1] = pixel >> 8;
+        out[2] = pixel;
+        out[3] = pixel >> 24;
+    }
+}
+
+void swizzleRow(const unsigned* src, unsigned char* dst, int count)
+{
+    int x = 0;
+#if defined(__SSE2__)
+    const __m128i greenAlpha = _mm_set1_epi32(0xFF00FF00);
+    for (; x + 4 <= count; x += 4) {
+        __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + x));
+        // Swap the bytes of red and blue, green and alpha stay.
+        __m128i redBlue = _mm_andnot_si128(greenAlpha, pixels);
+        redBlue = _mm_or_si128(_mm_slli_epi32(redBlue, 16), _mm_srli_epi32(redBlue, 16));
+        pixels = _mm_or_si128(_mm_and_si128(pixels, greenAlpha), redBlue);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + x * 4), pixels);
+    }
+#elif (defined(__ARM_NEON__) || defined(__ARM_NEON)) && !CPU(BIG_ENDIAN)
+    for (; x + 8 <= count; x += 8) {
+        uint8x8x4_t pixels = vld4_u8(reinterpret_cast<const uint8_t*>(src + x));
+        uint8x8_t blue = pixels.val[0];
+        pixels.val[0] = pixels.val[2];
+        pixels.val[2] = blue;
+        vst4_u8(dst + x * 4, pixels);
+    }
+#endif
+    swizzleRowScalar(src + x, dst + x * 4, count - x);
+}
+
+void swizzleRowScalar(const unsigned char* src, unsigned* dst, int count)
+{
+    for (int x = 0; x < count; ++x) {
+        const unsigned char* in = src + x * 4;
+        dst[x] = in[3] << 24 | in[0] << 16 | in[1] << 8 | in[2];
+    }
+}
+
+void swizzleRow(const unsigned char* src, unsigned* dst, int count)
+{
+    int x = 0;
+#if defined(__SSE2__)
+    const __m128i greenAlpha = _mm_set1_epi32(0xFF00FF00);
+    for (; x + 4 <= count; x += 4) {
+        __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + x * 4));
+        __m128i redBlue = _mm_andnot_si128(greenAlpha, pixels);
+        redBlue = _mm_or_si128(_mm_slli_epi32(redBlue, 16), _mm_srli_epi32(redBlue, 16));
+        pixels = _mm_or_si128(_mm_and_si128(pixels, greenAlpha), redBlue);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + x), pixels);
+    }
+#elif (defined(__ARM_NEON__) || defined(__ARM_NEON)) && !CPU(BIG_ENDIAN)
+    for (; x + 8 <= count; x += 8) {
+        uint8x8x4_t pixels = vld4_u8(src + x * 4);
+        uint8x8_t red = pixels.val[0];
+        pixels.val[0] = pixels.val[2];
+        pixels.val[2] = red;
+        vst4_u8(reinterpret_cast<uint8_t*>(dst + x), pixels);
+    }
+#endif
+    swizzleRowScalar(src + x * 4, dst + x, count - x);
+}
+
+} // namespace WebCore
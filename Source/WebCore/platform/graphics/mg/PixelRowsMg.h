@@ -0,0 +1,42 @@
+/*
+** $Id$
+**
+** PixelRowsMg.h: row conversions between MDBitmap pixels and ImageData.
+**
+** Copyright (C) 2003 ~ 2011 Beijing Feynman Software Technology Co., Ltd. 
+** 
+** All rights reserved by Feynman Software.
+**   
+** Current maintainer: lvlei 
+**  
+** Create date: 06/04/2010 
+*/
+
+#ifndef PixelRowsMg_h
+#define PixelRowsMg_h
+
+namespace WebCore {
+
+// The pixels of the MDBitmap are premultiplied ARGB words while ImageData
+// holds unpremultiplied RGBA bytes. These convert a whole row at once, with
+// SSE2 or NEON where available, and give the same results as
+// colorFromPremultipliedARGB() and premultipliedARGBFromColor().
+
+// Premultiplied ARGB words to unpremultiplied RGBA bytes.
+void unpremultiplyRow(const unsigned* src, unsigned char* dst, int count);
+// Unpremultiplied RGBA bytes to premultiplied ARGB words.
+void premultiplyRow(const unsigned char* src, unsigned* dst, int count);
+// ARGB words to RGBA bytes and back, for premultiplied data.
+void swizzleRow(const unsigned* src, unsigned char* dst, int count);
+void swizzleRow(const unsigned char* src, unsigned* dst, int count);
+
+// The portable versions, used for the pixels left over by the vector
+// paths. The unit test checks the vector paths against them.
+void unpremultiplyRowScalar(const unsigned* src, unsigned char* dst, int count);
+void premultiplyRowScalar(const unsigned char* src, unsigned* dst, int count);
+void swizzleRowScalar(const unsigned* src, unsigned char* dst, int count);
+void swizzleRowScalar(const unsigned char* src, unsigned* dst, int count);
+
+} // namespace WebCore
+
+#endif // PixelRowsMg_h
@@ -242,6 +242,17 @@ FloatRect SimpleFontData::platformBoundsForGlyph(Glyph) const
     return FloatRect();
 }
 
+unsigned SimpleFontData::glyphValue(Glyph glyph) const
+{
+    unsigned value = m_glyphToValueMap.metricsForGlyph(glyph);
+    if (value != cGlyphValueUnknown)
+        return value;
+
+    value = GetGlyphValue(m_platformData.hfont(), (const char*)&glyph, 2/*sizeof(UChar)*/, NULL, 0);
+    m_glyphToValueMap.setMetricsForGlyph(glyph, value);
+    return value;
+}
+
 float SimpleFontData::platformWidthForGlyph(Glyph glyph) const
 {
 #if ENABLE(CAIRO_MG)
@@ -74,6 +74,11 @@ static int ssl_app_verify_callback(X509_STORE_CTX *ctx, void *obj)
     return(ok);
 }
 
+bool hasCertificateCallbacks(void)
+{
+    return mdGetClientCertCallback() || mdGetServerCertCallback();
+}
+
 CURLcode sslctxfun(CURL * curl, void * sslctx, void * obj)
 {
     SSL_CTX * ctx = (SSL_CTX *) sslctx ;
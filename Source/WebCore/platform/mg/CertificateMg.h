@@ -32,6 +32,8 @@
 namespace WebCore {
 #if ENABLE(SSL)
     CURLcode sslctxfun(CURL * curl, void * sslctx, void * obj);
+    // The certificate callbacks of the embedder must run on the UI thread.
+    bool hasCertificateCallbacks(void);
 #if ENABLE(SSLFILE)
     const CString& caPath(void);	
     void setCAPath(const char *caPath);
@@ -19,9 +19,17 @@
 
 #include "config.h"
 #include "EventLoop.h"
+#include "EventLoopMg.h"
 #include "minigui.h"
 #include "minigui/window.h"
 
+#include <wtf/HashMap.h>
+#include <wtf/StdLibExtras.h>
+
+#ifndef POLLIN
+#include <poll.h>
+#endif
+
 namespace WTF{
     HWND getUIRootWindow (void);
 }
@@ -37,4 +45,109 @@ void EventLoop::cycle()
     } 
 }
 
+#ifndef _MGRM_THREADS
+struct SocketNotifier {
+    int events;
+    SocketNotifierFunction function;
+    void* context;
+};
+
+typedef HashMap<int, SocketNotifier> SocketNotifierMap;
+
+static SocketNotifierMap& socketNotifiers()
+{
+    DEFINE_STATIC_LOCAL(SocketNotifierMap, notifiers, ());
+    return notifiers;
+}
+
+static WNDPROC oldDefWndProc;
+
+static int eventsFromPollType(int type)
+{
+    int events = 0;
+    if (type & POLLIN)
+        events |= SocketNotifierRead;
+    if (type & POLLOUT)
+        events |= SocketNotifierWrite;
+    if (type & (POLLERR | POLLHUP))
+        events |= SocketNotifierError;
+    return events;
+}
+
+// MSG_FDEVENT is posted to the window given to RegisterListenFD, so we hook
+// the default main window procedure the same way MainThreadMg does.
+static long int socketNotifierWndProc(HWND hwnd, unsigned int message, WPARAM wParam, LPARAM lParam)
+{
+    if (message == MSG_FDEVENT) {
+        int fd = LOWORD(wParam);
+        SocketNotifierMap::iterator it = socketNotifiers().find(fd);
+        if (it != socketNotifiers().end()) {
+            SocketNotifier notifier = it->second;
+            // MiniGUI posts one message per ready condition, with its poll
+            // type in the high word.
+            int events = eventsFromPollType(HIWORD(wParam)) & notifier.events;
+            if (events)
+                notifier.function(fd, events, notifier.context);
+            return 0;
+        }
+    }
+    return oldDefWndProc(hwnd, message, wParam, lParam);
+}
+
+static int pollTypeFromEvents(int events)
+{
+    int type = 0;
+    if (events & SocketNotifierRead)
+        type |= POLLIN;
+    if (events & SocketNotifierWrite)
+        type |= POLLOUT;
+    if (events & SocketNotifierError)
+        type |= POLLERR;
+    return type;
+}
+
+bool registerSocketNotifier(int fd, int events, SocketNotifierFunction function, void* context)
+{
+    HWND hwnd = WTF::getUIRootWindow();
+    if (hwnd == HWND_NULL || hwnd == HWND_INVALID)
+        return false;
+
+    if (!oldDefWndProc) {
+        oldDefWndProc = __mg_def_proc[0];
+        __mg_def_proc[0] = socketNotifierWndProc;
+    }
+
+    // MiniGUI keeps one slot per registration, so drop the old one first.
+    if (socketNotifiers().contains(fd))
+        UnregisterListenFD(fd);
+
+    if (!RegisterListenFD(fd, pollTypeFromEvents(events), hwnd, 0)) {
+        socketNotifiers().remove(fd);
+        return false;
+    }
+
+    SocketNotifier notifier = { events, function, context };
+    socketNotifiers().set(fd, notifier);
+    return true;
+}
+
+void unregisterSocketNotifier(int fd)
+{
+    if (socketNotifiers().contains(fd)) {
+        UnregisterListenFD(fd);
+        socketNotifiers().remove(fd);
+    }
+}
+#else
+// MiniGUI-Threads has no listen fd support, callers fall back to polling.
+bool registerSocketNotifier(int, int, SocketNotifierFunction, void*)
+{
+    return false;
+}
+
+void unregisterSocketNotifier(int)
+{
+}
+#endif
+
 } // namespace WebCore
@@ -0,0 +1,33 @@
+/*
+** $Id$
+**
+** EventLoopMg.h: watch file descriptors from the MiniGUI message loop.
+**
+** Copyright (C) 2003 ~ 2010 Beijing Feynman Software Technology Co., Ltd.
+**
+** All rights reserved by Feynman Software.
+*/
+
+#ifndef EventLoopMg_h
+#define EventLoopMg_h
+
+namespace WebCore {
+
+enum SocketNotifierEvent {
+    SocketNotifierRead = 1 << 0,
+    SocketNotifierWrite = 1 << 1,
+    SocketNotifierError = 1 << 2
+};
+
+typedef void (*SocketNotifierFunction)(int fd, int events, void* context);
+
+// Asks the MiniGUI message loop to call function on the UI thread whenever
+// one of the requested events happens on fd. Registering an fd again replaces
+// its previous events. Returns false when the message loop can not watch fd,
+// the caller is then responsible for polling it.
+bool registerSocketNotifier(int fd, int events, SocketNotifierFunction, void* context);
+void unregisterSocketNotifier(int fd);
+
+} // namespace WebCore
+
+#endif // EventLoopMg_h
@@ -80,6 +80,11 @@ int munmapFile(void *start, size_t length)
      return munmap(start, length);
 }
 
+int msyncFile(void *start, size_t length, int flags)
+{
+     return msync(start, length, flags);
+}
+
 size_t readFile(void *ptr, size_t size, size_t num, HFile file)
 {
     return fread(ptr, size, num, (FILE*)file);
@@ -49,6 +49,7 @@ int closedirFile(DIR *dir);
 void *mmapFile(void *start, size_t length, int prot, int flags,
                   HFile file, size_t offset);
 int munmapFile(void *start, size_t length);
+int msyncFile(void *start, size_t length, int flags);
 int mkdirFile(const char *path, mode_t mode);
 char *realpathFile(const char *path, char *resolved_path);
 int lstatFile(const char * name, struct stat * buf);
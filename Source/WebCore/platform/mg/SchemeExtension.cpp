@@ -15,6 +15,17 @@
 #include "CString.h"
 #include <wtf/Forward.h>
 
+#if ENABLE(SCHEMEEXTENSION)
+#include "MIMETypeRegistry.h"
+#include "ResourceError.h"
+#include "ResourceHandle.h"
+#include "ResourceHandleClient.h"
+#include "ResourceHandleInternal.h"
+#include "StringHash.h"
+#include <wtf/HashMap.h>
+#include <wtf/RefPtr.h>
+#endif
+
 namespace WebCore {
 
 #ifndef TABLE_SIZE
@@ -37,27 +48,65 @@ bool isSupportedInternalScheme(const char *scheme)
 
 #if ENABLE(SCHEMEEXTENSION)
 
-static Vector<SchemeHandler> *schemeHandler(void)
+typedef HashMap<String, SchemeHandler, CaseFoldingHash> SchemeHandlerMap;
+
+static SchemeHandlerMap *schemeHandlers(void)
+{
+    static SchemeHandlerMap *handlers = new SchemeHandlerMap;
+    return handlers;
+}
+
+static const SchemeHandler *findSchemeHandler(const String &scheme)
+{
+    SchemeHandlerMap::iterator it = schemeHandlers()->find(scheme);
+    if (it == schemeHandlers()->end())
+        return 0;
+    return &it->second;
+}
+
+static SchemeHandler *ensureSchemeHandler(const char *scheme)
+{
+    if (! scheme)
+        return 0;
+
+    if (isSupportedInternalScheme(scheme))
+        return 0;
+
+    int csize = strlen(scheme);
+
+    if (! validScheme(scheme, csize))
+        return 0;
+
+    return &schemeHandlers()->add(String(scheme, csize), SchemeHandler()).first->second;
+}
+
+static SchemeHandlerMap::iterator findValidSchemeHandler(const char *scheme)
 {
-    static Vector<SchemeHandler> *handler = new Vector<SchemeHandler>;
-    return handler;
+    if (! scheme)
+        return schemeHandlers()->end();
+
+    int csize = strlen(scheme);
+
+    if (! validScheme(scheme, csize))
+        return schemeHandlers()->end();
+
+    return schemeHandlers()->find(String(scheme, csize));
+}
+
+static void removeSchemeHandlerIfUnused(SchemeHandlerMap::iterator it)
+{
+    if (! it->second.cb && ! it->second.responder)
+        schemeHandlers()->remove(it);
 }
 
 static bool handleExtensionScheme(const KURL &url)
 {
-    Vector<SchemeHandler> *schemes= schemeHandler();
-    if (! schemes)
+    const SchemeHandler *handler = findSchemeHandler(url.protocol());
+    if (! handler || ! handler->cb)
         return false;
 
-    size_t size = schemes->size();
-    for (size_t i=0; i<size; i++) {
-        SchemeHandler *handler = &schemes->at(i); 
-        if (equalIgnoringCase(handler->scheme, url.protocol())) {
-            (void)(*handler->cb)(url.string().utf8().data(), handler->param);
-            return true;
-        }
-    }
-    return false;
+    (void)(*handler->cb)(url.string().utf8().data(), handler->param);
+    return true;
 }
 
 bool scheduleScheme(const KURL &url)
@@ -73,61 +122,217 @@ bool scheduleScheme(const KURL &url)
 
 bool RegisterSchemeHandler(const char *scheme, MDCB_SCHEME_HANDLER cb, void *param)
 {
-    if (! scheme || !cb)
+    if (! cb)
         return false;
 
-    if (isSupportedInternalScheme(scheme))
+    SchemeHandler *handler = ensureSchemeHandler(scheme);
+    if (! handler)
         return false;
 
-    Vector<SchemeHandler> *handler = schemeHandler();
+    handler->cb = cb;
+    handler->param = param;
+    return true;
+}
+
+bool UnregisterSchemeHandler(const char *scheme)
+{
+    SchemeHandlerMap::iterator it = findValidSchemeHandler(scheme);
+    if (it == schemeHandlers()->end() || ! it->second.cb)
+        return false;
+
+    it->second.cb = 0;
+    it->second.param = 0;
+    removeSchemeHandlerIfUnused(it);
+    return true;
+}
+
+bool RegisterSchemeResponder(const char *scheme, MDCB_SCHEME_RESPONDER cb, void *param)
+{
+    if (! cb)
+        return false;
+
+    SchemeHandler *handler = ensureSchemeHandler(scheme);
     if (! handler)
         return false;
 
-    int csize = strlen(scheme);
+    handler->responder = cb;
+    handler->responderParam = param;
+    return true;
+}
 
-    if (! validScheme(scheme, csize))
+bool UnregisterSchemeResponder(const char *scheme)
+{
+    SchemeHandlerMap::iterator it = findValidSchemeHandler(scheme);
+    if (it == schemeHandlers()->end() || ! it->second.responder)
         return false;
 
-    String strScheme(scheme, csize);
-    size_t size = handler->size();
-    for (size_t i=0; i<size; i++) {
-        if (equalIgnoringCase(handler->at(i).scheme, strScheme)) {
-            handler->at(i).cb = cb;
-            handler->at(i).param = param;
-            return true;
-        }
+    it->second.responder = 0;
+    it->second.responderParam = 0;
+    removeSchemeHandlerIfUnused(it);
+    return true;
+}
+
+bool hasSchemeResponder(const KURL &url)
+{
+    if (schemeHandlers()->isEmpty())
+        return false;
+
+    const SchemeHandler *handler = findSchemeHandler(url.protocol());
+    return handler && handler->responder;
+}
+
+/*
+ * A load served by a scheme responder. The application streams the response
+ * through the MDHSchemeJob handle, which keeps the resource handle alive
+ * until finishSchemeJob(). Once the load is cancelled, whatever is still
+ * written is dropped.
+ */
+struct SchemeJob {
+    SchemeJob(ResourceHandle *job)
+        : handle(job)
+        , responseSent(false)
+        , inResponder(false)
+        , finished(false)
+    {
     }
 
-    handler->resize(size+1);
-    handler->at(size).scheme = strScheme;
-    handler->at(size).cb = cb;
-    handler->at(size).param = param;
-    return true;
+    RefPtr<ResourceHandle> handle;
+    bool responseSent;
+    bool inResponder;
+    bool finished;
+};
+
+static SchemeJob *toSchemeJob(MDHSchemeJob job)
+{
+    return static_cast<SchemeJob *>(job);
 }
 
-bool UnregisterSchemeHandler(const char *scheme)
+static bool isSchemeJobLoading(SchemeJob *schemeJob)
 {
-    if (! scheme)
+    ResourceHandle *job = schemeJob->handle.get();
+    return job && ! schemeJob->finished && ! job->getInternal()->m_cancelled && job->client();
+}
+
+static ResourceError schemeJobError(ResourceHandle *job, const char *description)
+{
+    String url = job->firstRequest().url().string();
+    return ResourceError(url, -1, url, String(description));
+}
+
+static void sendSchemeJobResponse(SchemeJob *schemeJob)
+{
+    if (schemeJob->responseSent)
+        return;
+    schemeJob->responseSent = true;
+
+    ResourceHandle *job = schemeJob->handle.get();
+    ResourceResponse &response = job->getInternal()->m_response;
+    if (response.mimeType().isEmpty())
+        response.setMimeType(MIMETypeRegistry::getMIMETypeForPath(job->firstRequest().url().path()));
+    job->client()->didReceiveResponse(job, response);
+}
+
+void startSchemeJob(ResourceHandle *job, bool synchronous)
+{
+    const KURL &url = job->firstRequest().url();
+    const SchemeHandler *handler = findSchemeHandler(url.protocol());
+    ASSERT(handler && handler->responder);
+
+    // the responder may unregister its scheme while it runs
+    MDCB_SCHEME_RESPONDER responder = handler->responder;
+    void *param = handler->responderParam;
+
+    ResourceResponse &response = job->getInternal()->m_response;
+    response.setURL(url);
+    response.setHTTPStatusCode(200);
+
+    SchemeJob *schemeJob = new SchemeJob(job);
+    schemeJob->inResponder = true;
+    bool accepted = (*responder)(schemeJob, url.string().utf8().data(), param);
+    schemeJob->inResponder = false;
+
+    if (! accepted) {
+        if (isSchemeJobLoading(schemeJob))
+            job->client()->cannotShowURL(job);
+        delete schemeJob;
+        return;
+    }
+
+    if (schemeJob->finished) {
+        delete schemeJob;
+        return;
+    }
+
+    // The client of a synchronous load is gone once we return, what the
+    // responder streams later can not reach it.
+    if (synchronous) {
+        if (isSchemeJobLoading(schemeJob))
+            job->client()->didFail(job, schemeJobError(job, "the scheme responder did not finish a synchronous load"));
+        schemeJob->handle = 0;
+    }
+}
+
+bool setSchemeJobResponse(MDHSchemeJob job, const char *mimeType, const char *encoding, long long contentLength)
+{
+    SchemeJob *schemeJob = toSchemeJob(job);
+    if (! schemeJob || schemeJob->responseSent || ! isSchemeJobLoading(schemeJob))
         return false;
 
-    Vector<SchemeHandler> *handler = schemeHandler();
-    if (! handler)
+    ResourceResponse &response = schemeJob->handle->getInternal()->m_response;
+    if (mimeType)
+        response.setMimeType(String(mimeType));
+    if (encoding)
+        response.setTextEncodingName(String(encoding));
+    if (contentLength >= 0)
+        response.setExpectedContentLength(contentLength);
+    return true;
+}
+
+bool addSchemeJobHeader(MDHSchemeJob job, const char *name, const char *value)
+{
+    SchemeJob *schemeJob = toSchemeJob(job);
+    if (! schemeJob || ! name || ! value || schemeJob->responseSent || ! isSchemeJobLoading(schemeJob))
         return false;
 
-    int csize = strlen(scheme);
-    
-    if (! validScheme(scheme, csize))
+    ResourceResponse &response = schemeJob->handle->getInternal()->m_response;
+    response.setHTTPHeaderField(String(name), String(value));
+    return true;
+}
+
+bool writeSchemeJob(MDHSchemeJob job, const char *data, size_t length)
+{
+    SchemeJob *schemeJob = toSchemeJob(job);
+    if (! schemeJob || (! data && length) || ! isSchemeJobLoading(schemeJob))
         return false;
 
-    String strScheme(scheme, csize);
-    size_t size = handler->size();
-    for (size_t i=0; i<size; i++) {
-        if (equalIgnoringCase(handler->at(i).scheme, strScheme)) {
-            handler->remove(i);
-            return true;
-        }
+    // the client may cancel the load from any of its callbacks
+    RefPtr<ResourceHandle> protect(schemeJob->handle);
+    sendSchemeJobResponse(schemeJob);
+    if (length && isSchemeJobLoading(schemeJob))
+        protect->client()->didReceiveData(protect.get(), data, length, 0);
+    return isSchemeJobLoading(schemeJob);
+}
+
+void finishSchemeJob(MDHSchemeJob job, bool success)
+{
+    SchemeJob *schemeJob = toSchemeJob(job);
+    if (! schemeJob || schemeJob->finished)
+        return;
+
+    if (isSchemeJobLoading(schemeJob)) {
+        RefPtr<ResourceHandle> protect(schemeJob->handle);
+        if (success) {
+            sendSchemeJobResponse(schemeJob);
+            if (isSchemeJobLoading(schemeJob))
+                protect->client()->didFinishLoading(protect.get(), 0);
+        } else
+            protect->client()->didFail(protect.get(), schemeJobError(protect.get(), "the scheme responder failed the load"));
     }
-    return false;
+
+    schemeJob->finished = true;
+    // startSchemeJob() deletes jobs finished from within the responder
+    if (! schemeJob->inResponder)
+        delete schemeJob;
 }
 
 #endif /* ENABLE(SCHEMEEXTENSION) */
@@ -23,15 +23,34 @@
 namespace WebCore {
 
 #if ENABLE(SCHEMEEXTENSION)
+class ResourceHandle;
+
 struct SchemeHandler {
-    String scheme;
+    SchemeHandler() : cb(0), param(0), responder(0), responderParam(0) { }
+
+    /* called instead of loading a navigation to the scheme */
     MDCB_SCHEME_HANDLER cb;
     void *param;
+    /* serves the loads of the scheme as a resource handle */
+    MDCB_SCHEME_RESPONDER responder;
+    void *responderParam;
 };
 
 bool RegisterSchemeHandler(const char *scheme, MDCB_SCHEME_HANDLER cb, void *param);
 bool UnregisterSchemeHandler(const char *scheme);
 bool scheduleScheme(const KURL &url);
+
+bool RegisterSchemeResponder(const char *scheme, MDCB_SCHEME_RESPONDER cb, void *param);
+bool UnregisterSchemeResponder(const char *scheme);
+bool hasSchemeResponder(const KURL &url);
+
+/* called by the resource handle manager in place of starting a curl transfer */
+void startSchemeJob(ResourceHandle* job, bool synchronous);
+
+bool setSchemeJobResponse(MDHSchemeJob job, const char *mimeType, const char *encoding, long long contentLength);
+bool addSchemeJobHeader(MDHSchemeJob job, const char *name, const char *value);
+bool writeSchemeJob(MDHSchemeJob job, const char *data, size_t length);
+void finishSchemeJob(MDHSchemeJob job, bool success);
 #endif /* ENABLE(SCHEMEEXTENSION) */
 
 bool isSupportedInternalScheme(const char *scheme);
@@ -21,6 +21,14 @@
 #include <math.h>
 #include <string.h>
 
+#if HAVE(SYS_TIMERFD_H)
+#include "EventLoopMg.h"
+#include <errno.h>
+#include <stdint.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+#endif
+
 namespace WebCore {
 
 static DWORD timerID = 0;
@@ -40,12 +48,20 @@ static BOOL timerFired(HWND, LINT, DWORD)   // gengyue
     return TRUE;
 }
 
-void setSharedTimerFireTime(double fireTime)
+static void stopMiniGUITimer()
+{
+    if (timerID) {
+        KillTimer(HWND_NULL, timerID);
+        timerID = 0;
+    }
+}
+
+// MiniGUI timers count in 10ms ticks, so they are only used when the
+// timerfd below is not available.
+static void setMiniGUITimer(double interval)
 {
     static unsigned int t_id = 1;
-    double interval = fireTime - currentTime();
     unsigned int intervalInMS;
-    //printf("interval %s  %f\n", __FUNCTION__ , interval);
     if (interval < 0) {
         intervalInMS = 0;
     } else {
@@ -56,33 +72,114 @@ void setSharedTimerFireTime(double fireTime)
             intervalInMS = (unsigned int)ceil(interval);
     }
 
-    stopSharedTimer();
-
-    while (IsTimerInstalled(HWND_NULL, t_id))
-        t_id++;
-    
     // for Minigui bugs: SetTimerEx( 0 ) will wait 200ms when interval time is 0
     // so set interval time to minimum
     if( 0 == intervalInMS ){
-        //printf("wwwwwwww : set intervalInMS to 1\n");
         intervalInMS = 1;
     }
 
-    //printf("wwwwwwwwwwwwwwwwwwwwwwwwwwwwwww  %d\n", intervalInMS);
+    // Re-arm the installed timer instead of going through the timer table again.
+    if (timerID && ResetTimerEx(HWND_NULL, timerID, intervalInMS, timerFired))
+        return;
+
+    stopMiniGUITimer();
+
+    while (IsTimerInstalled(HWND_NULL, t_id))
+        t_id++;
+
     if (SetTimerEx(HWND_NULL, t_id, intervalInMS, timerFired)){
         timerID = t_id;
         t_id++;
     }else
         fprintf(stderr, "mDolphin: SetTimerEx failed !\n");
+}
 
+#if HAVE(SYS_TIMERFD_H)
+// A monotonic timerfd watched by the message loop gives the shared timer
+// sub-millisecond precision and is re-armed in place.
+static int timerFD = -1;
+static bool timerFDRegistered = false;
+static bool timerFDUnavailable = false;
+
+static void timerFDFired(int fd, int, void*)
+{
+    uint64_t expirations;
+    ssize_t result;
+    while ((result = read(fd, &expirations, sizeof(expirations))) == -1 && errno == EINTR) { }
+    // Nothing to read when the timer was re-armed after it became readable.
+    if (result != sizeof(expirations))
+        return;
+
+    if (sharedTimerFiredFunction)
+        sharedTimerFiredFunction();
 }
 
-void stopSharedTimer()
+static bool setTimerFD(double interval)
 {
-    if (timerID) {
-        KillTimer(HWND_NULL, timerID);
-        timerID = 0;
+    if (timerFDUnavailable)
+        return false;
+
+    if (timerFD == -1) {
+        timerFD = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+        if (timerFD == -1) {
+            timerFDUnavailable = true;
+            return false;
+        }
+    }
+
+    // The message loop can only watch the fd once the main window exists.
+    if (!timerFDRegistered) {
+        timerFDRegistered = registerSocketNotifier(timerFD, SocketNotifierRead, timerFDFired, 0);
+        if (!timerFDRegistered)
+            return false;
+        stopMiniGUITimer();
     }
+
+    if (interval > 0x7FFFFFFF)
+        interval = 0x7FFFFFFF;
+
+    struct itimerspec spec;
+    memset(&spec, 0, sizeof(spec));
+    if (interval > 0) {
+        spec.it_value.tv_sec = static_cast<time_t>(interval);
+        spec.it_value.tv_nsec = static_cast<long>((interval - spec.it_value.tv_sec) * 1000000000);
+    }
+    // A zero value disarms the timer, a timer that is already due fires
+    // as soon as possible instead.
+    if (!spec.it_value.tv_sec && !spec.it_value.tv_nsec)
+        spec.it_value.tv_nsec = 1;
+
+    return !timerfd_settime(timerFD, 0, &spec, 0);
+}
+
+static void stopTimerFD()
+{
+    if (timerFD == -1)
+        return;
+
+    struct itimerspec spec;
+    memset(&spec, 0, sizeof(spec));
+    timerfd_settime(timerFD, 0, &spec, 0);
+}
+#endif
+
+void setSharedTimerFireTime(double fireTime)
+{
+    double interval = fireTime - currentTime();
+
+#if HAVE(SYS_TIMERFD_H)
+    if (setTimerFD(interval))
+        return;
+#endif
+    setMiniGUITimer(interval);
+}
+
+void stopSharedTimer()
+{
+#if HAVE(SYS_TIMERFD_H)
+    stopTimerFD();
+#endif
+    stopMiniGUITimer();
 }
 
 }
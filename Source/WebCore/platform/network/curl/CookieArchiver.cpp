@@ -22,13 +22,19 @@
 #include "CString.h"
 #include "PlatformString.h"
 #include "CookieArchiver.h"
+#include <algorithm>
 #include <stdio.h>
 
-namespace WebCore{ 
+namespace WebCore{
 
 class CookieManager;
 
-static const char cMagic[] = "MDCK";
+static const char cJournalMagic[] = "MDCJ";
+static const char cIndexMagic[] = "MDCI";
+
+/* the journal is compacted once the records appended since the last
+ * compaction outgrow both this and the compacted part */
+static const long cMinCompactSize = 16 * 1024;
 
 struct CookieFileHeader{
     char m_magic[4];
@@ -49,20 +55,44 @@ struct CookieItem{
     char  m_isHttpOnly;
 };
 
-struct CookieEntry {
-    CookieItem item;
-    char  *m_name;
-    char  *m_value;
-    char  *m_host;
-    char  *m_path;
-};
-
 struct DomainFileHeader {
     char m_magic[4];
     long m_numOfDomains;
     long m_numOfCookies;
 };
 
+struct JournalFileHeader {
+    char m_magic[4];
+    unsigned m_generation;
+};
+
+enum {
+    RecordSet = 1,
+    RecordDelete,
+    RecordClear
+};
+
+/* followed by the domain and, except for RecordClear, a CookieItem */
+struct JournalRecord {
+    unsigned short m_type;
+    unsigned short m_domainLen;
+    unsigned m_size;
+};
+
+struct IndexFileHeader {
+    char m_magic[4];
+    unsigned m_generation;
+    unsigned m_journalSize;
+    unsigned m_numOfDomains;
+};
+
+/* sorted by hash, one entry per block of domain records */
+struct IndexEntry {
+    unsigned m_hash;
+    unsigned m_offset;
+    unsigned m_length;
+};
+
 #define MAX_FILENAME 256
 
 #define SEEK_FILE(offset, where) seekFile(fp, offset, where)
@@ -90,9 +120,26 @@ do { \
     } \
 }while(0)
 
+static bool lessIndexEntry(const IndexEntry& a, const IndexEntry& b)
+{
+    return a.m_hash < b.m_hash;
+}
+
+static void appendData(Vector<char>& buffer, const void* data, size_t length)
+{
+    buffer.append(static_cast<const char*>(data), length);
+}
+
 CookieArchiver::CookieArchiver(char *path)
+    : m_cookieDir(0)
+    , m_isDefaultDir(false)
+    , m_journal(0)
+    , m_generation(0)
+    , m_journalSize(0)
+    , m_compactedSize(0)
+    , m_index(0)
+    , m_indexSize(0)
 {
-    m_isDefaultDir= false;
     if (! setCookieDir(path))
         m_cookieDir = (char*)"./.mDolphin/cookie";
     //printf("cookir dir is %s\n", m_cookieDir);
@@ -100,89 +147,477 @@ CookieArchiver::CookieArchiver(char *path)
 
 CookieArchiver::~CookieArchiver()
 {
+    closeJournal();
     if (m_isDefaultDir)
         free(m_cookieDir);
 }
 
-int CookieArchiver::save(DomainCookie *domain)
+/* cookie is only used by RecordSet and RecordDelete */
+void CookieArchiver::buildRecord(Vector<char>& buffer, int type, const String& domain, CookieCurl* cookie)
 {
-    if (! domain)
-        return -1;
+    CString domainName = domain.utf8();
+    JournalRecord record;
+    record.m_type = type;
+    record.m_domainLen = domainName.length();
+    record.m_size = 0;
+    appendData(buffer, &record, sizeof(record));
+    appendData(buffer, domainName.data(), domainName.length());
+
+    if (type != RecordClear) {
+        ASSERT(cookie);
+        CString name = cookie->m_name.utf8();
+        CString value = type == RecordSet ? cookie->m_value.utf8() : CString();
+        CString host = cookie->m_host.utf8();
+        CString path = cookie->m_path.utf8();
 
-    /* write the header of the cookie file */
+        CookieItem item;
+        memset(&item, 0, sizeof(item));
+        item.m_expiry = cookie->m_expiry;
+        item.m_nameLen = name.length();
+        item.m_valueLen = value.length();
+        item.m_hostLen = host.length();
+        item.m_pathLen = path.length();
+        item.m_isDomain = cookie->m_isDomain;
+        item.m_isSecure = cookie->m_isSecure;
+        item.m_isHttpOnly = cookie->m_isHttpOnly;
+
+        appendData(buffer, &item, sizeof(item));
+        appendData(buffer, name.data(), name.length());
+        appendData(buffer, value.data(), value.length());
+        appendData(buffer, host.data(), host.length());
+        appendData(buffer, path.data(), path.length());
+    }
+
+    reinterpret_cast<JournalRecord*>(buffer.data())->m_size = buffer.size();
+}
+
+/* Reads the record at the current position of fp. Returns its size, or 0
+ * when there is no complete record within the next available bytes. */
+unsigned CookieArchiver::readRecord(HFile fp, long available, int& type, String& domain, CookieCurl** cookie)
+{
+    JournalRecord record;
+    if (available < (long)sizeof(record))
+        return 0;
+    READ_FIELD_FAILED_GOTO(&record, sizeof(record), FAILED);
+    if (record.m_size < sizeof(record) + record.m_domainLen || (long)record.m_size > available)
+        return 0;
+
+    {
+        Vector<char> buffer(record.m_size - sizeof(record));
+        if (buffer.size())
+            READ_FIELD_FAILED_GOTO(buffer.data(), buffer.size(), FAILED);
+
+        type = record.m_type;
+        domain = String::fromUTF8(buffer.data(), record.m_domainLen);
+        if (!cookie || type == RecordClear)
+            return record.m_size;
+
+        CookieItem item;
+        size_t itemOffset = record.m_domainLen;
+        if (buffer.size() < itemOffset + sizeof(item))
+            return 0;
+        memcpy(&item, buffer.data() + itemOffset, sizeof(item));
+        if (buffer.size() < itemOffset + sizeof(item) + item.m_nameLen + item.m_valueLen + item.m_hostLen + item.m_pathLen)
+            return 0;
+
+        CookieCurl *newCookie = new CookieCurl;
+        const char *pData = buffer.data() + itemOffset + sizeof(item);
+        READ_ITEM_FROM_UTF8STRING(newCookie->m_name, pData, item.m_nameLen);
+        READ_ITEM_FROM_UTF8STRING(newCookie->m_value, pData, item.m_valueLen);
+        READ_ITEM_FROM_UTF8STRING(newCookie->m_host, pData, item.m_hostLen);
+        READ_ITEM_FROM_UTF8STRING(newCookie->m_path, pData, item.m_pathLen);
+
+        newCookie->m_expiry = item.m_expiry;
+        newCookie->m_isSecure = (item.m_isSecure == 1);
+        newCookie->m_isHttpOnly = (item.m_isHttpOnly == 1);
+        newCookie->m_isDomain = (item.m_isDomain == 1);
+        *cookie = newCookie;
+        return record.m_size;
+    }
+
+FAILED:
+    return 0;
+}
+
+bool CookieArchiver::openJournal()
+{
     char fileName[MAX_FILENAME];
-    snprintf(fileName, sizeof(fileName)-1, "%s/%s",
-            m_cookieDir, domain->domain().utf8().data());
-    HFile fp = openFile(fileName, "w+");
+    snprintf(fileName, sizeof(fileName)-1, "%s/cookies.journal", m_cookieDir);
+    HFile fp = openFile(fileName, "a+");
     if (!fp)
-         return -1;
+        return false;
 
-    CookieFileHeader fileHeader;
-    fileHeader.m_numOfCookies = domain->cookieCount();
-    memcpy(fileHeader.m_magic, cMagic, sizeof(fileHeader.m_magic));
-    WRITE_FIELD(&fileHeader, sizeof(fileHeader));
-
-    int num = 0;
-    CookieCurl *cNext = domain->m_head;
-    while (cNext) {
-        if (serialize(cNext, fp))
-            num++;
-        cNext = cNext->m_next; 
+    struct stat st;
+    if (statFile(fileName, &st))
+        st.st_size = 0;
+
+    JournalFileHeader header;
+    if (st.st_size < (long)sizeof(header)) {
+        /* a new journal */
+        ftruncateFile(filenoFile(fp), 0);
+        memcpy(header.m_magic, cJournalMagic, sizeof(header.m_magic));
+        header.m_generation = 1;
+        WRITE_FIELD(&header, sizeof(header));
+        fflushFile(fp);
+        st.st_size = sizeof(header);
+    } else {
+        SEEK_FILE(0, SEEK_SET);
+        if (!readFile(&header, sizeof(header), 1, fp)
+                || memcmp(header.m_magic, cJournalMagic, sizeof(header.m_magic))) {
+            closeFile(fp);
+            return false;
+        }
     }
 
-    if (num && (num != domain->cookieCount())) {
-        SEEK_FILE(0, SEEK_SET); 
-        fileHeader.m_numOfCookies = num;
-        WRITE_FIELD(&fileHeader, sizeof(fileHeader));
+    m_journal = fp;
+    m_generation = header.m_generation;
+    m_journalSize = st.st_size;
+    m_compactedSize = sizeof(header);
+
+    /* the index is only valid for the journal it was written with */
+    snprintf(fileName, sizeof(fileName)-1, "%s/cookies.index", m_cookieDir);
+    HFile indexFile = openFile(fileName, "r");
+    if (indexFile) {
+        if (!statFile(fileName, &st) && st.st_size >= (long)sizeof(IndexFileHeader)) {
+            void *index = mmapFile(0, st.st_size, PROT_READ, MAP_SHARED, indexFile, 0);
+            if (index != MAP_FAILED) {
+                const IndexFileHeader *indexHeader = static_cast<const IndexFileHeader*>(index);
+                if (!memcmp(indexHeader->m_magic, cIndexMagic, sizeof(indexHeader->m_magic))
+                        && indexHeader->m_generation == m_generation
+                        && (long)indexHeader->m_journalSize <= m_journalSize
+                        && sizeof(IndexFileHeader) + indexHeader->m_numOfDomains * sizeof(IndexEntry) <= (size_t)st.st_size) {
+                    m_index = index;
+                    m_indexSize = st.st_size;
+                    m_compactedSize = indexHeader->m_journalSize;
+                } else
+                    munmapFile(index, st.st_size);
+            }
+        }
+        closeFile(indexFile);
     }
-    
-    closeFile(fp);
-    
-    if (!num)
-        deleteFile(fileName);
-    return num;
+
+    scanJournal(m_compactedSize);
+    return true;
 }
 
-bool CookieArchiver::serialize(CookieCurl *cookie, HFile fp)
+void CookieArchiver::closeJournal()
 {
-    if (cookie->isExpired() || cookie->m_expiry == 0)
+    if (m_index) {
+        munmapFile(m_index, m_indexSize);
+        m_index = 0;
+        m_indexSize = 0;
+    }
+    if (m_journal) {
+        closeFile(m_journal);
+        m_journal = 0;
+    }
+    m_tailRecords.clear();
+    m_journalSize = m_compactedSize = 0;
+}
+
+/* Remembers where the records after offset are, without reading cookies. */
+void CookieArchiver::scanJournal(long offset)
+{
+    HFile fp = m_journal;
+    SEEK_FILE(offset, SEEK_SET);
+    while (offset < m_journalSize) {
+        int type;
+        String domain;
+        unsigned size = readRecord(fp, m_journalSize - offset, type, domain, 0);
+        if (!size)
+            break;
+        m_tailRecords.add(domain, Vector<long>()).first->second.append(offset);
+        offset += size;
+    }
+
+    /* drop a record torn by a crash */
+    if (offset < m_journalSize) {
+        fflushFile(fp);
+        ftruncateFile(filenoFile(fp), offset);
+        m_journalSize = offset;
+    }
+}
+
+bool CookieArchiver::appendRecord(int type, const String& domain, CookieCurl* cookie)
+{
+    if (!m_journal)
         return false;
 
-    CookieEntry entry;
-    CookieItem *item = &entry.item;
-
-    memset(&entry, 0, sizeof(entry));
-    entry.m_name = strdup(cookie->m_name.utf8().data());
-    item->m_nameLen = cookie->m_name.utf8().length();
-    entry.m_value = strdup(cookie->m_value.utf8().data());
-    item->m_valueLen = cookie->m_value.utf8().length();
-    entry.m_host = strdup(cookie->m_host.utf8().data());
-    item->m_hostLen = cookie->m_host.utf8().length();
-    entry.m_path = strdup(cookie->m_path.utf8().data());
-    item->m_pathLen = cookie->m_path.utf8().length();
-  
-    item->m_expiry = cookie->m_expiry;
-    item->m_isDomain = cookie->m_isDomain;
-    item->m_isSecure = cookie->m_isSecure;
-    item->m_isHttpOnly = cookie->m_isHttpOnly;
-
-    WRITE_FIELD(item, sizeof(*item));
-    WRITE_FIELD(entry.m_name, item->m_nameLen);
-    WRITE_FIELD(entry.m_value, item->m_valueLen);
-    WRITE_FIELD(entry.m_host, item->m_hostLen);
-    WRITE_FIELD(entry.m_path, item->m_pathLen);
-
-    free(entry.m_name);
-    free(entry.m_value);
-    free(entry.m_host);
-    free(entry.m_path);
+    /* the cookies of this domain in memory are now the ones to keep */
+    m_loadedDomains.add(domain);
+
+    Vector<char> buffer;
+    buildRecord(buffer, type, domain, cookie);
+
+    /* the stream was last used for reading, it has to be positioned
+     * before it can be written to */
+    HFile fp = m_journal;
+    if (SEEK_FILE(0, SEEK_END) || !WRITE_FIELD(buffer.data(), buffer.size()))
+        return false;
+    fflushFile(fp);
+    m_journalSize += buffer.size();
+    return true;
+}
+
+bool CookieArchiver::save(DomainCookie *domain, CookieCurl *cookie)
+{
+    /* session cookies are never written */
+    if (!domain || !cookie || cookie->m_expiry <= 0 || cookie->isExpired())
+        return false;
+    appendRecord(RecordSet, domain->domain(), cookie);
     return true;
 }
 
-int CookieArchiver::loadDomain(DomainCookie *domain)
+void CookieArchiver::remove(DomainCookie *domain, CookieCurl *cookie)
+{
+    if (!domain || !cookie || cookie->m_expiry <= 0)
+        return;
+    appendRecord(RecordDelete, domain->domain(), cookie);
+}
+
+void CookieArchiver::deleteDomain(DomainCookie* domain)
+{
+    appendRecord(RecordClear, domain->domain(), 0);
+}
+
+void CookieArchiver::clear()
+{
+    closeJournal();
+    m_loadedDomains.clear();
+
+    char fileName[MAX_FILENAME];
+    snprintf(fileName, sizeof(fileName)-1, "%s/cookies.index", m_cookieDir);
+    deleteFile(fileName);
+    snprintf(fileName, sizeof(fileName)-1, "%s/cookies.journal", m_cookieDir);
+    deleteFile(fileName);
+
+    openJournal();
+}
+
+long CookieArchiver::findIndexedDomain(const String& domain, long* length)
+{
+    if (!m_index)
+        return -1;
+
+    const IndexFileHeader *header = static_cast<const IndexFileHeader*>(m_index);
+    const IndexEntry *entries = reinterpret_cast<const IndexEntry*>(header + 1);
+    const IndexEntry *end = entries + header->m_numOfDomains;
+
+    IndexEntry key;
+    key.m_hash = CaseFoldingHash::hash(domain);
+    const IndexEntry *entry = std::lower_bound(entries, end, key, lessIndexEntry);
+
+    /* the first record of a block names its domain */
+    HFile fp = m_journal;
+    for (; entry != end && entry->m_hash == key.m_hash; ++entry) {
+        JournalRecord record;
+        if (SEEK_FILE(entry->m_offset, SEEK_SET) || !readFile(&record, sizeof(record), 1, fp))
+            continue;
+        Vector<char> name(record.m_domainLen);
+        if (name.size() && !readFile(name.data(), name.size(), 1, fp))
+            continue;
+        if (equalIgnoringCase(String::fromUTF8(name.data(), name.size()), domain)) {
+            *length = entry->m_length;
+            return entry->m_offset;
+        }
+    }
+    return -1;
+}
+
+unsigned CookieArchiver::replayRecord(DomainCookie* domain, long offset, long end)
+{
+    HFile fp = m_journal;
+    if (SEEK_FILE(offset, SEEK_SET))
+        return 0;
+
+    int type;
+    String name;
+    CookieCurl *cookie = 0;
+    unsigned size = readRecord(fp, end - offset, type, name, &cookie);
+    if (!size)
+        return 0;
+
+    if (type == RecordClear) {
+        while (domain->m_head)
+            domain->remove(domain->m_head);
+        return size;
+    }
+    if (!cookie)
+        return size;
+
+    for (CookieCurl *old = domain->m_head; old; old = old->m_next) {
+        if (equalIgnoringCase(old->m_path, cookie->m_path) && (old->m_name == cookie->m_name)) {
+            domain->remove(old);
+            break;
+        }
+    }
+
+    if (type == RecordSet && !cookie->isExpired())
+        domain->add(cookie);
+    else
+        delete cookie;
+    return size;
+}
+
+/* Reads the cookies of a domain which has not been used since startup. */
+DomainCookie* CookieArchiver::loadDomain(CookieManager* mgr, const String& name)
+{
+    if (!m_journal || m_loadedDomains.contains(name))
+        return 0;
+
+    long length = 0;
+    long offset = findIndexedDomain(name, &length);
+    RecordMap::iterator tail = m_tailRecords.find(name);
+    if (offset < 0 && tail == m_tailRecords.end())
+        return 0;
+
+    m_loadedDomains.add(name);
+    DomainCookie *domain = new DomainCookie(name);
+
+    if (offset >= 0) {
+        long end = offset + length;
+        while (offset < end) {
+            unsigned size = replayRecord(domain, offset, end);
+            if (!size)
+                break;
+            offset += size;
+        }
+    }
+
+    if (tail != m_tailRecords.end()) {
+        Vector<long>& records = tail->second;
+        for (size_t i = 0; i < records.size(); i++)
+            replayRecord(domain, records[i], m_journalSize);
+        m_tailRecords.remove(tail);
+    }
+
+    if (!domain->cookieCount()) {
+        delete domain;
+        return 0;
+    }
+    mgr->addDomain(domain);
+    return domain;
+}
+
+void CookieArchiver::loadAllDomains(CookieManager* mgr)
+{
+    Vector<String> names;
+
+    if (m_index) {
+        const IndexFileHeader *header = static_cast<const IndexFileHeader*>(m_index);
+        const IndexEntry *entries = reinterpret_cast<const IndexEntry*>(header + 1);
+        HFile fp = m_journal;
+        for (unsigned i = 0; i < header->m_numOfDomains; i++) {
+            int type;
+            String name;
+            if (SEEK_FILE(entries[i].m_offset, SEEK_SET)
+                    || !readRecord(fp, entries[i].m_length, type, name, 0))
+                continue;
+            names.append(name);
+        }
+    }
+
+    RecordMap::iterator end = m_tailRecords.end();
+    for (RecordMap::iterator it = m_tailRecords.begin(); it != end; ++it)
+        names.append(it->first);
+
+    for (size_t i = 0; i < names.size(); i++)
+        loadDomain(mgr, names[i]);
+}
+
+void CookieArchiver::compactIfNeeded(CookieManager* mgr)
+{
+    long appended = m_journalSize - m_compactedSize;
+    if (m_journal && appended > cMinCompactSize && appended > m_compactedSize)
+        compact(mgr);
+}
+
+/* Rewrites the journal with the cookies in memory, one block per domain. */
+bool CookieArchiver::compact(CookieManager* mgr)
+{
+    if (!m_journal)
+        return false;
+
+    loadAllDomains(mgr);
+
+    char journalName[MAX_FILENAME], indexName[MAX_FILENAME];
+    char newJournalName[MAX_FILENAME], newIndexName[MAX_FILENAME];
+    snprintf(journalName, sizeof(journalName)-1, "%s/cookies.journal", m_cookieDir);
+    snprintf(indexName, sizeof(indexName)-1, "%s/cookies.index", m_cookieDir);
+    snprintf(newJournalName, sizeof(newJournalName)-1, "%s/cookies.journal.new", m_cookieDir);
+    snprintf(newIndexName, sizeof(newIndexName)-1, "%s/cookies.index.new", m_cookieDir);
+
+    HFile fp = openFile(newJournalName, "w+");
+    if (!fp)
+        return false;
+
+    JournalFileHeader header;
+    memcpy(header.m_magic, cJournalMagic, sizeof(header.m_magic));
+    header.m_generation = m_generation + 1;
+    WRITE_FIELD(&header, sizeof(header));
+
+    Vector<IndexEntry> entries;
+    long offset = sizeof(header);
+    vector<DomainCookie*> domains = mgr->domains();
+    for (size_t i = 0; i < domains.size(); i++) {
+        DomainCookie *domain = domains[i];
+        long start = offset;
+        for (CookieCurl *cookie = domain->m_head; cookie; cookie = cookie->m_next) {
+            if (cookie->m_expiry <= 0 || cookie->isExpired())
+                continue;
+            Vector<char> buffer;
+            buildRecord(buffer, RecordSet, domain->domain(), cookie);
+            WRITE_FIELD(buffer.data(), buffer.size());
+            offset += buffer.size();
+        }
+        if (offset > start) {
+            IndexEntry entry;
+            entry.m_hash = CaseFoldingHash::hash(domain->domain());
+            entry.m_offset = start;
+            entry.m_length = offset - start;
+            entries.append(entry);
+        }
+    }
+    bool written = !fflushFile(fp) && !fsync(filenoFile(fp));
+    closeFile(fp);
+    if (!written)
+        return false;
+
+    std::sort(entries.begin(), entries.end(), lessIndexEntry);
+
+    fp = openFile(newIndexName, "w+");
+    if (!fp)
+        return false;
+
+    IndexFileHeader indexHeader;
+    memcpy(indexHeader.m_magic, cIndexMagic, sizeof(indexHeader.m_magic));
+    indexHeader.m_generation = header.m_generation;
+    indexHeader.m_journalSize = offset;
+    indexHeader.m_numOfDomains = entries.size();
+    WRITE_FIELD(&indexHeader, sizeof(indexHeader));
+    if (entries.size())
+        WRITE_FIELD(entries.data(), entries.size() * sizeof(IndexEntry));
+    written = !fflushFile(fp) && !fsync(filenoFile(fp));
+    closeFile(fp);
+    if (!written)
+        return false;
+
+    /* an index left over from the old journal is ignored by its generation */
+    closeJournal();
+    renameFile(newJournalName, journalName);
+    renameFile(newIndexName, indexName);
+
+    /* everything in memory is at least as new as the journal */
+    for (size_t i = 0; i < domains.size(); i++)
+        m_loadedDomains.add(domains[i]->domain());
+    return openJournal();
+}
+
+/* reads a domain file written before the journal was used */
+int CookieArchiver::loadLegacyDomain(DomainCookie *domain)
 {
     int ret = 0;
- 
+
     // open index file
     char fileName[MAX_FILENAME];
     snprintf(fileName, sizeof(fileName)-1,
@@ -229,29 +664,27 @@ int CookieArchiver::loadDomain(DomainCookie *domain)
 
 EXIT:
     closeFile(fp);
+    deleteFile(fileName);
     return domain->cookieCount();
 }
 
-int CookieArchiver::load(CookieManager *mgr)
+/* reads the index.dat and the domain files written before the journal was used */
+int CookieArchiver::loadLegacy(CookieManager *mgr)
 {
     ASSERT(mgr);
 
-    vector<DomainCookie*> domains = mgr->domains();
-
     /* open index file */
     char fileName[MAX_FILENAME];
     snprintf(fileName, sizeof(fileName)-1, "%s/index.dat", m_cookieDir);
     HFile fp = openFile(fileName, "r+");
     if (!fp)
-         return -1; 
+         return -1;
 
     /* read the header and check well format */
-    int numOfCookies = 0;
     DomainFileHeader domainHeader;
     READ_FIELD_FAILED_GOTO(&domainHeader, sizeof(domainHeader), EXIT);
-    
+
     for (int i=0; i<domainHeader.m_numOfDomains; i++) {
-        int num;
         int ret = 0;
         size_t domainLen = 0;
         READ_FIELD_RETURN_VALUE(&domainLen, sizeof(domainLen), ret);
@@ -260,15 +693,14 @@ int CookieArchiver::load(CookieManager *mgr)
 
         /* new DomainCookie */
         ASSERT(domainLen);
-        
+
         char *pBuf = new char[domainLen];
         READ_FIELD_RETURN_VALUE(pBuf, domainLen, ret);
         if (-1 != ret) {
             DomainCookie *domain = new DomainCookie(String::fromUTF8(pBuf, domainLen));
-            if ((num = loadDomain(domain)) >= 0) {
+            if (loadLegacyDomain(domain) > 0)
                 mgr->addDomain(domain);
-                numOfCookies += num;
-            } else 
+            else
                 delete domain;
         }
         delete[] pBuf;
@@ -276,55 +708,48 @@ int CookieArchiver::load(CookieManager *mgr)
 
 EXIT:
     closeFile(fp);
-    return mgr->setCookieCount(numOfCookies);
+    deleteFile(fileName);
+    return mgr->cookieCount();
 }
 
-bool CookieArchiver::save(CookieManager *mgr)
+/* Only opens the journal, loadDomain() reads the cookies of a domain. */
+int CookieArchiver::load(CookieManager *mgr)
 {
-    if (!mgr)
-        return false;
+    ASSERT(mgr);
 
     char fileName[MAX_FILENAME];
-    snprintf(fileName, sizeof(fileName)-1, "%s/index.dat", m_cookieDir);
-    HFile fp = openFile(fileName, "w+");
-    if (!fp)
-         return false;
- 
-    vector<DomainCookie*> domains = mgr->domains();
-    size_t size = domains.size(); 
-    DomainFileHeader domainHeader;
-
-    domainHeader.m_numOfCookies = mgr->cookieCount();
-    domainHeader.m_numOfDomains = size;
+    snprintf(fileName, sizeof(fileName)-1, "%s/cookies.journal", m_cookieDir);
+    struct stat st;
+    bool hasJournal = !statFile(fileName, &st);
 
-    memcpy(&domainHeader.m_magic, cMagic, sizeof(cMagic)-1);
-    WRITE_FIELD(&domainHeader, sizeof(domainHeader));
-
-    for (size_t i=0; i<size; i++) {
-        size_t length = domains[i]->domain().utf8().length();
-        WRITE_FIELD(&length, sizeof(length));
-        WRITE_FIELD((char*)domains[i]->domain().utf8().data(), length);
-    }
+    if (!openJournal())
+        return -1;
 
-    closeFile(fp);
-    return true;
-}
+    /* move the cookies of an older version into the journal */
+    snprintf(fileName, sizeof(fileName)-1, "%s/index.dat", m_cookieDir);
+    if (!hasJournal && !statFile(fileName, &st) && loadLegacy(mgr) > 0)
+        compact(mgr);
 
-void CookieArchiver::deleteDomain(DomainCookie* domain)
-{
-    char fileName[MAX_FILENAME];
-    snprintf(fileName, sizeof(fileName)-1, "%s/%s",
-            m_cookieDir, domain->domain().utf8().data());
-    deleteFile(fileName);
+    return mgr->cookieCount();
 }
 
 bool CookieArchiver::setCookieDir(const char *path)
 {
     if (path && strlen(path)) {
-        if ((! m_isDefaultDir) && m_cookieDir)
+        /* the journal of the old directory is not written any more, and
+         * nothing learnt from it applies to the journal of the new one */
+        bool wasOpen = m_journal != 0;
+        closeJournal();
+        m_tailRecords.clear();
+        m_loadedDomains.clear();
+
+        if (m_isDefaultDir && m_cookieDir)
             free(m_cookieDir);
         m_cookieDir = strdup(path);
         m_isDefaultDir = true;
+
+        if (wasOpen)
+            openJournal();
         return true;
     }
     return false;
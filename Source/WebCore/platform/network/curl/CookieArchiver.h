@@ -17,6 +17,11 @@
 
 #if ENABLE(FILECOOKIE)
 #include "FileSystemMg.h"
+#include "PlatformString.h"
+#include "StringHash.h"
+#include <wtf/HashMap.h>
+#include <wtf/HashSet.h>
+#include <wtf/Vector.h>
 
 namespace WebCore {
 
@@ -24,26 +29,65 @@ class CookieCurl;
 class CookieManager;
 class DomainCookie;
 
+/*
+ * Cookies are kept in an append-only journal: every change of a persistent
+ * cookie appends a small record. From time to time the journal is compacted
+ * into one block of records per domain, and a memory-mapped index tells
+ * where the block of a domain starts. A domain is only read from the
+ * journal the first time the cookie manager looks it up.
+ */
 class CookieArchiver {
 public:
     CookieArchiver(char* path = 0);
     ~CookieArchiver();
 
     int load(CookieManager* mgr);
-    int save(DomainCookie* domain);
-    bool save(CookieManager* mgr);
+    DomainCookie* loadDomain(CookieManager* mgr, const String& domain);
+
+    /* save() returns false for cookies which are not kept on disk */
+    bool save(DomainCookie* domain, CookieCurl* cookie);
+    void remove(DomainCookie* domain, CookieCurl* cookie);
     void deleteDomain(DomainCookie* domain);
+    void clear();
+
+    void compactIfNeeded(CookieManager* mgr);
 
     bool setCookieDir(const char* path);
     const char* cookieDir();
 
-protected:    
-    bool serialize(CookieCurl* cookie, HFile fp);
-    int loadDomain(DomainCookie* domain);
+protected:
+    int loadLegacyDomain(DomainCookie* domain);
+    int loadLegacy(CookieManager* mgr);
 
 private:
+    static void buildRecord(Vector<char>& buffer, int type, const String& domain, CookieCurl* cookie);
+    static unsigned readRecord(HFile fp, long available, int& type, String& domain, CookieCurl** cookie);
+
+    bool openJournal();
+    void closeJournal();
+    void scanJournal(long offset);
+    bool appendRecord(int type, const String& domain, CookieCurl* cookie);
+    unsigned replayRecord(DomainCookie* domain, long offset, long end);
+    long findIndexedDomain(const String& domain, long* length);
+    void loadAllDomains(CookieManager* mgr);
+    bool compact(CookieManager* mgr);
+
     char *m_cookieDir;
     bool m_isDefaultDir;
+
+    HFile m_journal;
+    unsigned m_generation;
+    long m_journalSize;
+    long m_compactedSize;   /* the part of the journal covered by the index */
+
+    void *m_index;
+    size_t m_indexSize;
+
+    /* records appended after the last compaction, by domain */
+    typedef HashMap<String, Vector<long>, CaseFoldingHash> RecordMap;
+    RecordMap m_tailRecords;
+    /* domains whose cookies in memory are newer than the journal */
+    HashSet<String, CaseFoldingHash> m_loadedDomains;
 };
 
 } /* namespace WebCore */
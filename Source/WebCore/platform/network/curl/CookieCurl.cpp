@@ -22,6 +22,8 @@ CookieCurl::CookieCurl()
     : m_accessCount(1)
     , m_next(NULL)
     , m_prev(NULL)
+    , m_domain(NULL)
+    , m_expiryIndex(notFound)
     , m_expiry(0)
     , m_isSecure(false)
     , m_isHttpOnly(false)
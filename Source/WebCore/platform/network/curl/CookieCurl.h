@@ -15,12 +15,14 @@
 
 #include "config.h"
 #include "PlatformString.h"
+#include <wtf/NotFound.h>
 
 #if ENABLE(COOKIE)
 
 namespace WebCore {
 
 class CookieManager;
+class DomainCookie;
 
 class CookieCurl {
     friend class DomainCookie;
@@ -33,6 +35,7 @@ public:
     void parse(String &cookie, String &domain);
     bool isExpired();
     int accessCount() {return m_accessCount; };
+    const String &path() {return m_path; }
 
 protected:
     int incAccessCount(){return m_accessCount++;}
@@ -43,6 +46,8 @@ private:
     int m_accessCount;
     CookieCurl *m_next;
     CookieCurl *m_prev;
+    DomainCookie *m_domain;
+    size_t m_expiryIndex; /* position in the expiry heap of CookieManager */
     String m_name;
     String m_path;
     String m_host;
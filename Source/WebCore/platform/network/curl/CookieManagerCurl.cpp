@@ -20,6 +20,8 @@
 #include "Threading.h"    
 #endif
 #include <stdio.h>
+#include <time.h>
+#include <wtf/text/StringBuilder.h>
 
 using namespace std;
 
@@ -47,15 +49,24 @@ int DomainCookie::add(CookieCurl *newCookie)
     if (! newCookie)
         return 0;
 
-    if (! m_head) {
-        ASSERT(m_cookies == 0);
-        m_head = newCookie;
+    /* insert in front of the first cookie with a shorter path */
+    unsigned pathLength = newCookie->m_path.length();
+    CookieCurl *prev = NULL;
+    CookieCurl *next = m_head;
+    while (next && next->m_path.length() > pathLength) {
+        prev = next;
+        next = next->m_next;
     }
-    else {
-        m_head->m_prev = newCookie;
-        newCookie->m_next = m_head;
+
+    newCookie->m_prev = prev;
+    newCookie->m_next = next;
+    if (next)
+        next->m_prev = newCookie;
+    if (prev)
+        prev->m_next = newCookie;
+    else
         m_head = newCookie;
-    }
+    newCookie->m_domain = this;
 
     m_cookies++;
     return 1;
@@ -78,9 +89,14 @@ void DomainCookie::remove(CookieCurl *cookie)
     m_cookies--;
 }
 
-inline bool operator<(DomainCookie &a, DomainCookie &b)
+static bool lessAccessedDomain(DomainCookie *a, DomainCookie *b)
 {
-    return a.accessCount() < b.accessCount();
+    return a->accessCount() < b->accessCount();
+}
+
+static bool lessAccessedCookie(CookieCurl *a, CookieCurl *b)
+{
+    return a->accessCount() < b->accessCount();
 }
 
 CookieManager::CookieManager()
@@ -107,11 +123,16 @@ CookieManager::CookieManager()
 
 CookieManager::~CookieManager()
 {
-    for (unsigned int i=0; i<m_domains.size(); i++) {
-        removeCookies(m_domains[i]);
-        delete m_domains[i]; 
+    DomainMap::iterator end = m_domains.end();
+    for (DomainMap::iterator it = m_domains.begin(); it != end; ++it) {
+        removeCookies(it->second);
+        delete it->second; 
     }
-    m_domains.erase(m_domains.begin(), m_domains.end());
+    m_domains.clear();
+
+#if ENABLE(FILECOOKIE)
+    delete m_archiver;
+#endif
 
 #if USE(MULTIPLE_THREADS)
     delete m_lock;
@@ -130,6 +151,7 @@ int CookieManager::removeCookie(const DomainCookie *domain, CookieCurl *cookie)
 {
     if (! cookie)
         return 0;
+    unscheduleExpiry(cookie);
     const_cast<DomainCookie*>(domain)->remove(cookie);
     m_cookies--;
     return 1;
@@ -139,17 +161,96 @@ int CookieManager::addCookie(DomainCookie *domain, CookieCurl* newCookie)
 {
     ASSERT(newCookie);
 
+    if (m_cookies >= m_maxCookies)
+        removeExpiredCookies();
+
     if (domain->m_cookies > m_maxDomainCookies)
         removeLRUCookies(domain);
 
     if (m_cookies >= m_maxCookies)
-        removeLRUDomains();
+        removeLRUDomains(domain);
 
     domain->add(newCookie);
+    scheduleExpiry(newCookie);
     m_cookies++;
     return 1;
 }
 
+void CookieManager::scheduleExpiry(CookieCurl *cookie)
+{
+    /* session cookies never expire by date */
+    if (cookie->m_expiry <= 0)
+        return;
+
+    cookie->m_expiryIndex = m_expiryHeap.size();
+    m_expiryHeap.append(cookie);
+    siftExpiryUp(cookie->m_expiryIndex);
+}
+
+void CookieManager::unscheduleExpiry(CookieCurl *cookie)
+{
+    size_t index = cookie->m_expiryIndex;
+    if (index == notFound)
+        return;
+
+    cookie->m_expiryIndex = notFound;
+    CookieCurl *last = m_expiryHeap.last();
+    m_expiryHeap.removeLast();
+    if (last == cookie)
+        return;
+
+    m_expiryHeap[index] = last;
+    last->m_expiryIndex = index;
+    siftExpiryUp(index);
+    siftExpiryDown(last->m_expiryIndex);
+}
+
+void CookieManager::siftExpiryUp(size_t index)
+{
+    CookieCurl *cookie = m_expiryHeap[index];
+    while (index) {
+        size_t parent = (index - 1) / 2;
+        if (m_expiryHeap[parent]->m_expiry <= cookie->m_expiry)
+            break;
+        m_expiryHeap[index] = m_expiryHeap[parent];
+        m_expiryHeap[index]->m_expiryIndex = index;
+        index = parent;
+    }
+    m_expiryHeap[index] = cookie;
+    cookie->m_expiryIndex = index;
+}
+
+void CookieManager::siftExpiryDown(size_t index)
+{
+    size_t size = m_expiryHeap.size();
+    CookieCurl *cookie = m_expiryHeap[index];
+    while (true) {
+        size_t child = index * 2 + 1;
+        if (child >= size)
+            break;
+        if (child + 1 < size && m_expiryHeap[child + 1]->m_expiry < m_expiryHeap[child]->m_expiry)
+            child++;
+        if (cookie->m_expiry <= m_expiryHeap[child]->m_expiry)
+            break;
+        m_expiryHeap[index] = m_expiryHeap[child];
+        m_expiryHeap[index]->m_expiryIndex = index;
+        index = child;
+    }
+    m_expiryHeap[index] = cookie;
+    cookie->m_expiryIndex = index;
+}
+
+/* Expired cookies are only dropped when cookies are read or added, the
+ * heap makes this cost nothing as long as no cookie has expired. */
+void CookieManager::removeExpiredCookies(void)
+{
+    time_t now = time(NULL);
+    while (!m_expiryHeap.isEmpty() && m_expiryHeap[0]->m_expiry <= now) {
+        CookieCurl *cookie = m_expiryHeap[0];
+        removeCookie(cookie->m_domain, cookie);
+    }
+}
+
 bool CookieManager::set(const KURL &url, const KURL &policyURL, const String& value)
 {
     if (url.isEmpty() || value.isEmpty() || !cookiesEnabled())
@@ -184,16 +285,19 @@ bool CookieManager::set(const KURL &url, const KURL &policyURL, const String& va
     if (strDomain.startsWith("."))
         strDomain = strDomain.right(strDomain.length()-1);
 
-    bool isNewDomain = false;
     DomainCookie *domain = lookup(strDomain);
     if (!domain) {
         domain = new DomainCookie(strDomain);
-        isNewDomain = true;
         addDomain(domain);
     }
 
     /* Look up the domain for the new cookie */
     CookieCurl *pCookie = lookup(domain, newCookie->m_host, newCookie->m_path, newCookie->m_name);
+#if ENABLE(FILECOOKIE)
+    /* a new cookie which is not kept on disk removes the old one there */
+    if (!m_archiver->save(domain, newCookie) && pCookie)
+        m_archiver->remove(domain, pCookie);
+#endif
     removeCookie(domain, pCookie);
 
     if (newCookie->isExpired())
@@ -202,9 +306,7 @@ bool CookieManager::set(const KURL &url, const KURL &policyURL, const String& va
         addCookie(domain, newCookie);
 
 #if ENABLE(FILECOOKIE)
-    if (isNewDomain)
-        m_archiver->save(this);
-    m_archiver->save(domain);
+    m_archiver->compactIfNeeded(this);
 #endif
 
     unlock();
@@ -219,18 +321,46 @@ bool CookieManager::addDomain(DomainCookie *domain)
     int size = m_domains.size();
     if (size >= m_maxDomains)
         removeLRUDomains();
-    m_domains.insert(m_domains.begin(), domain);
+    m_domains.set(domain->domain(), domain);
+
+    /* the archiver hands over domains which already hold cookies */
+    for (CookieCurl *cookie = domain->m_head; cookie; cookie = cookie->m_next) {
+        cookie->m_domain = domain;
+        scheduleExpiry(cookie);
+    }
+    m_cookies += domain->m_cookies;
     return true;
 }
 
+void CookieManager::removeDomain(DomainCookie *domain)
+{
+    removeCookies(domain);
+#if ENABLE(FILECOOKIE)    
+    m_archiver->deleteDomain(domain);
+#endif
+    m_domains.remove(domain->domain());
+    delete domain;
+}
+
+vector<DomainCookie*> CookieManager::domains()
+{
+    vector<DomainCookie*> domains;
+    domains.reserve(m_domains.size());
+    DomainMap::iterator end = m_domains.end();
+    for (DomainMap::iterator it = m_domains.begin(); it != end; ++it)
+        domains.push_back(it->second);
+    return domains;
+}
+
 DomainCookie *CookieManager::lookup(const String &domain)
 {
-    int size = m_domains.size();
-    for (int i=0; i<size; i++) {
-        if (equalIgnoringCase(m_domains[i]->domain(), domain))
-            return m_domains[i];
-    }
-    return NULL;
+    DomainCookie *found = m_domains.get(domain);
+#if ENABLE(FILECOOKIE)
+    /* the archiver reads a domain the first time it is asked for */
+    if (!found)
+        found = m_archiver->loadDomain(this, domain);
+#endif
+    return found;
 }
 
 CookieCurl *CookieManager::lookup(const DomainCookie *domain,
@@ -284,50 +414,66 @@ bool CookieManager::matchDomain(const String &domain, const String &host)
     return false; 
 }
 
+static bool longerCookiePath(CookieCurl *a, CookieCurl *b)
+{
+    return a->path().length() > b->path().length();
+}
+
 String CookieManager::matchedCookies(const KURL& kuri, String &path)
 {
-    String strCookie;
     String host = kuri.host();
     bool isSecure = (kuri.protocol() == "https");
 
-    for (size_t i=0; i<m_domains.size(); i++) {
-        DomainCookie *domain = m_domains[i];
-        if (! matchDomain(domain->m_domain, host))
-            continue;
+    removeExpiredCookies();
+
+    /* only the domains the host ends with can match, i.e. the host
+     * itself and every parent domain of it */
+    Vector<String, 8> suffixes;
+    int pos = 0;
+    while (pos != -1) {
+        String suffix = pos ? host.substring(pos) : host;
+        pos = host.find('.', pos);
+        if (pos != -1)
+            pos++;
+        if (lookup(suffix))
+            suffixes.append(suffix);
+    }
 
-        CookieCurl *pCookie = domain->m_head;
-        while (pCookie) {
-            CookieCurl *pNext = pCookie->m_next;
+    /* loading a domain may have dropped another one, so look them up again */
+    Vector<CookieCurl*, 16> matched;
+    for (size_t i = 0; i < suffixes.size(); i++) {
+        DomainCookie *domain = m_domains.get(suffixes[i]);
+        if (!domain)
+            continue;
 
+        for (CookieCurl *pCookie = domain->m_head; pCookie; pCookie = pCookie->m_next) {
             if (pCookie->m_isSecure && (!isSecure))
-                goto NextCookie;
-
-            if (! pCookie->isExpired()) {
-                if (path.startsWith(pCookie->m_path) && ((pCookie->m_isDomain) 
-                            || (!pCookie->m_isDomain && matchDomain(pCookie->m_host, host)))) {
-                    if (!strCookie.length()) {
-                        if (pCookie->m_name.isEmpty())
-                            strCookie = pCookie->m_value;
-                        else
-                            strCookie = pCookie->m_name + "=" + pCookie->m_value;
-                    }else {
-                        if (pCookie->m_name.isEmpty())
-                            strCookie += "; " + pCookie->m_value;
-                        else
-                            strCookie += "; " + pCookie->m_name + "=" + pCookie->m_value;
-                    }
-                    domain->incAccessCount();
-                    pCookie->incAccessCount();
-                }
+                continue;
+
+            if (path.startsWith(pCookie->m_path) && ((pCookie->m_isDomain) 
+                        || (!pCookie->m_isDomain && matchDomain(pCookie->m_host, host)))) {
+                matched.append(pCookie);
+                domain->incAccessCount();
+                pCookie->incAccessCount();
             }
-            else
-                removeCookie(domain, pCookie);
+        }
+    }
 
-NextCookie:            
-            pCookie = pNext;
+    /* each domain is sorted already, merge them by path */
+    std::stable_sort(matched.begin(), matched.end(), longerCookiePath);
+
+    StringBuilder strCookie;
+    for (size_t i = 0; i < matched.size(); i++) {
+        CookieCurl *pCookie = matched[i];
+        if (i)
+            strCookie.append("; ");
+        if (!pCookie->m_name.isEmpty()) {
+            strCookie.append(pCookie->m_name);
+            strCookie.append('=');
         }
+        strCookie.append(pCookie->m_value);
     }
-    return strCookie;
+    return strCookie.toString();
 }
 
 String CookieManager::get(const KURL &url)
@@ -356,20 +502,14 @@ bool CookieManager::removeAll(void)
 
 void CookieManager::clearCookies(void)
 {
-#define MAX_FILENAME 256
     lock();
 
-    for (unsigned int i=0; i<m_domains.size(); i++) {
-        removeCookies(m_domains[i]);
-#if ENABLE(FILECOOKIE)    
-        m_archiver->deleteDomain(m_domains[i]);
-#endif
-    }
+    vector<DomainCookie*> all = domains();
+    for (size_t i=0; i<all.size(); i++)
+        removeDomain(all[i]);
 
 #if ENABLE(FILECOOKIE)
-    char fileName[MAX_FILENAME];
-    snprintf(fileName, sizeof(fileName)-1, "%s/index.dat", cookieDir());
-    deleteFile(fileName);
+    m_archiver->clear();
 #endif
     unlock();
 
@@ -399,69 +539,51 @@ bool CookieManager::cookiesEnabled()
    return m_enableCookie;
 }
 
-int CookieManager::removeLRUDomains()
+int CookieManager::removeLRUDomains(DomainCookie *keep)
 {
-    /* check the number of domains */
-    int reserved = m_domains.size() /3;
-    int removed = m_domains.size() / 3;
+    vector<DomainCookie*> all = domains();
+    int removed = all.size() / 3;
+    if (!removed)
+        removed = 1;
 
-    partial_sort(m_domains.begin() + reserved, m_domains.end(), m_domains.end());
+    /* remove the least accessed third of the domains */
+    sort(all.begin(), all.end(), lessAccessedDomain);
 
-    for (int i=0; i<removed; i++) {
-        removeCookies(m_domains[i]);
-#if ENABLE(FILECOOKIE)    
-        m_archiver->deleteDomain(m_domains[i]);
-#endif
+    int count = 0;
+    for (size_t i=0; i<all.size() && count<removed; i++) {
+        if (all[i] == keep)
+            continue;
+        removeDomain(all[i]);
+        count++;
     }
-
-    m_domains.erase(m_domains.begin() + reserved, m_domains.end() - removed);
-    return removed;
+    return count;
 }
 
-int DomainCookie::removeLRUCookies()
+int CookieManager::removeLRUCookies(DomainCookie *domain)
 {
-    if ( !(m_head && m_cookies))
+    ASSERT(domain);
+    if (!domain->m_cookies)
         return 0;
 
-    /* insert last recently used cookies into LRU list */
     vector<CookieCurl*> cookies;
-    CookieCurl* cur = m_head;
-    while (cur) {
-        cookies.insert(cookies.begin(), cur); 
-        cur = cur->m_next;
-    }
+    for (CookieCurl *cur = domain->m_head; cur; cur = cur->m_next)
+        cookies.push_back(cur);
 
-    int reserved = cookies.size() / 3;
     int removed = cookies.size() / 3;
+    if (!removed)
+        removed = 1;
 
-    /* partial sort cookie by accessed count */
-    partial_sort(cookies.begin() + reserved, cookies.end(), cookies.end());
-
-    /* remove LRU cookies */
+    /* remove the least accessed third of the cookies */
+    sort(cookies.begin(), cookies.end(), lessAccessedCookie);
     for (int i=0; i<removed; i++) {
-        cur = cookies[i];
-        if (cookies[i]->m_prev)
-            cookies[i]->m_prev->m_next = cookies[i]->m_next;
-        if (cookies[i]->m_next)
-            cookies[i]->m_next->m_prev = cookies[i]->m_prev;
-        delete cookies[i];
+#if ENABLE(FILECOOKIE)
+        m_archiver->remove(domain, cookies[i]);
+#endif
+        removeCookie(domain, cookies[i]);
     }
-    m_cookies -= removed;
     return removed;
 }
 
-int CookieManager::removeLRUCookies(DomainCookie *domain)
-{
-    ASSERT(domain);
-    int old = domain->m_cookies;
-    m_cookies -= old;
-
-    domain->removeLRUCookies();
-    
-    m_cookies = domain->m_cookies;
-    return old - domain->m_cookies;
-}
-
 int  CookieManager::removeCookies(DomainCookie *domain)
 {
     CookieCurl *pCookie = domain->m_head;
@@ -543,11 +665,12 @@ void CookieManager::dump(void)
     CookieCurl* pCookie = NULL, *loop;
     int cookies = 0;
     
+    vector<DomainCookie*> all = domains();
     fprintf(stderr, "\n*****************Begin Dump Cookies************");
-    for (unsigned int i=0; i<m_domains.size(); i++) {
+    for (unsigned int i=0; i<all.size(); i++) {
         int domaincookies = 0;
-        pCookie = m_domains[i]->m_head;
-        fprintf(stderr, "\ndomain=[%s]:\n", m_domains[i]->m_domain.latin1().data());
+        pCookie = all[i]->m_head;
+        fprintf(stderr, "\ndomain=[%s]:\n", all[i]->m_domain.latin1().data());
         for (loop=pCookie; loop; loop=loop->m_next) {
             fprintf(stderr, "[Host=%s]:", loop->m_host.latin1().data());
             fprintf(stderr, "[path=%s];",loop->m_path.latin1().data());
@@ -559,8 +682,8 @@ void CookieManager::dump(void)
         }
         
         fprintf(stderr, "\nHost Cookies=%d", domaincookies);
-        if (m_domains[i]->m_cookies != domaincookies)
-            fprintf(stderr, "\n%d != %d", m_domains[i]->m_cookies, domaincookies);
+        if (all[i]->m_cookies != domaincookies)
+            fprintf(stderr, "\n%d != %d", all[i]->m_cookies, domaincookies);
         fprintf(stderr, "\n-----------------------------------");
     }
     
@@ -25,7 +25,10 @@
 #include "CookieJar.h"
 #include "CookieCurl.h"
 #include "CookieArchiver.h"
+#include "StringHash.h"
 #include "Threading.h"
+#include <wtf/HashMap.h>
+#include <wtf/Vector.h>
 
 #define LIMIT_COOKIE 1
 #define DEBUG_COOKIE 0
@@ -47,10 +50,10 @@ public:
     DomainCookie(String domain);
     String &domain(){ return m_domain;}
     CookieCurl *head();
+    /* cookies are kept sorted by path, longest path first */
     int add(CookieCurl *newCookie);
     int accessCount() {return m_accessCount;}
     void remove(CookieCurl *cookie);
-    int removeLRUCookies();
     int cookieCount() {return m_cookies;}
 
 private:
@@ -69,7 +72,7 @@ public:
     bool removeAll(void);
     void clearCookies(void);
 
-    vector<DomainCookie*> domains() {return m_domains;}
+    vector<DomainCookie*> domains();
     int cookieCount();
     int setCookieCount(int num);
 
@@ -103,6 +106,14 @@ protected:
     String matchedCookies(const KURL& kurl , String &path);
     int addCookie(DomainCookie *domain, CookieCurl *cookie);
     int removeCookie(const DomainCookie *domain, CookieCurl *cookie);
+    void removeDomain(DomainCookie *domain);
+
+    /* min-heap of the cookies with an expiry date, soonest first */
+    void scheduleExpiry(CookieCurl *cookie);
+    void unscheduleExpiry(CookieCurl *cookie);
+    void siftExpiryUp(size_t index);
+    void siftExpiryDown(size_t index);
+    void removeExpiredCookies(void);
 #if ENABLE(FILECOOKIE)
     bool setCookieDir(const char *path);
     const char* cookieDir();
@@ -110,7 +121,7 @@ protected:
 
 #ifdef LIMIT_COOKIE    
     int removeCookies(DomainCookie *domain);
-    int removeLRUDomains(void);
+    int removeLRUDomains(DomainCookie *keep = 0);
     int removeLRUCookies(DomainCookie *domain);
 #endif
 
@@ -125,7 +136,10 @@ private:
     void unlock() {}
 #endif
 
-    vector<DomainCookie*> m_domains;
+    /* keyed by the domain without the leading dot */
+    typedef HashMap<String, DomainCookie*, CaseFoldingHash> DomainMap;
+    DomainMap m_domains;
+    Vector<CookieCurl*> m_expiryHeap;
     int  m_cookies;
     bool m_enableCookie;   /* default true */
 
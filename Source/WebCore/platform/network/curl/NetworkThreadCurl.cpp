@@ -0,0 +1,338 @@
+/*
+** $Id$
+**
+** NetworkThreadCurl.cpp: run curl transfers on a dedicated thread.
+**
+** Copyright (C) 2003 ~ 2010 Beijing Feynman Software Technology Co., Ltd.
+**
+** All rights reserved by Feynman Software.
+*/
+
+#include "config.h"
+#include "NetworkThreadCurl.h"
+
+#if ENABLE(NETWORK_THREAD)
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <sys/select.h>
+#include <unistd.h>
+#include <wtf/MainThread.h>
+
+namespace WebCore {
+
+// Longest time the thread sleeps when curl has nothing scheduled.
+static const long maxWaitMS = 1000;
+
+struct NetworkThread::Transfer {
+    NetworkThread* thread;
+    ResourceHandle* job;
+    CURL* handle;
+    struct curl_slist* redirectHeaders;
+};
+
+NetworkThread::NetworkThread(EventsAvailableFunction eventsAvailable, void* context)
+    : m_eventsAvailable(eventsAvailable)
+    , m_context(context)
+    , m_curlMultiHandle(0)
+    , m_thread(0)
+    , m_quit(false)
+{
+    m_wakeupPipe[0] = -1;
+    m_wakeupPipe[1] = -1;
+}
+
+NetworkThread::~NetworkThread()
+{
+    if (m_thread) {
+        {
+            MutexLocker lock(m_mutex);
+            m_quit = true;
+        }
+        wakeUp();
+        waitForThreadCompletion(m_thread, 0);
+    }
+
+    HashMap<CURL*, Transfer*>::iterator end = m_transfers.end();
+    for (HashMap<CURL*, Transfer*>::iterator it = m_transfers.begin(); it != end; ++it) {
+        curl_multi_remove_handle(m_curlMultiHandle, it->first);
+        curl_easy_cleanup(it->first);
+        curl_slist_free_all(it->second->redirectHeaders);
+        delete it->second;
+    }
+    deleteAllValues(m_events);
+
+    if (m_curlMultiHandle)
+        curl_multi_cleanup(m_curlMultiHandle);
+    if (m_wakeupPipe[0] != -1) {
+        close(m_wakeupPipe[0]);
+        close(m_wakeupPipe[1]);
+    }
+}
+
+bool NetworkThread::start()
+{
+    if (pipe(m_wakeupPipe)) {
+        m_wakeupPipe[0] = -1;
+        m_wakeupPipe[1] = -1;
+        return false;
+    }
+    fcntl(m_wakeupPipe[0], F_SETFL, fcntl(m_wakeupPipe[0], F_GETFL) | O_NONBLOCK);
+    fcntl(m_wakeupPipe[1], F_SETFL, fcntl(m_wakeupPipe[1], F_GETFL) | O_NONBLOCK);
+
+    m_curlMultiHandle = curl_multi_init();
+    if (!m_curlMultiHandle)
+        return false;
+
+    m_thread = createThread(threadEntry, this, "WebCore: Network");
+    return m_thread;
+}
+
+void NetworkThread::addHandle(ResourceHandle* job, CURL* handle, struct curl_slist* redirectHeaders)
+{
+    Transfer* transfer = new Transfer;
+    transfer->thread = this;
+    transfer->job = job;
+    transfer->handle = handle;
+    transfer->redirectHeaders = redirectHeaders;
+
+    // The handle is not shared with the thread yet, so it is safe to set it up here.
+    curl_easy_setopt(handle, CURLOPT_WRITEFUNCTION, writeCallback);
+    curl_easy_setopt(handle, CURLOPT_WRITEDATA, transfer);
+    curl_easy_setopt(handle, CURLOPT_HEADERFUNCTION, headerCallback);
+    curl_easy_setopt(handle, CURLOPT_WRITEHEADER, transfer);
+
+    Command command = { Command::Add, handle, transfer };
+    postCommand(command);
+}
+
+void NetworkThread::removeHandle(CURL* handle)
+{
+    Command command = { Command::Remove, handle, 0 };
+    postCommand(command);
+}
+
+void NetworkThread::pauseHandle(CURL* handle, bool paused)
+{
+    Command command = { paused ? Command::Pause : Command::Resume, handle, 0 };
+    postCommand(command);
+}
+
+void NetworkThread::takeEvents(Vector<NetworkEvent*>& events)
+{
+    MutexLocker lock(m_mutex);
+    if (events.isEmpty())
+        events.swap(m_events);
+    else {
+        events.append(m_events);
+        m_events.clear();
+    }
+}
+
+void NetworkThread::postCommand(const Command& command)
+{
+    {
+        MutexLocker lock(m_mutex);
+        m_commands.append(command);
+    }
+    wakeUp();
+}
+
+void NetworkThread::wakeUp()
+{
+    char c = 0;
+    // A full pipe already guarantees a wake up, the error can be ignored.
+    while (write(m_wakeupPipe[1], &c, 1) == -1 && errno == EINTR) { }
+}
+
+// Queues an event for the main thread. Only the first event of a batch
+// posts to the main thread, the rest is picked up with it.
+void NetworkThread::postEvent(NetworkEvent* event)
+{
+    bool wasEmpty;
+    {
+        MutexLocker lock(m_mutex);
+        wasEmpty = m_events.isEmpty();
+        m_events.append(event);
+    }
+    if (wasEmpty)
+        callOnMainThread(m_eventsAvailable, m_context);
+}
+
+void NetworkThread::appendData(Transfer* transfer, const char* data, size_t length)
+{
+    {
+        MutexLocker lock(m_mutex);
+        if (!m_events.isEmpty()) {
+            NetworkEvent* last = m_events.last();
+            if (last->type == NetworkEvent::Data && last->handle == transfer->handle) {
+                last->data.append(data, length);
+                return;
+            }
+        }
+    }
+
+    NetworkEvent* event = new NetworkEvent(NetworkEvent::Data, transfer->job, transfer->handle);
+    const char* url = 0;
+    curl_easy_getinfo(transfer->handle, CURLINFO_RESPONSE_CODE, &event->httpCode);
+    curl_easy_getinfo(transfer->handle, CURLINFO_EFFECTIVE_URL, &url);
+    event->effectiveURL = url;
+    event->data.append(data, length);
+    postEvent(event);
+}
+
+size_t NetworkThread::headerCallback(char* ptr, size_t size, size_t nmemb, void* data)
+{
+    Transfer* transfer = static_cast<Transfer*>(data);
+    size_t totalSize = size * nmemb;
+
+    NetworkEvent* event = new NetworkEvent(NetworkEvent::Header, transfer->job, transfer->handle);
+    event->data.append(ptr, totalSize);
+
+    bool terminator = (totalSize == 2 && ptr[0] == '\r' && ptr[1] == '\n') || (totalSize == 1 && ptr[0] == '\n');
+    if (terminator) {
+        const char* url = 0;
+        curl_easy_getinfo(transfer->handle, CURLINFO_CONTENT_LENGTH_DOWNLOAD, &event->contentLength);
+        curl_easy_getinfo(transfer->handle, CURLINFO_EFFECTIVE_URL, &url);
+        curl_easy_getinfo(transfer->handle, CURLINFO_RESPONSE_CODE, &event->httpCode);
+        event->effectiveURL = url;
+
+        // curl follows the redirect before the main thread sees the
+        // response, so the request headers have to be swapped here.
+        if (event->httpCode >= 300 && event->httpCode < 400)
+            curl_easy_setopt(transfer->handle, CURLOPT_HTTPHEADER, transfer->redirectHeaders);
+    }
+
+    transfer->thread->postEvent(event);
+    return totalSize;
+}
+
+size_t NetworkThread::writeCallback(void* ptr, size_t size, size_t nmemb, void* data)
+{
+    Transfer* transfer = static_cast<Transfer*>(data);
+    size_t totalSize = size * nmemb;
+    transfer->thread->appendData(transfer, static_cast<const char*>(ptr), totalSize);
+    return totalSize;
+}
+
+void* NetworkThread::threadEntry(void* data)
+{
+    static_cast<NetworkThread*>(data)->run();
+    return 0;
+}
+
+// Returns false once the thread has been asked to quit.
+bool NetworkThread::runCommands()
+{
+    Vector<Command> commands;
+    {
+        MutexLocker lock(m_mutex);
+        if (m_quit)
+            return false;
+        commands.swap(m_commands);
+    }
+
+    for (size_t i = 0; i < commands.size(); i++) {
+        const Command& command = commands[i];
+        switch (command.type) {
+        case Command::Add:
+            m_transfers.set(command.handle, command.transfer);
+            curl_multi_add_handle(m_curlMultiHandle, command.handle);
+            break;
+        case Command::Remove: {
+            Transfer* transfer = m_transfers.take(command.handle);
+            if (!transfer)
+                break;
+            curl_multi_remove_handle(m_curlMultiHandle, command.handle);
+            curl_easy_cleanup(command.handle);
+            curl_slist_free_all(transfer->redirectHeaders);
+            postEvent(new NetworkEvent(NetworkEvent::Removed, transfer->job, command.handle));
+            delete transfer;
+            break;
+        }
+        case Command::Pause:
+        case Command::Resume:
+#if LIBCURL_VERSION_NUM > 0x071200
+            if (m_transfers.contains(command.handle))
+                curl_easy_pause(command.handle, command.type == Command::Pause ? CURLPAUSE_ALL : CURLPAUSE_CONT);
+#endif
+            break;
+        }
+    }
+    return true;
+}
+
+void NetworkThread::processFinishedTransfers()
+{
+    while (true) {
+        int messagesInQueue;
+        CURLMsg* msg = curl_multi_info_read(m_curlMultiHandle, &messagesInQueue);
+        if (!msg)
+            break;
+        if (CURLMSG_DONE != msg->msg)
+            continue;
+
+        Transfer* transfer = m_transfers.get(msg->easy_handle);
+        if (!transfer)
+            continue;
+
+        // The handle stays in the multi handle until the main thread has
+        // handled the result and asks for its removal.
+        NetworkEvent* event = new NetworkEvent(NetworkEvent::Finished, transfer->job, transfer->handle);
+        const char* url = 0;
+        event->result = msg->data.result;
+        curl_easy_getinfo(transfer->handle, CURLINFO_RESPONSE_CODE, &event->httpCode);
+        curl_easy_getinfo(transfer->handle, CURLINFO_EFFECTIVE_URL, &url);
+        event->effectiveURL = url;
+        postEvent(event);
+    }
+}
+
+void NetworkThread::run()
+{
+    while (runCommands()) {
+        fd_set fdread;
+        fd_set fdwrite;
+        fd_set fdexcep;
+        int maxfd = -1;
+
+        FD_ZERO(&fdread);
+        FD_ZERO(&fdwrite);
+        FD_ZERO(&fdexcep);
+        curl_multi_fdset(m_curlMultiHandle, &fdread, &fdwrite, &fdexcep, &maxfd);
+        FD_SET(m_wakeupPipe[0], &fdread);
+        if (m_wakeupPipe[0] > maxfd)
+            maxfd = m_wakeupPipe[0];
+
+        long timeoutMS = -1;
+        curl_multi_timeout(m_curlMultiHandle, &timeoutMS);
+        if (timeoutMS < 0 || timeoutMS > maxWaitMS)
+            timeoutMS = maxWaitMS;
+
+        struct timeval timeout;
+        timeout.tv_sec = timeoutMS / 1000;
+        timeout.tv_usec = (timeoutMS % 1000) * 1000;
+
+        int rc = ::select(maxfd + 1, &fdread, &fdwrite, &fdexcep, &timeout);
+        if (rc == -1 && errno != EINTR) {
+#ifndef NDEBUG
+            perror("network thread: select() returned -1: ");
+#endif
+        }
+
+        if (rc > 0 && FD_ISSET(m_wakeupPipe[0], &fdread)) {
+            char buffer[64];
+            while (read(m_wakeupPipe[0], buffer, sizeof(buffer)) > 0) { }
+        }
+
+        int runningHandles = 0;
+        while (curl_multi_perform(m_curlMultiHandle, &runningHandles) == CURLM_CALL_MULTI_PERFORM) { }
+
+        processFinishedTransfers();
+    }
+}
+
+} // namespace WebCore
+
+#endif // ENABLE(NETWORK_THREAD)
@@ -0,0 +1,123 @@
+/*
+** $Id$
+**
+** NetworkThreadCurl.h: run curl transfers on a dedicated thread.
+**
+** Copyright (C) 2003 ~ 2010 Beijing Feynman Software Technology Co., Ltd.
+**
+** All rights reserved by Feynman Software.
+*/
+
+#ifndef NetworkThreadCurl_h
+#define NetworkThreadCurl_h
+
+#if ENABLE(NETWORK_THREAD)
+
+#include <curl/curl.h>
+#include <wtf/HashMap.h>
+#include <wtf/Noncopyable.h>
+#include <wtf/Threading.h>
+#include <wtf/Vector.h>
+#include <wtf/text/CString.h>
+
+namespace WebCore {
+
+class ResourceHandle;
+
+// What the network thread reports back about a transfer. Events of a job
+// arrive in the order curl produced them, Removed always comes last.
+struct NetworkEvent {
+    enum Type {
+        Header,   // one header line in data, the fields below are set on the last one
+        Data,     // body bytes, consecutive blocks of a transfer are merged
+        Finished, // the transfer is done, result tells how it went
+        Removed   // the handle has been cleaned up, the job can be released
+    };
+
+    NetworkEvent(Type type, ResourceHandle* job, CURL* handle)
+        : type(type)
+        , job(job)
+        , handle(handle)
+        , result(CURLE_OK)
+        , httpCode(0)
+        , contentLength(0)
+    {
+    }
+
+    Type type;
+    ResourceHandle* job;
+    CURL* handle;
+    Vector<char> data;
+    CURLcode result;
+    long httpCode;
+    double contentLength;
+    CString effectiveURL;
+};
+
+// Owns a curl multi handle and drives it from its own thread, so that name
+// resolution, TLS and socket reads do not compete with layout and painting.
+// All calls are made from the main thread; the events are collected and
+// handed over in batches.
+class NetworkThread {
+    WTF_MAKE_NONCOPYABLE(NetworkThread);
+public:
+    // Called on the main thread when events become available.
+    typedef void (*EventsAvailableFunction)(void* context);
+
+    NetworkThread(EventsAvailableFunction, void* context);
+    ~NetworkThread();
+
+    bool start();
+
+    // The handle must be fully set up, the network thread replaces its
+    // header and write callbacks. redirectHeaders are the request headers
+    // to use once curl follows a redirect, ownership is taken.
+    void addHandle(ResourceHandle*, CURL*, struct curl_slist* redirectHeaders);
+    // Stops the transfer and cleans up the handle; a Removed event follows.
+    void removeHandle(CURL*);
+    void pauseHandle(CURL*, bool paused);
+
+    // Appends all pending events to events, the caller owns them.
+    void takeEvents(Vector<NetworkEvent*>& events);
+
+private:
+    struct Transfer;
+    struct Command {
+        enum Type { Add, Remove, Pause, Resume };
+        Type type;
+        CURL* handle;
+        Transfer* transfer;
+    };
+
+    static void* threadEntry(void*);
+    static size_t headerCallback(char* ptr, size_t size, size_t nmemb, void* data);
+    static size_t writeCallback(void* ptr, size_t size, size_t nmemb, void* data);
+
+    void run();
+    bool runCommands();
+    void processFinishedTransfers();
+    void postCommand(const Command&);
+    void postEvent(NetworkEvent*);
+    void appendData(Transfer*, const char* data, size_t length);
+    void wakeUp();
+
+    EventsAvailableFunction m_eventsAvailable;
+    void* m_context;
+    CURLM* m_curlMultiHandle;
+    ThreadIdentifier m_thread;
+    int m_wakeupPipe[2];
+
+    // Touched by the network thread only.
+    HashMap<CURL*, Transfer*> m_transfers;
+
+    Mutex m_mutex;
+    Vector<Command> m_commands;
+    Vector<NetworkEvent*> m_events;
+    bool m_quit;
+};
+
+} // namespace WebCore
+
+#endif // ENABLE(NETWORK_THREAD)
+
+#endif // NetworkThreadCurl_h
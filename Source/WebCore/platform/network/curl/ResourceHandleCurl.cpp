@@ -155,6 +155,11 @@ void ResourceHandle::setClientCertificate(const String& host, CFDataRef cert)
 
 void ResourceHandle::platformSetDefersLoading(bool defers)
 {
+#if ENABLE(NETWORK_THREAD)
+    if (ResourceHandleManager::sharedInstance()->setDefersLoading(this, defers))
+        return;
+#endif
+
 #if LIBCURL_VERSION_NUM > 0x071200
     if (!d->m_handle)
         return;
@@ -46,6 +46,7 @@
 #include "ResourceHandle.h"
 #include "ResourceHandleInternal.h"
 
+#include <algorithm>
 #include <errno.h>
 #include <stdio.h>
 #if USE(CF)
@@ -62,6 +63,12 @@
 #include "CredentialStorage.h"
 #include "MIMETypeMg.h"
 #include "CookieJar.h"
+#include "EventLoopMg.h"
+#include <wtf/CurrentTime.h>
+#endif
+
+#if ENABLE(NETWORK_THREAD)
+#include "NetworkThreadCurl.h"
 #endif
 
 
@@ -74,15 +81,23 @@
 #include "CertificateMg.h"
 #endif
 
+#if PLATFORM(MG) && ENABLE(SCHEMEEXTENSION)
+#include "SchemeExtension.h"
+#endif
+
 namespace WebCore {
 
 const int selectTimeoutMS = 5;
+const int maxRunningJobs = 5;
+const int maxRunningJobsPerHost = 4;
 
 //make the download fast
 #if PLATFORM(MG)
 const double pollTimeSeconds = 0;
-const int maxRunningJobs = 5;
 static const long networkTimeoutSeconds= 8;
+// upper bound for sleeping while transfers are running, so that handles
+// timed out by cancel() are still reaped when their sockets stay quiet.
+const double socketWatchdogSeconds = 1;
 #else
 const double pollTimeSeconds = 0.05;
 #endif
@@ -103,6 +118,59 @@ static int getTypeFromeURL(const char *url)
 }
 #endif
 
+// Jobs the parser or the first layout waits for are started before
+// anything else, whatever load priority they were given.
+enum {
+    RenderBlockingPriority = ResourceLoadPriorityHighest + 1,
+    SchedulingPriorityCount
+};
+
+struct ResourceHandleManager::HostJobs {
+    HostJobs() : runningJobs(0) { }
+
+    bool isEmpty() const
+    {
+        if (runningJobs)
+            return false;
+        for (int i = 0; i < SchedulingPriorityCount; i++) {
+            if (!scheduledJobs[i].isEmpty())
+                return false;
+        }
+        return true;
+    }
+
+    Vector<ScheduledJob> scheduledJobs[SchedulingPriorityCount];
+    int runningJobs;
+};
+
+static String hostKeyForURL(const KURL& url)
+{
+    String key = url.protocol().lower();
+    key.append("://");
+    key.append(url.host().lower());
+    if (url.hasPort()) {
+        key.append(":");
+        key.append(String::number(url.port()));
+    }
+    return key;
+}
+
+static int schedulingPriorityForRequest(const ResourceRequest& request)
+{
+    switch (request.targetType()) {
+    case ResourceRequest::TargetIsMainFrame:
+    case ResourceRequest::TargetIsSubframe:
+    case ResourceRequest::TargetIsStyleSheet:
+    case ResourceRequest::TargetIsScript:
+        return RenderBlockingPriority;
+    default:
+        break;
+    }
+    if (request.priority() == ResourceLoadPriorityUnresolved)
+        return ResourceLoadPriorityLow;
+    return request.priority();
+}
+
 static const bool ignoreSSLErrors = getenv("WEBKIT_IGNORE_SSL_ERRORS");
 
 static CString certificatePath()
@@ -161,23 +229,52 @@ static void curl_unlock_callback(CURL* handle, curl_lock_data data, void* userPt
 ResourceHandleManager::ResourceHandleManager()
     : m_downloadTimer(this, &ResourceHandleManager::downloadTimerCallback)
     , m_cookieJarFileName(0)
+    , m_scheduledJobSequence(0)
     , m_certificatePath (certificatePath())
     , m_runningJobs(0)
+    , m_maxRunningJobs(maxRunningJobs)
+    , m_maxRunningJobsPerHost(maxRunningJobsPerHost)
+    , m_priorityLoadingEnabled(true)
+#if PLATFORM(MG)
+    , m_curlTimeout(-1)
+#endif
+#if ENABLE(NETWORK_THREAD)
+    , m_dispatchingNetworkEvents(false)
+#endif
 
 {
     curl_global_init(CURL_GLOBAL_ALL);
     m_curlMultiHandle = curl_multi_init();
+#if PLATFORM(MG)
+    // let curl tell us which sockets to wait for instead of polling with select()
+    curl_multi_setopt(m_curlMultiHandle, CURLMOPT_SOCKETFUNCTION, curlSocketCallback);
+    curl_multi_setopt(m_curlMultiHandle, CURLMOPT_SOCKETDATA, this);
+    curl_multi_setopt(m_curlMultiHandle, CURLMOPT_TIMERFUNCTION, curlTimerCallback);
+    curl_multi_setopt(m_curlMultiHandle, CURLMOPT_TIMERDATA, this);
+#endif
     m_curlShareHandle = curl_share_init();
     curl_share_setopt(m_curlShareHandle, CURLSHOPT_SHARE, CURL_LOCK_DATA_COOKIE);
     curl_share_setopt(m_curlShareHandle, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
     curl_share_setopt(m_curlShareHandle, CURLSHOPT_LOCKFUNC, curl_lock_callback);
     curl_share_setopt(m_curlShareHandle, CURLSHOPT_UNLOCKFUNC, curl_unlock_callback);
+
+#if ENABLE(NETWORK_THREAD)
+    // Without the thread every job simply stays on m_curlMultiHandle.
+    m_networkThread = adoptPtr(new NetworkThread(networkEventsAvailable, this));
+    if (!m_networkThread->start())
+        m_networkThread.clear();
+#endif
 }
 
 ResourceHandleManager::~ResourceHandleManager()
 {
+#if ENABLE(NETWORK_THREAD)
+    m_networkThread.clear();
+    deleteAllValues(m_heldNetworkEvents);
+#endif
     curl_multi_cleanup(m_curlMultiHandle);
     curl_share_cleanup(m_curlShareHandle);
+    deleteAllValues(m_hostJobs);
     if (m_cookieJarFileName)
         fastFree(m_cookieJarFileName);
     curl_global_cleanup();
@@ -196,17 +293,14 @@ ResourceHandleManager* ResourceHandleManager::sharedInstance()
     return sharedInstance;
 }
 
-static void handleLocalReceiveResponse (CURL* handle, ResourceHandle* job, ResourceHandleInternal* d)
+static void handleLocalReceiveResponse (const char* effectiveURL, ResourceHandle* job, ResourceHandleInternal* d)
 {
     // since the code in headerCallback will not have run for local files
     // the code to set the URL and fire didReceiveResponse is never run,
     // which means the ResourceLoader's response does not contain the URL.
     // Run the code here for local files to resolve the issue.
     // TODO: See if there is a better approach for handling this.
-     const char* hdr;
-     CURLcode err = curl_easy_getinfo(handle, CURLINFO_EFFECTIVE_URL, &hdr);
-     ASSERT_UNUSED(err, CURLE_OK == err);
-     d->m_response.setURL(KURL(ParsedURLString, hdr));
+     d->m_response.setURL(KURL(ParsedURLString, effectiveURL));
      if (d->client())
          d->client()->didReceiveResponse(job, d->m_response);
      d->m_response.setResponseFired(true);
@@ -279,6 +373,34 @@ void ResourceHandleManager::doFtpAuth(ResourceHandle* job)
 }
 #endif
 
+// Hands a block of the body to the client. Returns false when the job got
+// cancelled while firing the response.
+static bool didReceiveBody(ResourceHandle* job, const char* data, size_t length, const char* effectiveURL, long httpCode, bool hasHttpCode)
+{
+    ResourceHandleInternal* d = job->getInternal();
+
+    // this shouldn't be necessary but apparently is. CURL writes the data
+    // of html page even if it is a redirect that was handled internally
+    // can be observed e.g. on gmail.com
+    if (hasHttpCode && httpCode >= 300 && httpCode < 400)
+        return true;
+
+#if PLATFORM(MG)
+    if (hasHttpCode && (isAuthentication(httpCode) && d->m_authenticate))
+        return true;
+#endif
+
+    if (!d->m_response.responseFired()) {
+        handleLocalReceiveResponse(effectiveURL, job, d);
+        if (d->m_cancelled)
+            return false;
+    }
+
+    if (d->client())
+        d->client()->didReceiveData(job, data, length, 0);
+    return true;
+}
+
 // called with data after all headers have been processed via headerCallback
 static size_t writeCallback(void* ptr, size_t size, size_t nmemb, void* data)
 {
@@ -294,28 +416,15 @@ static size_t writeCallback(void* ptr, size_t size, size_t nmemb, void* data)
 
     size_t totalSize = size * nmemb;
 
-    // this shouldn't be necessary but apparently is. CURL writes the data
-    // of html page even if it is a redirect that was handled internally
-    // can be observed e.g. on gmail.com
     CURL* h = d->m_handle;
     long httpCode = 0;
     CURLcode err = curl_easy_getinfo(h, CURLINFO_RESPONSE_CODE, &httpCode);
-    if (CURLE_OK == err && httpCode >= 300 && httpCode < 400)
-        return totalSize;
-
-#if PLATFORM(MG)
-    if (CURLE_OK == err && (isAuthentication(httpCode) && d->m_authenticate))
-        return totalSize;
-#endif
-
-    if (!d->m_response.responseFired()) {
-        handleLocalReceiveResponse(h, job, d);
-        if (d->m_cancelled)
-            return 0;
-    }
+    const char* url = 0;
+    if (!d->m_response.responseFired())
+        curl_easy_getinfo(h, CURLINFO_EFFECTIVE_URL, &url);
 
-    if (d->client())
-        d->client()->didReceiveData(job, static_cast<char*>(ptr), totalSize, 0);
+    if (!didReceiveBody(job, static_cast<char*>(ptr), totalSize, url, httpCode, CURLE_OK == err))
+        return 0;
     return totalSize;
 }
 
@@ -410,32 +519,53 @@ const char * getHttpTextFromHttpCode(int httpCode)
 }
 #endif
 
+// Request headers to send when curl follows a redirect: the original ones
+// without the form content type, the redirected request is a GET.
+static struct curl_slist* redirectHeaders(ResourceHandle* job)
+{
+    struct curl_slist* headers = 0;
+    if (job->firstRequest().httpHeaderFields().size() > 0) {
+        HTTPHeaderMap customHeaders = job->firstRequest().httpHeaderFields();
+        HTTPHeaderMap::const_iterator end = customHeaders.end();
+        for (HTTPHeaderMap::const_iterator it = customHeaders.begin(); it != end; ++it) {
+            String key = it->first;
+            String value = it->second;
+            String headerString(key);
+            headerString.append(": ");
+            headerString.append(value);
+            CString headerLatin1 = headerString.latin1();
+			// fix bug5696
+            if (value == "application/x-www-form-urlencoded")
+            {
+                continue;
+            }
+            headers = curl_slist_append(headers, headerLatin1.data());
+        }
+    }
+    return headers;
+}
+
+static inline bool isHeaderTerminator(const String& header)
+{
+    return header == String("\r\n") || header == String("\n");
+}
+
 /*
- * This is being called for each HTTP header in the response. This includes '\r\n'
+ * Handles one HTTP header line of the response. This includes '\r\n'
  * for the last line of the header.
  *
  * We will add each HTTP Header to the ResourceResponse and on the termination
  * of the header (\r\n) we will parse Content-Type and Content-Disposition and
  * update the ResourceResponse and then send it away.
  *
+ * contentLength, effectiveURL and httpCode are only used for the terminating
+ * line. updateHandle is false when the handle belongs to the network thread.
  */
-static size_t headerCallback(char* ptr, size_t size, size_t nmemb, void* data)
+static void didReceiveHeaderLine(ResourceHandle* job, const String& header, double contentLength, const char* effectiveURL, long httpCode, bool updateHandle)
 {
-    ResourceHandle* job = static_cast<ResourceHandle*>(data);
     ResourceHandleInternal* d = job->getInternal();
-    if (d->m_cancelled)
-        return 0;
-
-#if LIBCURL_VERSION_NUM > 0x071200
-    // We should never be called when deferred loading is activated.
-    ASSERT(!d->m_defersLoading);
-#endif
-
-    size_t totalSize = size * nmemb;
     ResourceHandleClient* client = d->client();
 
-    String header(static_cast<const char*>(ptr), totalSize);
-
     /*
      * a) We can finish and send the ResourceResponse
      * b) We will add the current header to the HTTPHeaderMap of the ResourceResponse
@@ -443,20 +573,9 @@ static size_t headerCallback(char* ptr, size_t size, size_t nmemb, void* data)
      * The HTTP standard requires to use \r\n but for compatibility it recommends to
      * accept also \n.
      */
-    if (header == String("\r\n") || header == String("\n")) {
-        CURL* h = d->m_handle;
-        CURLcode err;
-
-        double contentLength = 0;
-        err = curl_easy_getinfo(h, CURLINFO_CONTENT_LENGTH_DOWNLOAD, &contentLength);
+    if (isHeaderTerminator(header)) {
         d->m_response.setExpectedContentLength(static_cast<long long int>(contentLength));
-
-        const char* hdr;
-        err = curl_easy_getinfo(h, CURLINFO_EFFECTIVE_URL, &hdr);
-        d->m_response.setURL(KURL(ParsedURLString, hdr));
-
-        long httpCode = 0;
-        err = curl_easy_getinfo(h, CURLINFO_RESPONSE_CODE, &httpCode);
+        d->m_response.setURL(KURL(ParsedURLString, effectiveURL));
         d->m_response.setHTTPStatusCode(httpCode);
 
 #if PLATFORM(MG)
@@ -492,6 +611,11 @@ static size_t headerCallback(char* ptr, size_t size, size_t nmemb, void* data)
 
                 d->m_firstRequest.setURL(newURL);
 
+                // The network thread swaps the request headers itself, it
+                // owns the handle.
+                if (!updateHandle)
+                    return;
+
                 // clear location request header
                 if (d->m_customHeaders)
                 {
@@ -500,32 +624,13 @@ static size_t headerCallback(char* ptr, size_t size, size_t nmemb, void* data)
                     d->m_customHeaders = NULL;
                 }
 
-                struct curl_slist* headers = 0;
-                if (job->firstRequest().httpHeaderFields().size() > 0) {
-                    HTTPHeaderMap customHeaders = job->firstRequest().httpHeaderFields();
-                    HTTPHeaderMap::const_iterator end = customHeaders.end();
-                    for (HTTPHeaderMap::const_iterator it = customHeaders.begin(); it != end; ++it) {
-                        String key = it->first;
-                        String value = it->second;
-                        String headerString(key);
-                        headerString.append(": ");
-                        headerString.append(value);
-                        CString headerLatin1 = headerString.latin1();
-						// fix bug5696
-                        if (value == "application/x-www-form-urlencoded")
-                        {
-                            continue;
-                        }
-                        headers = curl_slist_append(headers, headerLatin1.data());
-                    }
-                }
-
+                struct curl_slist* headers = redirectHeaders(job);
                 if (headers) {
                     curl_easy_setopt(d->m_handle, CURLOPT_HTTPHEADER, headers);
                     d->m_customHeaders = headers;
                 }
 
-                return totalSize;
+                return;
             }
         }
 
@@ -555,7 +660,35 @@ static size_t headerCallback(char* ptr, size_t size, size_t nmemb, void* data)
 	}
 #endif
 #endif
-	
+}
+
+// This is being called for each HTTP header in the response.
+static size_t headerCallback(char* ptr, size_t size, size_t nmemb, void* data)
+{
+    ResourceHandle* job = static_cast<ResourceHandle*>(data);
+    ResourceHandleInternal* d = job->getInternal();
+    if (d->m_cancelled)
+        return 0;
+
+#if LIBCURL_VERSION_NUM > 0x071200
+    // We should never be called when deferred loading is activated.
+    ASSERT(!d->m_defersLoading);
+#endif
+
+    size_t totalSize = size * nmemb;
+    String header(static_cast<const char*>(ptr), totalSize);
+
+    double contentLength = 0;
+    const char* effectiveURL = 0;
+    long httpCode = 0;
+    if (isHeaderTerminator(header)) {
+        CURL* h = d->m_handle;
+        curl_easy_getinfo(h, CURLINFO_CONTENT_LENGTH_DOWNLOAD, &contentLength);
+        curl_easy_getinfo(h, CURLINFO_EFFECTIVE_URL, &effectiveURL);
+        curl_easy_getinfo(h, CURLINFO_RESPONSE_CODE, &httpCode);
+    }
+
+    didReceiveHeaderLine(job, header, contentLength, effectiveURL, httpCode, true);
     return totalSize;
 }
 
@@ -598,8 +731,32 @@ size_t readCallback(void* ptr, size_t size, size_t nmemb, void* data)
 
 void ResourceHandleManager::downloadTimerCallback(Timer<ResourceHandleManager>* timer)
 {
+#if ENABLE(NETWORK_THREAD)
+    // events held back while a job deferred loading
+    if (!m_heldNetworkEvents.isEmpty())
+        dispatchNetworkEvents();
+#endif
+
     startScheduledJobs();
 
+#if PLATFORM(MG)
+    // Socket activity is delivered through socketNotifierCallback, this timer
+    // only runs curl timeouts and polls the sockets the message loop could not
+    // take.
+    if (!m_unwatchedSockets.isEmpty())
+        pollUnwatchedSockets();
+
+    int runningHandles = 0;
+    if (m_curlTimeout >= 0 && m_curlTimeout <= currentTime()) {
+        m_curlTimeout = -1;
+        curl_multi_socket_action(m_curlMultiHandle, CURL_SOCKET_TIMEOUT, 0, &runningHandles);
+    } else if (m_runningJobs > 0)
+        curl_multi_socket_all(m_curlMultiHandle, &runningHandles);
+
+    processFinishedTransfers();
+    startScheduledJobs(); // new jobs might have been added in the meantime
+    scheduleCurlTimer();
+#else
     fd_set fdread;
     fd_set fdwrite;
     fd_set fdexcep;
@@ -633,6 +790,17 @@ void ResourceHandleManager::downloadTimerCallback(Timer<ResourceHandleManager>*
     int runningHandles = 0;
     while (curl_multi_perform(m_curlMultiHandle, &runningHandles) == CURLM_CALL_MULTI_PERFORM) { }
 
+    processFinishedTransfers();
+
+    bool started = startScheduledJobs(); // new jobs might have been added in the meantime
+
+    if (!m_downloadTimer.isActive() && (started || (runningHandles > 0)))
+        m_downloadTimer.startOneShot(pollTimeSeconds);
+#endif
+}
+
+void ResourceHandleManager::processFinishedTransfers()
+{
     // check the curl messages indicating completed transfers
     // and free their resources
     while (true) {
@@ -661,58 +829,345 @@ void ResourceHandleManager::downloadTimerCallback(Timer<ResourceHandleManager>*
         if (CURLMSG_DONE != msg->msg)
             continue;
 
-        if (CURLE_OK == msg->data.result || msg->data.result == CURLE_PARTIAL_FILE) {
+        char* url = 0;
+        long responseCode = 0;
+        curl_easy_getinfo(d->m_handle, CURLINFO_EFFECTIVE_URL, &url);
+        curl_easy_getinfo(d->m_handle, CURLINFO_RESPONSE_CODE, &responseCode);
+        finishTransfer(job, msg->data.result, url, responseCode);
+    }
+}
+
+// Reports the end of a transfer to the client and releases the handle.
+void ResourceHandleManager::finishTransfer(ResourceHandle* job, CURLcode result, const char* url, long responseCode)
+{
+    ResourceHandleInternal* d = job->getInternal();
+
+    if (CURLE_OK == result || result == CURLE_PARTIAL_FILE) {
 #if PLATFORM(MG)
-            if (isAuthentication(d->m_response.httpStatusCode())  && d->m_authenticate) {
-                doAuth(job);
-                continue;
-            }
+        if (isAuthentication(d->m_response.httpStatusCode())  && d->m_authenticate) {
+            doAuth(job);
+            return;
+        }
 #endif
-            if (!d->m_response.responseFired()) {
-                handleLocalReceiveResponse(d->m_handle, job, d);
-                if (d->m_cancelled) {
-                    removeFromCurl(job);
-                    continue;
-                }
+        if (!d->m_response.responseFired()) {
+            handleLocalReceiveResponse(url, job, d);
+            if (d->m_cancelled) {
+                removeFromCurl(job);
+                return;
             }
+        }
 
-            if (d->client())
-                d->client()->didFinishLoading(job, 0);
-        } else {
-            if (isFtpAuthentication(d->m_response.httpStatusCode())  && d->m_authenticate)
-            {
-                doFtpAuth(job);
-                continue;
-            }
-            char* url = 0;
-            curl_easy_getinfo(d->m_handle, CURLINFO_EFFECTIVE_URL, &url);
+        if (d->client())
+            d->client()->didFinishLoading(job, 0);
+    } else {
+        if (isFtpAuthentication(d->m_response.httpStatusCode())  && d->m_authenticate)
+        {
+            doFtpAuth(job);
+            return;
+        }
 #ifndef NDEBUG
-            fprintf(stderr, "Curl ERROR for url='%s', error: '%s'\n", url, curl_easy_strerror(msg->data.result));
+        fprintf(stderr, "Curl ERROR for url='%s', error: '%s'\n", url, curl_easy_strerror(result));
 #endif
 #if PLATFORM(MG)
-			long responseCode = 0;
 			int errorType = NoType;
-			curl_easy_getinfo(d->m_handle, CURLINFO_RESPONSE_CODE, &responseCode);	
 			if (responseCode) 
 				errorType=getTypeFromeURL(url);
 			else
 				errorType = CurlNetError;
-            if (d->client())
-                d->client()->didFail(job, ResourceError(String(), msg->data.result, String(url), String(curl_easy_strerror(msg->data.result)),errorType));
+        if (d->client())
+            d->client()->didFail(job, ResourceError(String(), result, String(url), String(curl_easy_strerror(result)),errorType));
 #else
 			if (d->client())
-				d->client()->didFail(job, ResourceError(String(), msg->data.result, String(url), String(curl_easy_strerror(msg->data.result))));
+				d->client()->didFail(job, ResourceError(String(), result, String(url), String(curl_easy_strerror(result))));
 #endif
-        }
+    }
 
-        removeFromCurl(job);
+    removeFromCurl(job);
+}
+
+#if ENABLE(NETWORK_THREAD)
+// Plain HTTP transfers go to the network thread. Streamed POST bodies are
+// read from FormDataStream on the main thread and FTP directory listings
+// are parsed there too, those stay on m_curlMultiHandle. HTTPS transfers
+// stay as well while the embedder verifies certificates, its callbacks are
+// called from the SSL handshake and expect the UI thread. Threaded jobs may
+// only be redirected to plain HTTP, see reissueRedirectOnMainThread().
+bool ResourceHandleManager::shouldUseNetworkThread(ResourceHandle* job) const
+{
+    if (!m_networkThread)
+        return false;
+
+    const ResourceRequest& request = job->firstRequest();
+    if (!request.url().protocolIs("http") && !request.url().protocolIs("https"))
+        return false;
+#if PLATFORM(MG) && ENABLE(SSL)
+#if LIBCURL_VERSION_NUM >= 0x071304
+    if (request.url().protocolIs("https") && hasCertificateCallbacks())
+        return false;
+#else
+    // without CURLOPT_REDIR_PROTOCOLS any job could end up in a handshake
+    if (hasCertificateCallbacks())
+        return false;
+#endif
+#endif
+    if (request.httpBody() && request.httpBody()->elements().size() > 1)
+        return false;
+    return true;
+}
+
+// A threaded job that curl refused to redirect to HTTPS is started again
+// with the redirected request, shouldUseNetworkThread() then decides where
+// the handshake runs. Returns false if the failure was not such a redirect.
+bool ResourceHandleManager::reissueRedirectOnMainThread(ResourceHandle* job, CURLcode result)
+{
+    ResourceHandleInternal* d = job->getInternal();
+    int httpCode = d->m_response.httpStatusCode();
+    if (result != CURLE_UNSUPPORTED_PROTOCOL || httpCode < 300 || httpCode >= 400)
+        return false;
+    // didReceiveHeaderLine() already moved the request to the new location
+    if (!d->m_firstRequest.url().protocolIs("https"))
+        return false;
+
+    removeFromCurl(job);
+
+    // curl turns a POST into a GET when it follows 301, 302 and 303
+    if (httpCode <= 303 && "POST" == d->m_firstRequest.httpMethod()) {
+        d->m_firstRequest.setHTTPMethod("GET");
+        d->m_firstRequest.setHTTPBody(0);
     }
 
-    bool started = startScheduledJobs(); // new jobs might have been added in the meantime
+    // the transfer is over, the handle does not send these again
+    if (d->m_customHeaders) {
+        curl_slist_free_all(d->m_customHeaders);
+        d->m_customHeaders = 0;
+    }
 
-    if (!m_downloadTimer.isActive() && (started || (runningHandles > 0)))
+    //We must free d->m_url, or else ASSERT(!d->m_url) in initializeHandle() failed
+    fastFree(d->m_url);
+    d->m_url = 0;
+
+    add(job);
+    return true;
+}
+
+void ResourceHandleManager::networkEventsAvailable(void* context)
+{
+    static_cast<ResourceHandleManager*>(context)->dispatchNetworkEvents();
+}
+
+// Delivers everything the network thread produced since the last call in one
+// go. Events of a job that defers loading are held back, together with all
+// later events of that job, until it resumes.
+void ResourceHandleManager::dispatchNetworkEvents()
+{
+    // A client may run a nested message loop, the outer call keeps draining.
+    if (m_dispatchingNetworkEvents)
+        return;
+    m_dispatchingNetworkEvents = true;
+
+    Vector<NetworkEvent*> events;
+    events.swap(m_heldNetworkEvents);
+    m_networkThread->takeEvents(events);
+
+    HashSet<ResourceHandle*> heldJobs;
+    while (!events.isEmpty()) {
+        for (size_t i = 0; i < events.size(); i++) {
+            NetworkEvent* event = events[i];
+            ResourceHandleInternal* d = event->job->getInternal();
+            bool stale = event->handle != d->m_handle || d->m_cancelled;
+            if (heldJobs.contains(event->job) || (!stale && d->m_defersLoading)) {
+                heldJobs.add(event->job);
+                m_heldNetworkEvents.append(event);
+                continue;
+            }
+            dispatchNetworkEvent(event);
+            delete event;
+        }
+        events.clear();
+        m_networkThread->takeEvents(events);
+    }
+
+    m_dispatchingNetworkEvents = false;
+
+    startScheduledJobs();
+#if PLATFORM(MG)
+    scheduleCurlTimer();
+#else
+    if (!m_downloadTimer.isActive())
         m_downloadTimer.startOneShot(pollTimeSeconds);
+#endif
+}
+
+void ResourceHandleManager::dispatchNetworkEvent(NetworkEvent* event)
+{
+    ResourceHandle* job = event->job;
+    ResourceHandleInternal* d = job->getInternal();
+
+    // balances the reference taken in add()
+    if (event->type == NetworkEvent::Removed) {
+        job->deref();
+        return;
+    }
+
+    // the job was cancelled or restarted since the thread reported this
+    if (event->handle != d->m_handle || d->m_cancelled)
+        return;
+
+    switch (event->type) {
+    case NetworkEvent::Header:
+        didReceiveHeaderLine(job, String(event->data.data(), event->data.size()), event->contentLength, event->effectiveURL.data(), event->httpCode, false);
+        break;
+    case NetworkEvent::Data:
+        didReceiveBody(job, event->data.data(), event->data.size(), event->effectiveURL.data(), event->httpCode, true);
+        break;
+    case NetworkEvent::Finished:
+        if (reissueRedirectOnMainThread(job, event->result))
+            break;
+        finishTransfer(job, event->result, event->effectiveURL.data(), event->httpCode);
+        break;
+    case NetworkEvent::Removed:
+        break;
+    }
+}
+
+bool ResourceHandleManager::setDefersLoading(ResourceHandle* job, bool defers)
+{
+    ResourceHandleInternal* d = job->getInternal();
+    if (!d->m_handle || !m_threadedJobs.contains(job))
+        return false;
+
+    // Pausing only stops the thread from buffering more, anything already
+    // reported is held in m_heldNetworkEvents.
+    m_networkThread->pauseHandle(d->m_handle, defers);
+    if (!defers && !m_heldNetworkEvents.isEmpty())
+        m_downloadTimer.startOneShot(0);
+    return true;
+}
+#endif
+
+#if PLATFORM(MG)
+int ResourceHandleManager::curlSocketCallback(CURL*, curl_socket_t sockfd, int what, void* userp, void*)
+{
+    ResourceHandleManager* manager = static_cast<ResourceHandleManager*>(userp);
+
+    if (what == CURL_POLL_REMOVE) {
+        unregisterSocketNotifier(sockfd);
+        manager->m_unwatchedSockets.remove(sockfd);
+        return 0;
+    }
+
+    int events = SocketNotifierError;
+    if (what & CURL_POLL_IN)
+        events |= SocketNotifierRead;
+    if (what & CURL_POLL_OUT)
+        events |= SocketNotifierWrite;
+
+    if (registerSocketNotifier(sockfd, events, socketNotifierCallback, manager))
+        manager->m_unwatchedSockets.remove(sockfd);
+    else {
+        manager->m_unwatchedSockets.set(sockfd, what);
+        manager->scheduleCurlTimer();
+    }
+    return 0;
+}
+
+int ResourceHandleManager::curlTimerCallback(CURLM*, long timeoutMS, void* userp)
+{
+    ResourceHandleManager* manager = static_cast<ResourceHandleManager*>(userp);
+    manager->m_curlTimeout = timeoutMS < 0 ? -1 : currentTime() + timeoutMS / 1000.0;
+    manager->scheduleCurlTimer();
+    return 0;
+}
+
+void ResourceHandleManager::socketNotifierCallback(int fd, int events, void* context)
+{
+    int curlEvents = 0;
+    if (events & SocketNotifierRead)
+        curlEvents |= CURL_CSELECT_IN;
+    if (events & SocketNotifierWrite)
+        curlEvents |= CURL_CSELECT_OUT;
+    static_cast<ResourceHandleManager*>(context)->socketAction(fd, curlEvents);
+}
+
+void ResourceHandleManager::socketAction(curl_socket_t sockfd, int curlEvents)
+{
+    int runningHandles = 0;
+    curl_multi_socket_action(m_curlMultiHandle, sockfd, curlEvents, &runningHandles);
+
+    processFinishedTransfers();
+    startScheduledJobs();
+    scheduleCurlTimer();
+}
+
+void ResourceHandleManager::pollUnwatchedSockets()
+{
+    fd_set fdread;
+    fd_set fdwrite;
+    fd_set fdexcep;
+    int maxfd = -1;
+
+    FD_ZERO(&fdread);
+    FD_ZERO(&fdwrite);
+    FD_ZERO(&fdexcep);
+    HashMap<int, int>::const_iterator end = m_unwatchedSockets.end();
+    for (HashMap<int, int>::const_iterator it = m_unwatchedSockets.begin(); it != end; ++it) {
+        if (it->second & CURL_POLL_IN)
+            FD_SET(it->first, &fdread);
+        if (it->second & CURL_POLL_OUT)
+            FD_SET(it->first, &fdwrite);
+        FD_SET(it->first, &fdexcep);
+        maxfd = std::max(maxfd, it->first);
+    }
+
+    // never block the UI thread here, the timer paces the polling
+    struct timeval timeout;
+    timeout.tv_sec = 0;
+    timeout.tv_usec = 0;
+    if (::select(maxfd + 1, &fdread, &fdwrite, &fdexcep, &timeout) <= 0)
+        return;
+
+    // curl_multi_socket_action may change m_unwatchedSockets, collect first
+    Vector<std::pair<int, int> > readySockets;
+    for (HashMap<int, int>::const_iterator it = m_unwatchedSockets.begin(); it != end; ++it) {
+        int curlEvents = 0;
+        if (FD_ISSET(it->first, &fdread))
+            curlEvents |= CURL_CSELECT_IN;
+        if (FD_ISSET(it->first, &fdwrite))
+            curlEvents |= CURL_CSELECT_OUT;
+        if (FD_ISSET(it->first, &fdexcep))
+            curlEvents |= CURL_CSELECT_ERR;
+        if (curlEvents)
+            readySockets.append(std::make_pair(it->first, curlEvents));
+    }
+
+    int runningHandles = 0;
+    for (size_t i = 0; i < readySockets.size(); i++)
+        curl_multi_socket_action(m_curlMultiHandle, readySockets[i].first, readySockets[i].second, &runningHandles);
+}
+
+void ResourceHandleManager::scheduleCurlTimer()
+{
+    double interval = -1;
+    int priority;
+    if (nextScheduledHost(&priority) != m_hostJobs.end())
+        interval = 0;
+    else {
+        if (m_curlTimeout >= 0)
+            interval = std::max(0.0, m_curlTimeout - currentTime());
+        if (m_runningJobs > 0 && (interval < 0 || interval > socketWatchdogSeconds))
+            interval = socketWatchdogSeconds;
+        if (!m_unwatchedSockets.isEmpty() && (interval < 0 || interval > selectTimeoutMS / 1000.0))
+            interval = selectTimeoutMS / 1000.0;
+    }
+
+    if (interval < 0) {
+        m_downloadTimer.stop();
+        return;
+    }
+    if (!m_downloadTimer.isActive() || m_downloadTimer.nextFireInterval() > interval)
+        m_downloadTimer.startOneShot(interval);
 }
+#endif
 
 void ResourceHandleManager::setProxyInfo(const String& host,
                                          unsigned long port,
@@ -740,6 +1195,17 @@ void ResourceHandleManager::removeFromCurl(ResourceHandle* job)
     if (!d->m_handle)
         return;
     m_runningJobs--;
+    jobStoppedForHost(job);
+#if ENABLE(NETWORK_THREAD)
+    if (m_threadedJobs.contains(job)) {
+        m_threadedJobs.remove(job);
+        // The network thread cleans the handle up, the job is released
+        // once it reports back.
+        m_networkThread->removeHandle(d->m_handle);
+        d->m_handle = 0;
+        return;
+    }
+#endif
     curl_multi_remove_handle(m_curlMultiHandle, d->m_handle);
     curl_easy_cleanup(d->m_handle);
     d->m_handle = 0;
@@ -838,38 +1304,135 @@ void ResourceHandleManager::add(ResourceHandle* job)
     // we can be called from within curl, so to avoid re-entrancy issues
     // schedule this job to be added the next time we enter curl download loop
     job->ref();
-    m_resourceHandleList.append(job);
+
+    String hostKey = hostKeyForURL(job->firstRequest().url());
+    HostJobsMap::iterator it = m_hostJobs.find(hostKey);
+    if (it == m_hostJobs.end())
+        it = m_hostJobs.add(hostKey, new HostJobs).first;
+
+    int priority = m_priorityLoadingEnabled ? schedulingPriorityForRequest(job->firstRequest()) : ResourceLoadPriorityLow;
+    ScheduledJob scheduledJob = { job, m_scheduledJobSequence++ };
+    it->second->scheduledJobs[priority].append(scheduledJob);
+#if PLATFORM(MG)
+    scheduleCurlTimer();
+#else
     if (!m_downloadTimer.isActive())
         m_downloadTimer.startOneShot(pollTimeSeconds);
+#endif
 }
 
 bool ResourceHandleManager::removeScheduledJob(ResourceHandle* job)
 {
-    int size = m_resourceHandleList.size();
-    for (int i = 0; i < size; i++) {
-        if (job == m_resourceHandleList[i]) {
-            m_resourceHandleList.remove(i);
-            job->deref();
-            return true;
+    HostJobsMap::iterator end = m_hostJobs.end();
+    for (HostJobsMap::iterator it = m_hostJobs.begin(); it != end; ++it) {
+        HostJobs* host = it->second;
+        for (int priority = 0; priority < SchedulingPriorityCount; priority++) {
+            Vector<ScheduledJob>& jobs = host->scheduledJobs[priority];
+            size_t size = jobs.size();
+            for (size_t i = 0; i < size; i++) {
+                if (job == jobs[i].job) {
+                    jobs.remove(i);
+                    if (host->isEmpty()) {
+                        m_hostJobs.remove(it);
+                        delete host;
+                    }
+                    job->deref();
+                    return true;
+                }
+            }
         }
     }
     return false;
 }
 
-bool ResourceHandleManager::startScheduledJobs()
+// Finds the host whose oldest job of the highest startable priority should
+// run next. Render-blocking jobs are promoted past the per host limit so that
+// a page full of images on one server can not hold back its stylesheets.
+ResourceHandleManager::HostJobsMap::iterator ResourceHandleManager::nextScheduledHost(int* priority)
 {
-    // TODO: Create a separate stack of jobs for each domain.
+    HostJobsMap::iterator end = m_hostJobs.end();
+    if (m_runningJobs >= m_maxRunningJobs)
+        return end;
+
+    for (int p = SchedulingPriorityCount - 1; p >= 0; p--) {
+        HostJobsMap::iterator next = end;
+        for (HostJobsMap::iterator it = m_hostJobs.begin(); it != end; ++it) {
+            HostJobs* host = it->second;
+            if (host->scheduledJobs[p].isEmpty())
+                continue;
+            if (p != RenderBlockingPriority && host->runningJobs >= m_maxRunningJobsPerHost)
+                continue;
+            if (next == end || host->scheduledJobs[p][0].sequence < next->second->scheduledJobs[p][0].sequence)
+                next = it;
+        }
+        if (next != end) {
+            *priority = p;
+            return next;
+        }
+    }
+    return end;
+}
 
+bool ResourceHandleManager::startScheduledJobs()
+{
     bool started = false;
-    while (!m_resourceHandleList.isEmpty() && m_runningJobs < maxRunningJobs) {
-        ResourceHandle* job = m_resourceHandleList[0];
-        m_resourceHandleList.remove(0);
+    int priority;
+    HostJobsMap::iterator it;
+    while ((it = nextScheduledHost(&priority)) != m_hostJobs.end()) {
+        String hostKey = it->first;
+        HostJobs* host = it->second;
+        ResourceHandle* job = host->scheduledJobs[priority][0].job;
+        host->scheduledJobs[priority].remove(0);
+
+        // startJob may finish the job and drop the last reference to it
+        RefPtr<ResourceHandle> protect(job);
+
+        // count the host before starting, startJob may cancel the job again
+        host->runningJobs++;
+        m_runningJobHosts.set(job, hostKey);
         startJob(job);
+        if (!job->getInternal()->m_handle)
+            jobStoppedForHost(job);
         started = true;
     }
     return started;
 }
 
+void ResourceHandleManager::jobStoppedForHost(ResourceHandle* job)
+{
+    HashMap<ResourceHandle*, String>::iterator running = m_runningJobHosts.find(job);
+    if (running == m_runningJobHosts.end())
+        return;
+
+    HostJobsMap::iterator it = m_hostJobs.find(running->second);
+    m_runningJobHosts.remove(running);
+    if (it == m_hostJobs.end())
+        return;
+
+    HostJobs* host = it->second;
+    host->runningJobs--;
+    if (host->isEmpty()) {
+        m_hostJobs.remove(it);
+        delete host;
+    }
+}
+
+void ResourceHandleManager::setMaxConnections(int maxConnections)
+{
+    m_maxRunningJobs = std::max(1, maxConnections);
+#if PLATFORM(MG)
+    scheduleCurlTimer();
+#endif
+}
+
+void ResourceHandleManager::setMaxConnectionsPerHost(int maxConnections)
+{
+    m_maxRunningJobsPerHost = std::max(1, maxConnections);
+#if PLATFORM(MG)
+    scheduleCurlTimer();
+#endif
+}
+
 void ResourceHandleManager::dispatchSynchronousJob(ResourceHandle* job)
 {
     KURL kurl = job->firstRequest().url();
@@ -879,6 +1442,13 @@ void ResourceHandleManager::dispatchSynchronousJob(ResourceHandle* job)
         return;
     }
 
+#if PLATFORM(MG) && ENABLE(SCHEMEEXTENSION)
+    if (hasSchemeResponder(kurl)) {
+        startSchemeJob(job, true);
+        return;
+    }
+#endif
+
     ResourceHandleInternal* handle = job->getInternal();
 
 #if LIBCURL_VERSION_NUM > 0x071200
@@ -910,8 +1480,35 @@ void ResourceHandleManager::startJob(ResourceHandle* job)
         return;
     }
 
+#if PLATFORM(MG) && ENABLE(SCHEMEEXTENSION)
+    // served from memory by the application, the scheme job holds its own
+    // reference so the one taken in add() is released here
+    if (hasSchemeResponder(kurl)) {
+        startSchemeJob(job, false);
+        job->deref();
+        return;
+    }
+#endif
+
     initializeHandle(job);
 
+#if ENABLE(NETWORK_THREAD)
+    if (shouldUseNetworkThread(job)) {
+        CURL* handle = job->getInternal()->m_handle;
+        // m_curlErrorBuffer is only meant for the main thread
+        curl_easy_setopt(handle, CURLOPT_ERRORBUFFER, 0);
+#if LIBCURL_VERSION_NUM >= 0x071304
+        // A redirect to HTTPS would run the handshake, and with it the
+        // certificate callbacks of the embedder, on the network thread.
+        curl_easy_setopt(handle, CURLOPT_REDIR_PROTOCOLS, CURLPROTO_HTTP);
+#endif
+        m_runningJobs++;
+        m_threadedJobs.add(job);
+        m_networkThread->addHandle(job, handle, redirectHeaders(job));
+        return;
+    }
+#endif
+
     m_runningJobs++;
     CURLMcode ret = curl_multi_add_handle(m_curlMultiHandle, job->getInternal()->m_handle);
     // don't call perform, because events must be async
@@ -1144,14 +1741,25 @@ void ResourceHandleManager::cancel(ResourceHandle* job)
 	//because ,the curl_multi_info_read may return NULL,so the removeFromCurl can't be called,
 	//and the curl handle will not cleanup, if the running jobs get the maxRunningJobs,
 	//the browser will not send http request ,and it looks like shutdown
+#if ENABLE(NETWORK_THREAD)
+    // the network thread drops the handle right away, nothing more will be
+    // reported for it
+    if (m_threadedJobs.contains(job)) {
+        removeFromCurl(job);
+        scheduleCurlTimer();
+        return;
+    }
+#endif
 	if(d->m_handle){
 		//removeFromCurl(job);
 		//maybe used timout instead of removeFromCurl to cleanup the handle,better
 		curl_easy_setopt(d->m_handle, CURLOPT_TIMEOUT, 1); 
 	}
-#endif
+    scheduleCurlTimer();
+#else
     if (!m_downloadTimer.isActive())
         m_downloadTimer.startOneShot(pollTimeSeconds);
+#endif
     //fprintf(stderr, "[%s][%s] Out\n", __FILE__, __FUNCTION__);
 }
 
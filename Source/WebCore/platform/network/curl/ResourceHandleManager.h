@@ -39,11 +39,23 @@
 #endif
 
 #include <curl/curl.h>
+#include <wtf/HashMap.h>
+#include <wtf/text/StringHash.h>
 #include <wtf/Vector.h>
 #include <wtf/text/CString.h>
 
+#if ENABLE(NETWORK_THREAD)
+#include <wtf/HashSet.h>
+#include <wtf/OwnPtr.h>
+#endif
+
 namespace WebCore {
 
+#if ENABLE(NETWORK_THREAD)
+class NetworkThread;
+struct NetworkEvent;
+#endif
+
 class ResourceHandleManager {
 public:
     enum ProxyType {
@@ -63,6 +75,15 @@ public:
     void setupPOST(ResourceHandle*, struct curl_slist**);
     void setupPUT(ResourceHandle*, struct curl_slist**);
 
+    // Connection scheduling. Queued jobs are started per host, render-blocking
+    // and higher priority jobs first, without exceeding either limit.
+    void setMaxConnections(int);
+    int maxConnections() const { return m_maxRunningJobs; }
+    void setMaxConnectionsPerHost(int);
+    int maxConnectionsPerHost() const { return m_maxRunningJobsPerHost; }
+    void setPriorityLoadingEnabled(bool enabled) { m_priorityLoadingEnabled = enabled; }
+    bool priorityLoadingEnabled() const { return m_priorityLoadingEnabled; }
+
     void setProxyInfo(const String& host = "",
                       unsigned long port = 0,
                       ProxyType type = HTTP,
@@ -74,7 +95,19 @@ public:
     void doFtpAuth(ResourceHandle*);
 #endif
 
+#if ENABLE(NETWORK_THREAD)
+    // Returns false when the job is not loaded by the network thread.
+    bool setDefersLoading(ResourceHandle*, bool defers);
+#endif
+
 private:
+    struct ScheduledJob {
+        ResourceHandle* job;
+        unsigned sequence;
+    };
+    struct HostJobs;
+    typedef HashMap<String, HostJobs*> HostJobsMap;
+
     ResourceHandleManager();
     ~ResourceHandleManager();
     void downloadTimerCallback(Timer<ResourceHandleManager>*);
@@ -82,20 +115,63 @@ private:
     bool removeScheduledJob(ResourceHandle*);
     void startJob(ResourceHandle*);
     bool startScheduledJobs();
+    HostJobsMap::iterator nextScheduledHost(int* priority);
+    void jobStoppedForHost(ResourceHandle*);
 
     void initializeHandle(ResourceHandle*);
+    void processFinishedTransfers();
+    void finishTransfer(ResourceHandle*, CURLcode, const char* url, long responseCode);
+
+#if ENABLE(NETWORK_THREAD)
+    static void networkEventsAvailable(void* context);
+    bool shouldUseNetworkThread(ResourceHandle*) const;
+    bool reissueRedirectOnMainThread(ResourceHandle*, CURLcode);
+    void dispatchNetworkEvents();
+    void dispatchNetworkEvent(NetworkEvent*);
+#endif
+
+#if PLATFORM(MG)
+    static int curlSocketCallback(CURL*, curl_socket_t, int what, void* userp, void* socketp);
+    static int curlTimerCallback(CURLM*, long timeoutMS, void* userp);
+    static void socketNotifierCallback(int fd, int events, void* context);
+    void socketAction(curl_socket_t, int curlEvents);
+    void pollUnwatchedSockets();
+    void scheduleCurlTimer();
+#endif
 
     Timer<ResourceHandleManager> m_downloadTimer;
     CURLM* m_curlMultiHandle;
     CURLSH* m_curlShareHandle;
     char* m_cookieJarFileName;
     char m_curlErrorBuffer[CURL_ERROR_SIZE];
-    Vector<ResourceHandle*> m_resourceHandleList;
+    HostJobsMap m_hostJobs;
+    HashMap<ResourceHandle*, String> m_runningJobHosts;
+    unsigned m_scheduledJobSequence;
     const CString m_certificatePath;
     int m_runningJobs;
+    int m_maxRunningJobs;
+    int m_maxRunningJobsPerHost;
+    bool m_priorityLoadingEnabled;
     
     String m_proxy;
     ProxyType m_proxyType;
+
+#if PLATFORM(MG)
+    // Sockets the MiniGUI message loop could not watch, with the curl
+    // events (CURL_POLL_*) they are waiting for. These are polled instead.
+    HashMap<int, int> m_unwatchedSockets;
+    // Absolute time curl asked to be called back at, or -1 for none.
+    double m_curlTimeout;
+#endif
+
+#if ENABLE(NETWORK_THREAD)
+    OwnPtr<NetworkThread> m_networkThread;
+    // Running jobs whose handle belongs to the network thread.
+    HashSet<ResourceHandle*> m_threadedJobs;
+    // Events of jobs that defer loading, in arrival order.
+    Vector<NetworkEvent*> m_heldNetworkEvents;
+    bool m_dispatchingNetworkEvents;
+#endif
 };
 
 }
@@ -26,6 +26,7 @@
 using std::min;
 using std::auto_ptr;
 const size_t gMaxBufferSize = 4096;
+const size_t gMaxRetainedDecodeBufferSize = 32 * 1024;
 
 namespace WebCore {
 
@@ -44,6 +45,22 @@ static PLOGFONT mgSbcLogFont()
     return hfont;
 }
 
+// Bytes below 0x80 other than '\0' decode to themselves in most charsets,
+// decode() copies runs of them without going through MiniGUI then.
+static bool isASCIICompatible(PLOGFONT font)
+{
+    if (!font)
+        return false;
+
+    for (unsigned char c = 1; c < 0x80; ++c) {
+        UChar wc = 0;
+        int consumed = 0;
+        if (MBS2WCSEx(font, &wc, FALSE, &c, 1, 1, &consumed) != 1 || consumed != 1 || wc != c)
+            return false;
+    }
+    return true;
+}
+
 class TextCodecMgPrivate
 {
 public:
@@ -63,6 +80,7 @@ public:
 
     PLOGFONT hfont(void) const {return m_hfont;}
     char * encoding(void)const {return m_hfont->charset;}
+    bool isASCIICompatible(void) const {return m_isASCIICompatible;}
 private:
     TextCodecMgPrivate(const TextEncoding& encoding)
         :m_refcount(0),m_hfont(NULL)
@@ -72,6 +90,7 @@ private:
                   FONT_WEIGHT_REGULAR, FONT_SLANT_ROMAN, FONT_SETWIDTH_NORMAL,
                   FONT_SPACING_CHARCELL, FONT_UNDERLINE_NONE, FONT_STRUCKOUT_NONE, 
                   12, 0);
+        m_isASCIICompatible = WebCore::isASCIICompatible(m_hfont);
     }
 
     TextCodecMgPrivate(const char* encoding)
@@ -82,6 +101,7 @@ private:
                   FONT_WEIGHT_REGULAR, FONT_SLANT_ROMAN, FONT_SETWIDTH_NORMAL,
                   FONT_SPACING_CHARCELL, FONT_UNDERLINE_NONE, FONT_STRUCKOUT_NONE, 
                   12, 0);
+        m_isASCIICompatible = WebCore::isASCIICompatible(m_hfont);
     }
     ~TextCodecMgPrivate()
     {
@@ -93,6 +113,7 @@ private:
 
     int m_refcount;
     PLOGFONT m_hfont;
+    bool m_isASCIICompatible;
 };
 
 
@@ -281,19 +302,107 @@ void TextCodecMg::registerCodecs(TextCodecRegistrar registrar)
 
 // We strip BOM characters because they can show up both at the start of content
 // and inside content, and we never want them to end up in the decoded text.
-void TextCodecMg::appendOmittingBOM(Vector<UChar>& v, const UChar* characters, size_t length)
+static UChar* removeBOMs(UChar* characters, UChar* end)
 {
-    size_t start = 0;
     const UChar BOM = 0xFEFF;
-    for (size_t i = 0; i != length; ++i) {
-        if (BOM == characters[i]) {
-            if (start != i)
-                v.append(&characters[start], i - start);
-            start = i + 1;
+    UChar* out = characters;
+    for (; characters != end; ++characters) {
+        if (*characters != BOM)
+            *out++ = *characters;
+    }
+    return out;
+}
+
+// Skips a byte the charset can not decode, it is kept as Latin-1 unless it is '\0'.
+UChar* TextCodecMg::decodeGarbledByte(const unsigned char* byte, UChar* out)
+{
+    if (!*byte)
+        return out;
+
+    int consumed = 0;
+    int count = MBS2WCSEx(mgSbcLogFont(), out, FALSE, byte, 1, 1, &consumed);
+    return count > 0 ? out + count : out;
+}
+
+// Completes the character cut off at the end of the previous chunk with the
+// first bytes of this one, so the chunk itself never has to be copied.
+UChar* TextCodecMg::decodeBufferedCharacter(const unsigned char*& bytes, const unsigned char* end, UChar* out)
+{
+    unsigned char joined[sizeof(m_bufferedBytes) * 2];
+    size_t taken = min<size_t>(end - bytes, sizeof(m_bufferedBytes));
+    memcpy(joined, m_bufferedBytes, m_numBufferedBytes);
+    memcpy(joined + m_numBufferedBytes, bytes, taken);
+
+    const unsigned char* joinedBytes = joined;
+    const unsigned char* joinedEnd = joined + m_numBufferedBytes + taken;
+    while (joinedBytes < joined + m_numBufferedBytes) {
+        int consumed = 0;
+        int count = MBS2WCSEx(m_codec->hfont(), out, FALSE, joinedBytes, joinedEnd - joinedBytes, 1, &consumed);
+        if (count > 0 && consumed > 0) {
+            out = removeBOMs(out, out + count);
+            joinedBytes += consumed;
+            continue;
+        }
+        // still cut off, wait for more bytes
+        if (joinedEnd - joinedBytes <= 3 && bytes + taken == end)
+            break;
+        out = decodeGarbledByte(joinedBytes, out);
+        ++joinedBytes;
+    }
+
+    size_t used = joinedBytes - joined;
+    if (used < m_numBufferedBytes) {
+        m_numBufferedBytes = joinedEnd - joinedBytes;
+        memmove(m_bufferedBytes, joinedBytes, m_numBufferedBytes);
+        bytes = end;
+        return out;
+    }
+
+    bytes += used - m_numBufferedBytes;
+    m_numBufferedBytes = 0;
+    return out;
+}
+
+// Decodes bytes up to end, stopping in front of a character cut off by end.
+UChar* TextCodecMg::decodeBytes(const unsigned char*& bytes, const unsigned char* end, UChar* out)
+{
+    PLOGFONT font = m_codec->hfont();
+    bool isASCIICompatible = m_codec->isASCIICompatible();
+
+    while (bytes < end) {
+        const unsigned char* runEnd = end;
+        if (isASCIICompatible) {
+            while (bytes < end && *bytes && *bytes < 0x80)
+                *out++ = *bytes++;
+            if (bytes == end)
+                break;
+
+            // A byte below 0x80 can only be the last byte of a multi-byte
+            // character, two of them in a row end a character for sure.
+            for (const unsigned char* p = bytes + 1; p + 1 < end; ++p) {
+                if (p[0] < 0x80 && p[1] < 0x80) {
+                    runEnd = p + 1;
+                    break;
+                }
+            }
+        }
+
+        int consumed = 0;
+        int count = MBS2WCSEx(font, out, FALSE, bytes, runEnd - bytes, runEnd - bytes, &consumed);
+        if (count > 0 && consumed > 0) {
+            out = removeBOMs(out, out + count);
+            bytes += consumed;
+            continue;
         }
+
+        //avoid to process half word.
+        if (runEnd == end && end - bytes <= 3)
+            break;
+        //should skip one garbled character or '\0'.
+        out = decodeGarbledByte(bytes, out);
+        ++bytes;
     }
-    if (start != length)
-        v.append(&characters[start], length - start);
+    return out;
 }
 
 /*
@@ -301,97 +410,42 @@ void TextCodecMg::appendOmittingBOM(Vector<UChar>& v, const UChar* characters, s
  * Parameters:
  *    bytes     character buffer for transformation
  *    length    the number of characters in the buffer bytes
- *    wc32     uc16 or uc32,TRUE is uc32, FALSE is uc16
+ *    flush     whether a character cut off at the end is an error
  * Returns:
  *    a String object that contains the UTF16 string transformed from bytes
  */
 String TextCodecMg::decode(const char* bytes, size_t length, bool flush, bool stopOnError, bool& sawError)
 {
-    Vector<UChar> result;
-    const char* conversionBytes;
-    size_t conversionLength;
-    char* prefixedBytes = 0;
-
     //for null string, should return directly.
     if (!bytes || (length == 0 && m_numBufferedBytes == 0)) {
         return String();
     }
 
-    if (m_numBufferedBytes) {
-        conversionLength = length + m_numBufferedBytes;
-        prefixedBytes = static_cast<char*>(fastMalloc(conversionLength));
-        memcpy(prefixedBytes, m_bufferedBytes, m_numBufferedBytes);
-        memcpy(prefixedBytes + m_numBufferedBytes, bytes, length);
-        conversionBytes = prefixedBytes;
-        // all buffered bytes are consumed now
-        m_numBufferedBytes = 0;
+    // No charset decodes a byte into more than one UTF-16 code unit.
+    m_decodeBuffer.resize(length + m_numBufferedBytes);
+    UChar* characters = m_decodeBuffer.data();
+    UChar* out = characters;
+
+    const unsigned char* source = reinterpret_cast<const unsigned char*>(bytes);
+    const unsigned char* end = source + length;
+    if (m_numBufferedBytes)
+        out = decodeBufferedCharacter(source, end, out);
+    if (!m_numBufferedBytes) {
+        out = decodeBytes(source, end, out);
+        // keep a character cut off at the end for the next call
+        m_numBufferedBytes = end - source;
+        memcpy(m_bufferedBytes, source, m_numBufferedBytes);
     }
-    else {
-        // no previously buffered partial data, 
-        // just convert the data that was passed in
-        conversionBytes = bytes;
-        conversionLength = length;
-    }
-
-    UChar buffer[gMaxBufferSize];
-    int convertedLength, count, leftConvLength = conversionLength;
-    size_t countRead = 0;
-
-    do {
-        count = MBS2WCSEx (m_codec->hfont(), buffer, FALSE, 
-                (const unsigned char*)conversionBytes + countRead, leftConvLength, 
-                gMaxBufferSize, &convertedLength);
-
-        if (count <= 0) {
-            if (leftConvLength > 3) {
-                //should skip one garbled character or '\0'.
-                const unsigned char* curBytes = (const unsigned char*)conversionBytes + countRead;
-                if (*curBytes == '\0')
-                    convertedLength = 1;
-                else 
-                    count = MBS2WCSEx (mgSbcLogFont(), buffer, FALSE, curBytes, 1,
-                            gMaxBufferSize, &convertedLength);
-            }
-            else {
-                //m_numBufferedBytes = 0; // reset state for subsequent calls to decode
-                fastFree(prefixedBytes);
-                sawError = true;
-                if (leftConvLength > 0) {
-                    m_numBufferedBytes = leftConvLength;
-                    memcpy(m_bufferedBytes, conversionBytes + countRead, m_numBufferedBytes);
-                }
-                else {
-                    m_numBufferedBytes = 0;
-                }
-                return String();
-            }
-
-        }
-
-        countRead += convertedLength;
-        leftConvLength -= convertedLength;
-
-        appendOmittingBOM(result, reinterpret_cast<const UChar*>(buffer), count);
-    } while (leftConvLength > 3); //avoid to process half word.
 
-    // Partial input at the end of the string may not result in an error being raised. 
-    // From the gnome library documentation on g_convert_with_iconv:
-    // "Even if the conversion was successful, this may be less than len if there were partial characters at the end of the input."
-    // That's why we need to compare conversionLength against countRead 
-
-    m_numBufferedBytes = leftConvLength;
-    if (m_numBufferedBytes > 0) {
-        if (flush) {
-            m_numBufferedBytes = 0; // reset state for subsequent calls to decode
-            fastFree(prefixedBytes);
-            sawError = true;
-            return String();
-        }
-        memcpy(m_bufferedBytes, conversionBytes + countRead, m_numBufferedBytes);
+    if (m_numBufferedBytes && flush) {
+        m_numBufferedBytes = 0; // reset state for subsequent calls to decode
+        sawError = true;
     }
 
-    fastFree(prefixedBytes);
-    return String::adopt(result);
+    String result(characters, out - characters);
+    if (m_decodeBuffer.capacity() > gMaxRetainedDecodeBufferSize)
+        m_decodeBuffer.clear();
+    return result;
 }
 
 /*
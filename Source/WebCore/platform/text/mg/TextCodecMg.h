@@ -17,6 +17,7 @@
 
 #include "TextCodec.h"
 #include "TextEncoding.h"
+#include <wtf/Vector.h>
 
 namespace WebCore {
 
@@ -35,10 +36,14 @@ public:
     virtual CString encode(const UChar*, size_t length, UnencodableHandling);
 
 private:
-    void appendOmittingBOM(Vector<UChar>& v, const UChar* characters, size_t length);
+    UChar* decodeBufferedCharacter(const unsigned char*& bytes, const unsigned char* end, UChar* out);
+    UChar* decodeBytes(const unsigned char*& bytes, const unsigned char* end, UChar* out);
+    UChar* decodeGarbledByte(const unsigned char* byte, UChar* out);
+
     TextCodecMgPrivate* m_codec;
     size_t m_numBufferedBytes;
     unsigned char m_bufferedBytes[16]; // bigger than any single multi-byte character        
+    Vector<UChar> m_decodeBuffer; // reused by every call of decode()
 };
 
 }
@@ -95,6 +95,8 @@
 
 #include <errno.h>
 #include "HTMLAllCollection.h"
+#include <wtf/Noncopyable.h>
+#include <wtf/unicode/UTF8.h>
 
 namespace {
 
@@ -123,9 +125,9 @@ namespace {
 	static const char* const kBaseTargetDeclaration =
 		" target=\"%ls\"";
 
-	// Maximum length of data buffer which is used to temporary save generated
-	// html content data.
-	static const int kHtmlContentBufferLength = 65535;
+	// Length of the buffer which holds encoded html content data until it
+	// is written to the file.
+	static const size_t kHtmlContentBufferLength = 32 * 1024;
 
 
 }  // namespace
@@ -215,101 +217,136 @@ static String getFilebasePath(const String & filename)
 	return str;
 }
 
-static int SaveDatatoFile(String &strdata, const String & filename)
-{
+// Encodes the serialized content to UTF-8 into a fixed buffer, which is
+// written to the file whenever it is full. The content of a frame is never
+// held in memory as a whole.
+class SerializedFileWriter {
+	WTF_MAKE_NONCOPYABLE(SerializedFileWriter);
+public:
+	SerializedFileWriter()
+		: m_buffer(kHtmlContentBufferLength)
+		, m_length(0)
+#if ENABLE(FILESYSTEM)
+		, m_file(0)
+#endif
+	{
+	}
+
+	~SerializedFileWriter() { close(); }
+
+	bool open(const String & filename);
+	void write(const UChar* characters, size_t length);
+	void write(const String& string) { write(string.characters(), string.length()); }
+	void write(const char* data, size_t length);
+	void close();
+
+private:
+	void flush();
 
+	Vector<char> m_buffer;
+	size_t m_length;
 #if ENABLE(FILESYSTEM)
+	HFile m_file;
+#endif
+};
 
-	char file[MAX_FILENAME]; 
-	CString cstr;
-	HFile fp;
+bool SerializedFileWriter::open(const String & filename)
+{
+	close();
 
+#if ENABLE(FILESYSTEM)
 	String path = getFilebasePath(filename);
 	if (!fileExists(path)) {
 		makeAllDirectories(path); 
 	}
-	cstr  =  filename.utf8();
-
-	//printf("%s:%d orig-filename=%s\n", __FILE__, __LINE__, cstr.data());
-	snprintf(file, sizeof(file)-1, "%s",
-			cstr.data());
-	fp = openFile(file, "a+");
-	if (!fp) {
 
-		return -1;
+	m_file = openFile(filename.utf8().data(), "a+");
+	if (!m_file) {
+		printf("%s:%d open file %s error! \n", __FILE__, __LINE__, filename.utf8().data()); 
+		return false;
 	}
-	//String  strdata = String::adopt(data);
-	writeFile((void *)strdata.utf8().data(),  1, strdata.utf8().length(),fp);
-	cstr = strdata.utf8();
-	//printf("%s:%d data=%s\n", __FILE__, __LINE__, cstr.data());
-	closeFile(fp);
+	return true;
+#else
+	return false;
 #endif
+}
 
-	return 0;
+void SerializedFileWriter::write(const UChar* characters, size_t length)
+{
+	using namespace WTF::Unicode;
+
+	const UChar* source = characters;
+	const UChar* end = characters + length;
+	while (source < end) {
+		char* target = m_buffer.data() + m_length;
+		ConversionResult result = convertUTF16ToUTF8(&source, end, &target, m_buffer.data() + m_buffer.size(), false);
+		m_length = target - m_buffer.data();
+		if (result == targetExhausted)
+			flush();
+		else if (result == sourceExhausted) {
+			// An unpaired surrogate at the end of the content.
+			static const char replacementCharacter[] = "\xEF\xBF\xBD";
+			write(replacementCharacter, sizeof(replacementCharacter) - 1);
+			break;
+		}
+	}
 }
 
-static int SaveDatatoFile(const char *strdata, int & len,  const String & filename)
+void SerializedFileWriter::write(const char* data, size_t length)
 {
+	if (m_length + length > m_buffer.size()) {
+		flush();
+		// Large blocks go straight to the file.
+		if (length > m_buffer.size()) {
+#if ENABLE(FILESYSTEM)
+			if (m_file)
+				writeFile((void *)data, 1, length, m_file);
+#endif
+			return;
+		}
+	}
 
+	memcpy(m_buffer.data() + m_length, data, length);
+	m_length += length;
+}
+
+void SerializedFileWriter::flush()
+{
 #if ENABLE(FILESYSTEM)
-	CString cstr;
-	String path = getFilebasePath(filename);
-	char file[MAX_FILENAME]; 
-	int ret;
-	HFile fp;
+	if (m_file && m_length)
+		writeFile((void *)m_buffer.data(), 1, m_length, m_file);
+#endif
+	m_length = 0;
+}
 
-	if (!fileExists(path)) {
-		makeAllDirectories(path); 
-	}
-	cstr =  filename.utf8();
-
-	//printf("%s:%d orig-filename=%s\n", __FILE__, __LINE__, cstr.data());
-	ret  = snprintf(file, sizeof(file)-1, "%s", cstr.data());
-	ret = (MAX_FILENAME -1 < ret)? ret:(MAX_FILENAME -1);
-	fp = openFile(file, "a+");
-	if (!fp){
-		printf("%s:%d open file %s error! \n", __FILE__, __LINE__, file); 
-		return -1;
+void SerializedFileWriter::close()
+{
+	flush();
+#if ENABLE(FILESYSTEM)
+	if (m_file) {
+		closeFile(m_file);
+		m_file = 0;
 	}
-	//String  strdata = String::adopt(data);
-	writeFile((void *)strdata, 1, len, fp);
-	//cstr = strdata.utf8();
-	//printf("%s:%d data=%s\n", __FILE__, __LINE__, cstr.data());
-	closeFile(fp);
 #endif
-
-	return 0;
 }
 
-static int SaveDatatoFile(Vector<UChar> &data, const String & filename)
+static int SaveDatatoFile(const String & strdata, const String & filename)
 {
+	SerializedFileWriter writer;
+	if (!writer.open(filename))
+		return -1;
 
-#if ENABLE(FILESYSTEM)
-	char file[MAX_FILENAME]; 
-	CString cstr;
-	String path = getFilebasePath(filename);
-	int ret;
+	writer.write(strdata);
+	return 0;
+}
 
-	if (!fileExists(path)) {
-		makeAllDirectories(path); 
-	}
-	cstr =  filename.utf8();
-
-	//printf("%s:%d orig-filename=%s\n", __FILE__, __LINE__, cstr.data());
-	ret = snprintf(file, sizeof(file)-1, "%s", cstr.data());
-	ret = (MAX_FILENAME -1 < ret)? ret:(MAX_FILENAME -1);
-	//printf("%s:%d filename=%s\n",  __FILE__, __LINE__, file);
-	HFile fp = openFile(file, "a+");
-	if (!fp) {
-		printf("%s:%d open file %s error! \n", __FILE__, __LINE__, file); 
+static int SaveDatatoFile(const char *strdata, int len,  const String & filename)
+{
+	SerializedFileWriter writer;
+	if (!writer.open(filename))
 		return -1;
-	}
-	String  strdata = String::adopt(data);
-	cstr = strdata.utf8();
-	ret = writeFile((void *)cstr.data(),  1, cstr.length(),fp);
-	closeFile(fp);
-#endif
 
+	writer.write(strdata, len);
 	return 0;
 }
 
@@ -482,16 +519,10 @@ String DomSerializer::PostActionAfterSerializeEndTag(
 void DomSerializer::SaveHtmlContentToBuffer(const String& result,
 		SerializeDomParam* param)
 {
-	if (!result.length())
+	if (!result.length() || !m_writer)
 		return;
-	if (result.length() + data_buffer_.size()  > data_buffer_.capacity()) {
-		SaveDatatoFile(data_buffer_, param->directory_name);
-		data_buffer_.clear();
-		data_buffer_.reserveCapacity(kHtmlContentBufferLength);
-
-	}
 
-	data_buffer_.append(result.characters(), result.length());
+	m_writer->write(result);
 }
 
 const AtomicString* GetSubResourceLinkFromElement(const Element* element)
@@ -899,8 +930,7 @@ DomSerializer::DomSerializer(Frame* webframe, bool recursive_serialization,const
 {
 	// Must specify available webframe.
 	m_mainframe = static_cast<Frame*>(webframe);
-	// Init data buffer.
-	data_buffer_.reserveCapacity(kHtmlContentBufferLength);
+	m_writer = 0;
 
 	m_savedName=String::fromUTF8(utf8name,strlen(utf8name));
 }
@@ -1073,18 +1103,18 @@ bool DomSerializer::SerializeDom()
 				current_doc,
 				filename);
 
+		// The content is written to the file while the document is walked.
+		SerializedFileWriter writer;
+		if (!writer.open(filename))
+			continue;
+		m_writer = &writer;
+
 		// Process current document.
 		Element* root_element = current_doc->documentElement();
 		if (root_element)
 			BuildContentForNode(root_element, &param);
 
-		// check whehter there is a same filename ? 
-
-		//subresourceslist.resources_list.append(url);
-		//subresourceslist.local_file.append(savefilename);
-		SaveDatatoFile(data_buffer_, filename);
-		data_buffer_.clear();
-		data_buffer_.reserveCapacity(kHtmlContentBufferLength);
+		m_writer = 0;
 	}
 
 	//StartDownloadSubresource();
@@ -23,6 +23,7 @@ class Document;
 class Element;
 class Node;
 class TextEncoding;
+class SerializedFileWriter;
 }
 
 namespace WebCore {
@@ -90,9 +91,8 @@ class DomSerializer {
   LinkLocalPathMap local_links_;
   // Pointer of DomSerializerDelegate
   //DomSerializerDelegate* delegate_;
-  // Data buffer for saving result of serialized DOM data.
-  //String data_buffer_;
-   Vector<UChar> data_buffer_;
+  // Writes the serialized DOM data of the current frame to its file.
+  SerializedFileWriter* m_writer;
   // Passing true to recursive_serialization_ indicates we will serialize not
   // only the specified frame but also all sub-frames in the specific frame.
   // Otherwise we only serialize the specified frame excluded all sub-frames.
@@ -175,7 +175,7 @@ class DomSerializer {
   // After we finish serializing end tag of a element, we give the target
   // element a chance to do some post work to add some additional data.
   WTF::String PostActionAfterSerializeEndTag( const WebCore::Element* element, SerializeDomParam* param);
-  // Save generated html content to data buffer.
+  // Write generated html content to the file of the current frame.
   void SaveHtmlContentToBuffer(const WTF::String& result, SerializeDomParam* param);
   // Serialize open tag of an specified element.
   void OpenTagToString(const WebCore::Element* element, SerializeDomParam* param);
@@ -0,0 +1,109 @@
+/*
+** $Id$
+**
+** GCActivityCallbackMg.cpp: collects the JavaScript heap while the UI is idle.
+**
+** Copyright (C) 2003 ~ 2010 Beijing Feynman Software Technology Co., Ltd.
+**
+** All rights reserved by Feynman Software.
+*/
+#include "config.h"
+#include "minigui.h"
+
+#include "MDolphinDelegates.h"
+#include "FunctionPreparser.h"
+#include "GCActivityCallbackMg.h"
+
+#include <runtime/Heap.h>
+#include <runtime/JSLock.h>
+#include <wtf/CurrentTime.h>
+
+namespace WebCore {
+
+// The views have to be quiet this long before the heap is collected.
+static const double idleDelay = 1.0;
+// How often an idle heap which did not grow enough is looked at again.
+static const double pollInterval = 5.0;
+// The blocks left unswept by a collection are swept this many at a time,
+// giving input a chance in between.
+static const size_t sweepBlocksPerSlice = 16;
+// How long the queued event listeners are compiled at a time.
+static const double preparseSliceTime = 0.01;
+
+static double lastActivityTime = 0;
+
+PassOwnPtr<GCActivityCallbackMg> GCActivityCallbackMg::create(JSC::Heap* heap)
+{
+    return adoptPtr(new GCActivityCallbackMg(heap));
+}
+
+GCActivityCallbackMg::GCActivityCallbackMg(JSC::Heap* heap)
+    : m_heap(heap)
+    , m_sizeAfterCollection(0)
+    , m_idleTimer(this, &GCActivityCallbackMg::idleTimerFired)
+{
+    (*this)();
+}
+
+GCActivityCallbackMg::~GCActivityCallbackMg()
+{
+}
+
+void GCActivityCallbackMg::operator()()
+{
+    m_sizeAfterCollection = m_heap->size();
+    m_idleTimer.startOneShot(idleDelay);
+}
+
+void GCActivityCallbackMg::noteActivity()
+{
+    lastActivityTime = currentTime();
+}
+
+double GCActivityCallbackMg::timeUntilIdle()
+{
+    double idleTime = currentTime() - lastActivityTime;
+    return idleTime < idleDelay ? idleDelay - idleTime : 0;
+}
+
+void GCActivityCallbackMg::idleTimerFired(Timer<GCActivityCallbackMg>*)
+{
+    double delay = timeUntilIdle();
+    if (delay > 0) {
+        m_idleTimer.startOneShot(delay);
+        return;
+    }
+
+    if (!m_heap->isBusy() && m_heap->markedSpace().hasDeferredSweep()) {
+        JSC::JSLock lock(JSC::SilenceAssertionsOnly);
+        if (m_heap->sweepIncrementally(sweepBlocksPerSlice)) {
+            m_idleTimer.startOneShot(0);
+            return;
+        }
+    }
+
+    if (functionPreparser().hasPendingFunctions() && functionPreparser().preparse(preparseSliceTime)) {
+        m_idleTimer.startOneShot(0);
+        return;
+    }
+
+    // Collecting a heap with few new objects would not save a collection
+    // later on.
+    size_t threshold = m_heap->markedSpace().highWaterMark() / 4;
+    if (m_heap->isBusy() || m_heap->size() < m_sizeAfterCollection + threshold) {
+        m_idleTimer.startOneShot(pollInterval);
+        return;
+    }
+
+    if (Control::MDCB_ALLOW_IDLE_GC && !Control::MDCB_ALLOW_IDLE_GC()) {
+        m_idleTimer.startOneShot(idleDelay);
+        return;
+    }
+
+    // The collection calls back into operator(), which rearms the timer. The
+    // blocks it leaves unswept are swept by the next idle slices.
+    JSC::JSLock lock(JSC::SilenceAssertionsOnly);
+    m_heap->collectAllGarbageLazily();
+}
+
+} // namespace WebCore
@@ -0,0 +1,60 @@
+/*
+** $Id$
+**
+** GCActivityCallbackMg.h: collects the JavaScript heap while the UI is idle.
+**
+** Copyright (C) 2003 ~ 2010 Beijing Feynman Software Technology Co., Ltd.
+**
+** All rights reserved by Feynman Software.
+*/
+
+#ifndef GCActivityCallbackMg_h
+#define GCActivityCallbackMg_h
+
+#include "Timer.h"
+#include <runtime/GCActivityCallback.h>
+#include <wtf/PassOwnPtr.h>
+
+namespace JSC {
+class Heap;
+}
+
+namespace WebCore {
+
+// Without an activity callback the heap is only collected once the
+// allocations since the last collection cross the high water mark, which
+// usually happens while the user interacts with the page. This callback
+// collects the heap on the shared timer once the views have seen no input
+// and painted no frame for a while and a good part of the high water mark
+// is used up, so that the automatic collections become rare. While idle it
+// also sweeps the blocks a collection left unswept and compiles the event
+// listeners queued by the FunctionPreparser. The embedder can veto an idle
+// collection, for example during an animation.
+class GCActivityCallbackMg : public JSC::GCActivityCallback {
+public:
+    static PassOwnPtr<GCActivityCallbackMg> create(JSC::Heap*);
+    virtual ~GCActivityCallbackMg();
+
+    // Called by the heap when it was created and after every collection.
+    virtual void operator()();
+    virtual void synchronize() { }
+
+    // Input and painting push the next idle collection back.
+    static void noteActivity();
+    // How much longer the views have to stay quiet before they count as
+    // idle, 0 once they are. Other idle work waits for the same signal.
+    static double timeUntilIdle();
+
+private:
+    GCActivityCallbackMg(JSC::Heap*);
+
+    void idleTimerFired(Timer<GCActivityCallbackMg>*);
+
+    JSC::Heap* m_heap;
+    size_t m_sizeAfterCollection;
+    Timer<GCActivityCallbackMg> m_idleTimer;
+};
+
+} // namespace WebCore
+
+#endif // GCActivityCallbackMg_h
@@ -27,6 +27,7 @@ public:
     virtual void beforeDrawViewport(IMDWebView*, HDC windowdDC, HDC memDC, const RECT* prcClient)=0;
     virtual void afterDrawViewport(IMDWebView*, HDC windowDC, HDC memDC, const RECT *prcClient)=0;
     virtual void linkURL(const char *url)=0;
+    virtual void paintFramesDropped(IMDWebView*, unsigned int frames, unsigned int lateMilliseconds) {}
 };
 
 #endif
@@ -165,6 +165,37 @@ public:
     virtual void setAcceleratedCompositingEnabled(bool) = 0;
     virtual bool acceleratedCompositingEnabled() const  = 0;
 
+    // Network connection scheduling, shared by all web views.
+    virtual void setMaxConnections(int) = 0;
+    virtual int maxConnections() const  = 0;
+
+    virtual void setMaxConnectionsPerHost(int) = 0;
+    virtual int maxConnectionsPerHost() const  = 0;
+
+    // Start stylesheets and scripts before images and other low priority loads.
+    virtual void setPriorityLoadingEnabled(bool) = 0;
+    virtual bool priorityLoadingEnabled() const  = 0;
+
+    // Keep the rendered page in tiles that are reused while scrolling.
+    // The memory limit of the tiles is in kilobytes.
+    virtual void setTiledBackingStoreEnabled(bool) = 0;
+    virtual bool tiledBackingStoreEnabled() const  = 0;
+
+    virtual void setTiledBackingStoreMemoryLimit(int) = 0;
+    virtual int tiledBackingStoreMemoryLimit() const  = 0;
+
+    // Pace the repaints of the page to this many frames a second, 0 to
+    // paint every repaint right away.
+    virtual void setPaintFrameRate(int) = 0;
+    virtual int paintFrameRate() const  = 0;
+
+    // Purge decoded data, the page cache and at last the JavaScript heap
+    // once the memory of the view crosses this many kilobytes, 0 for no
+    // budget. The backing stores of the view count against the budget,
+    // and so do the caches shared with other views.
+    virtual void setMemoryBudget(int) = 0;
+    virtual int memoryBudget() const  = 0;
+
 };
 
 
@@ -63,5 +63,12 @@ void  MDDefaultWebCustomDelegate::linkURL(const char *url)
     if(Control::MDCB_URL_IS_VISITED) 
         Control::MDCB_URL_IS_VISITED(url);
 }
+
+void MDDefaultWebCustomDelegate::paintFramesDropped(IMDWebView* view, unsigned int frames, unsigned int lateMilliseconds)
+{
+    HWND hwnd = view->viewWindow();
+    if(Control::MDCB_PAINT_FRAMES_DROPPED)
+        Control::MDCB_PAINT_FRAMES_DROPPED(hwnd, frames, lateMilliseconds);
+}
 #endif
 
@@ -29,6 +29,7 @@ public:
     virtual void beforeDrawViewport(IMDWebView*, HDC windowdDC, HDC memDC, const RECT* prcClient);
     virtual void afterDrawViewport(IMDWebView*, HDC windowDC, HDC memDC, const RECT *prcClient);
     virtual void  linkURL(const char *url);
+    virtual void paintFramesDropped(IMDWebView*, unsigned int frames, unsigned int lateMilliseconds);
 
 protected:
     MDDefaultWebCustomDelegate(){};
@@ -0,0 +1,191 @@
+/*
+ ** $Id$
+ **
+ ** MDMemoryGovernor.cpp: keeps the memory of MDWebView within a budget.
+ **
+ ** Copyright (C) 2003 ~ 2010 Beijing Feynman Software Technology Co., Ltd.
+ **
+ ** All rights reserved by Feynman Software.
+ */
+
+#include "minigui.h"
+
+#include "config.h"
+#include "MDMemoryGovernor.h"
+
+#include "MDWebView.h"
+
+#include "FontCache.h"
+#include "GCController.h"
+#include "JSDOMWindow.h"
+#include "MemoryCache.h"
+#include "PageCache.h"
+
+#include <algorithm>
+#include <limits.h>
+#include <runtime/JSGlobalData.h>
+
+using namespace WebCore;
+
+static const double checkInterval = 2.0;
+// The most purges a tier that frees nothing is skipped for.
+static const unsigned maxBackoff = 32;
+// A font of MiniGUI with its glyph cache, the font cache does not know
+// the real size.
+static const unsigned estimatedFontDataBytes = 16 * 1024;
+
+static unsigned addClamped(unsigned a, unsigned b)
+{
+    return a + b < a ? UINT_MAX : a + b;
+}
+
+unsigned MDMemoryGovernor::Usage::total() const
+{
+    unsigned bytes = addClamped(decodedResourceBytes, encodedResourceBytes);
+    bytes = addClamped(bytes, jsHeapBytes);
+    bytes = addClamped(bytes, backingStoreBytes);
+    return addClamped(bytes, fontCacheBytes);
+}
+
+MDMemoryGovernor::MDMemoryGovernor(MDWebView* webView, unsigned budgetBytes)
+    : m_webView(webView)
+    , m_budget(0)
+    , m_usageAfterPurge(0)
+    , m_checkTimer(this, &MDMemoryGovernor::checkTimerFired)
+{
+    setBudget(budgetBytes);
+}
+
+void MDMemoryGovernor::setBudget(unsigned bytes)
+{
+    m_budget = bytes;
+    resetBackoff();
+    if (!m_budget) {
+        m_checkTimer.stop();
+        return;
+    }
+    checkSoon();
+}
+
+void MDMemoryGovernor::resetBackoff()
+{
+    m_usageAfterPurge = 0;
+    for (int tier = PurgeNothing; tier <= PurgeJSHeap; ++tier) {
+        m_skippedPurges[tier] = 0;
+        m_backoff[tier] = 0;
+    }
+}
+
+void MDMemoryGovernor::checkSoon()
+{
+    if (m_budget)
+        m_checkTimer.start(0, checkInterval);
+}
+
+MDMemoryGovernor::Usage MDMemoryGovernor::usage() const
+{
+    Usage usage;
+
+    MemoryCache::Statistics stats = memoryCache()->getStatistics();
+    MemoryCache::TypeStatistic* types[] = { &stats.images, &stats.cssStyleSheets, &stats.scripts,
+#if ENABLE(XSLT)
+        &stats.xslStyleSheets,
+#endif
+        &stats.fonts };
+    usage.decodedResourceBytes = 0;
+    usage.encodedResourceBytes = 0;
+    for (size_t i = 0; i < sizeof(types) / sizeof(types[0]); ++i) {
+        // The size of a resource includes its decoded data.
+        usage.decodedResourceBytes += types[i]->decodedSize;
+        usage.encodedResourceBytes += types[i]->size - types[i]->decodedSize;
+    }
+
+    usage.jsHeapBytes = JSDOMWindow::commonJSGlobalData()->heap.capacity();
+    usage.backingStoreBytes = m_webView->backingStoreMemoryUsage();
+    usage.fontCacheBytes = fontCache()->fontDataCount() * estimatedFontDataBytes;
+    return usage;
+}
+
+MDMemoryGovernor::PurgeTier MDMemoryGovernor::check()
+{
+    PurgeTier purged = PurgeNothing;
+    if (!m_budget)
+        return purged;
+
+    unsigned total = usage().total();
+    if (total <= m_budget) {
+        m_usageAfterPurge = 0;
+        return purged;
+    }
+    // Whatever the tiers could free is gone already, purging again would
+    // only cost time.
+    if (m_usageAfterPurge && total <= m_usageAfterPurge)
+        return purged;
+
+    for (int tier = PurgeDecodedData; tier <= PurgeJSHeap && total > m_budget; ++tier) {
+        if (m_skippedPurges[tier]) {
+            --m_skippedPurges[tier];
+            continue;
+        }
+
+        purge(static_cast<PurgeTier>(tier), total - m_budget);
+        purged = static_cast<PurgeTier>(tier);
+
+        unsigned after = usage().total();
+        if (after < total)
+            m_backoff[tier] = 0;
+        else {
+            m_backoff[tier] = m_backoff[tier] ? std::min(m_backoff[tier] * 2, maxBackoff) : 1;
+            m_skippedPurges[tier] = m_backoff[tier];
+        }
+        total = after;
+    }
+
+    m_usageAfterPurge = total > m_budget ? total : 0;
+    return purged;
+}
+
+void MDMemoryGovernor::checkTimerFired(Timer<MDMemoryGovernor>*)
+{
+    check();
+}
+
+void MDMemoryGovernor::purge(PurgeTier tier, unsigned overBytes)
+{
+    switch (tier) {
+    case PurgeNothing:
+        break;
+    case PurgeDecodedData: {
+        m_webView->purgeTiledBackingStore();
+
+        MemoryCache* cache = memoryCache();
+#if ENABLE(DISK_CACHE)
+        if (cache->isDiskCache())
+            break;
+#endif
+        if (cache->disabled())
+            break;
+
+        // Shrinking the capacity prunes dead resources and the decoded
+        // data of live ones, least recently used first.
+        Usage current = usage();
+        unsigned cacheBytes = current.decodedResourceBytes + current.encodedResourceBytes;
+        unsigned minDeadBytes, maxDeadBytes, totalBytes;
+        cache->getCapacities(&minDeadBytes, &maxDeadBytes, &totalBytes);
+        cache->setCapacities(0, 0, cacheBytes > overBytes ? cacheBytes - overBytes : 0);
+        cache->setCapacities(minDeadBytes, maxDeadBytes, totalBytes);
+        break;
+    }
+    case PurgePageCache: {
+        int capacity = pageCache()->capacity();
+        pageCache()->setCapacity(0);
+        pageCache()->releaseAutoreleasedPagesNow();
+        pageCache()->setCapacity(capacity);
+        fontCache()->purgeInactiveFontData();
+        break;
+    }
+    case PurgeJSHeap:
+        gcController().garbageCollectNow();
+        break;
+    }
+}
@@ -0,0 +1,78 @@
+/*
+ ** $Id$
+ **
+ ** MDMemoryGovernor.h: keeps the memory of MDWebView within a budget.
+ **
+ ** Copyright (C) 2003 ~ 2010 Beijing Feynman Software Technology Co., Ltd.
+ **
+ ** All rights reserved by Feynman Software.
+ */
+
+#ifndef MDMemoryGovernor_h
+#define MDMemoryGovernor_h
+
+#include "Timer.h"
+#include <wtf/Noncopyable.h>
+
+class MDWebView;
+
+// Estimates the memory a view depends on, and purges caches in tiers once
+// it crosses the budget: first decoded resource data and off screen tiles,
+// then the page cache and inactive fonts, and at last the JavaScript heap.
+// The memory cache, the font cache and the JavaScript heap are shared by
+// all views, so they count against the budget of every view.
+//
+// The governor only purges again once the usage grew past what was left
+// after its last purge, and a tier that freed nothing is skipped for a
+// number of purges that doubles every time it fails again.
+class MDMemoryGovernor {
+    WTF_MAKE_NONCOPYABLE(MDMemoryGovernor);
+public:
+    struct Usage {
+        unsigned decodedResourceBytes;
+        unsigned encodedResourceBytes;
+        unsigned jsHeapBytes;
+        unsigned backingStoreBytes;
+        unsigned fontCacheBytes;
+
+        unsigned total() const;
+    };
+
+    enum PurgeTier {
+        PurgeNothing,
+        PurgeDecodedData,
+        PurgePageCache,
+        PurgeJSHeap
+    };
+
+    MDMemoryGovernor(MDWebView*, unsigned budgetBytes);
+
+    void setBudget(unsigned bytes);
+    unsigned budget() const { return m_budget; }
+
+    Usage usage() const;
+
+    // Purges until the usage is within the budget, returns the last tier
+    // that was purged.
+    PurgeTier check();
+    // Checks soon, for example after a load finished.
+    void checkSoon();
+
+private:
+    void checkTimerFired(WebCore::Timer<MDMemoryGovernor>*);
+    void purge(PurgeTier, unsigned overBytes);
+
+    void resetBackoff();
+
+    MDWebView* m_webView;
+    unsigned m_budget;
+    // The usage left by the last purge, 0 once it was within the budget.
+    unsigned m_usageAfterPurge;
+    // Per tier: purges to skip before it is tried again, and how many to
+    // skip the next time it frees nothing.
+    unsigned m_skippedPurges[PurgeJSHeap + 1];
+    unsigned m_backoff[PurgeJSHeap + 1];
+    WebCore::Timer<MDMemoryGovernor> m_checkTimer;
+};
+
+#endif // MDMemoryGovernor_h
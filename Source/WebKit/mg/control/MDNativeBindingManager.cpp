@@ -20,6 +20,7 @@
 #include "MDNativeBindingManager.h"
 #include "APICast.h"
 #include "HashMap.h"
+#include "HashSet.h"
 #include "WTFString.h"
 
 #if ENABLE(JSNATIVEBINDING)
@@ -130,132 +131,183 @@ void MDNativeBindingManager::destroyInstance()
 
 bool MDNativeBindingManager::registerJSNativeClass(JSNativeClass *nativeClass)
 {
-    if(!nativeClass || lookupJSNativeObject(nativeClass->name) >= 0)
+    if(!nativeClass || lookupJSNativeObject(nativeClass->name))
         return false;
 
-     MDNativeBindingClass *bindingClass = new MDNativeBindingClass(nativeClass);
-     registerJSNativeObject(bindingClass);
-     return true;
+     return registerJSNativeObject(new MDNativeBindingClass(nativeClass));
 }
 
-int MDNativeBindingManager::lookupJSNativeObject(const char * name)
+IMDNativeBindingObject* MDNativeBindingManager::lookupJSNativeObject(const char * name)
 {
     if (!name)
-        return -1;
-
-    IMDNativeBindingObject *object = NULL;
-    const char* objName = NULL;
-    size_t size = m_jsTable.size();
-    for (size_t i=0; i<size; i++) {
-        object  = m_jsTable.at(i);
-        objName =  object->nativeName(); 
-
-        if (objName) 
-            if (! strcmp(name, objName)) 
-                return i;
-    }
+        return NULL;
 
-    return -1;
+    return lookupJSNativeObject(String::fromUTF8(name));
 }
 
-JSClassRef  MDNativeBindingManager::lookupJSNativeClass(const char* name)
+IMDNativeBindingObject* MDNativeBindingManager::lookupJSNativeObject(const String& name)
 {
-    int i; 
-    if((i = lookupJSNativeObject(name)) < 0)
+    if (name.isEmpty())
         return NULL;
 
-   IMDNativeBindingObject *object =  m_jsTable.at(i);
-   return object->classRef();
+    return m_jsTable.get(name);
 }
 
-bool MDNativeBindingManager::unregisterJSNativeClass(JSNativeClass *nativeClass)
+JSClassRef  MDNativeBindingManager::lookupJSNativeClass(const char* name)
 {
-    int i; 
-    if(!nativeClass || (i = lookupJSNativeObject(nativeClass->name)) < 0)
-        return false;
+   IMDNativeBindingObject *object = lookupJSNativeObject(name);
+   return object ? object->classRef() : NULL;
+}
 
-    unregisterJSNativeObject(i);
-    return true;
+bool MDNativeBindingManager::unregisterJSNativeClass(JSNativeClass *nativeClass)
+{
+    return nativeClass && unregisterJSNativeObject(nativeClass->name);
 }
 
 bool MDNativeBindingManager::registerJSNativeInterface(JSNativeInterface *nativeInterface)
 {
 
-    if(!nativeInterface || lookupJSNativeObject(nativeInterface->name) >= 0)
+    if(!nativeInterface || lookupJSNativeObject(nativeInterface->name))
         return false;
 
-     MDNativeBindingInterface *bindingInterface = new MDNativeBindingInterface(nativeInterface);
-     registerJSNativeObject(bindingInterface);
-     return true;
+     return registerJSNativeObject(new MDNativeBindingInterface(nativeInterface));
 }
 
 bool MDNativeBindingManager::unregisterJSNativeInterface(JSNativeInterface *nativeInterface) 
 {
-
-    int i; 
-    if(!nativeInterface || (i = lookupJSNativeObject(nativeInterface->name)) < 0)
-        return false;
-
-    unregisterJSNativeObject(i);
-    return true;
+    return nativeInterface && unregisterJSNativeObject(nativeInterface->name);
 }
 
 bool MDNativeBindingManager::registerJSNativeFunction(JSNativeFunction *nativeFunc)
 {
-    if(!nativeFunc || lookupJSNativeObject(nativeFunc->name) >= 0)
+    if(!nativeFunc || lookupJSNativeObject(nativeFunc->name))
         return false;
 
-     MDNativeBindingFunction *bindingFunc = new MDNativeBindingFunction(nativeFunc);
-     registerJSNativeObject(bindingFunc);
-
-     return true;
+     return registerJSNativeObject(new MDNativeBindingFunction(nativeFunc));
 }
 
 bool MDNativeBindingManager::unregisterJSNativeFunction(JSNativeFunction *nativeFunc)
 {
-    int i; 
-    if(!nativeFunc || (i = lookupJSNativeObject(nativeFunc->name)) < 0)
+    return nativeFunc && unregisterJSNativeObject(nativeFunc->name);
+}
+
+bool MDNativeBindingManager::registerJSNativeObject(IMDNativeBindingObject* object)
+{
+    const char* name = object->nativeName();
+    if (!name || !*name) {
+        delete object;
         return false;
+    }
 
-     unregisterJSNativeObject(i);
-     return true;
+    m_jsTable.set(String::fromUTF8(name), object);
+    return true;
 }
 
-
-void MDNativeBindingManager::unregisterJSNativeObject(int i)
+bool MDNativeBindingManager::unregisterJSNativeObject(const char* name)
 {
     //FIXME:  cancel  deleting js property from global object  
     // you should the js property in all JS context not only current JS Context
     // and make sure there is not instance of current native object 
     // please read http://rdwiki.rd.minigui.com/bin/view/Applications/MDCoreDDV3dot0dot0JSNativeBinding
 
-    delete m_jsTable.at(i);
-    m_jsTable.remove(i);
+    if (!name)
+        return false;
+
+    MDJSClassRegisterTable::iterator it = m_jsTable.find(String::fromUTF8(name));
+    if (it == m_jsTable.end())
+        return false;
+
+    delete it->second;
+    m_jsTable.remove(it);
+    return true;
+}
+
+/*
+ * The bindings of a window context live on one object which is put into
+ * the prototype chain of the window, right behind the window prototype:
+ *
+ *     window -> window prototype -> bindings -> Object prototype
+ *
+ * A binding is created the first time a script looks it up, and is kept
+ * as a plain property of the bindings object from then on. Pages which
+ * never use the bindings only pay for that one object.
+ */
+struct LazyNativeBindings {
+    HashSet<String> installed;
+};
+
+static String propertyNameToString(JSStringRef string)
+{
+    return String(JSStringGetCharactersPtr(string), JSStringGetLength(string));
+}
+
+static bool lazyBindingHasProperty(JSContextRef, JSObjectRef object, JSStringRef propertyName)
+{
+    LazyNativeBindings* bindings = static_cast<LazyNativeBindings*>(JSObjectGetPrivate(object));
+    String name = propertyNameToString(propertyName);
+    if (!bindings || bindings->installed.contains(name))
+        return false;
+
+    return MDNativeBindingManager::sharedInstance()->lookupJSNativeObject(name);
+}
+
+static JSValueRef lazyBindingGetProperty(JSContextRef context, JSObjectRef object, JSStringRef propertyName, JSValueRef*)
+{
+    LazyNativeBindings* bindings = static_cast<LazyNativeBindings*>(JSObjectGetPrivate(object));
+    String name = propertyNameToString(propertyName);
+    IMDNativeBindingObject* binding = MDNativeBindingManager::sharedInstance()->lookupJSNativeObject(name);
+    if (!bindings || !binding)
+        return JSValueMakeUndefined(context);
+
+    JSValueRef value = binding->propertyValue(context);
+    bindings->installed.add(name);
+    JSObjectSetProperty(context, object, propertyName, value,
+            kJSPropertyAttributeDontEnum | kJSPropertyAttributeDontDelete, NULL);
+    return value;
+}
+
+static void lazyBindingFinalize(JSObjectRef object)
+{
+    delete static_cast<LazyNativeBindings*>(JSObjectGetPrivate(object));
+}
+
+static JSClassRef lazyBindingsClass()
+{
+    static JSClassRef classRef;
+    if (!classRef) {
+        JSClassDefinition definition = kJSClassDefinitionEmpty;
+        definition.className = "NativeBindings";
+        definition.hasProperty = lazyBindingHasProperty;
+        definition.getProperty = lazyBindingGetProperty;
+        definition.finalize = lazyBindingFinalize;
+        classRef = JSClassCreate(&definition);
+    }
+    return classRef;
 }
 
 int MDNativeBindingManager::registerNativeJSObjectsToContext(ScriptController *script, DOMWrapperWorld* world)
 {
+    if (m_jsTable.isEmpty())
+        return 0;
+
     DOMWrapperWorld* nativeWorld = (world)? world : mainThreadNormalWorld();
     JSDOMWindow*    window =  (script->globalObject(nativeWorld));
     //toJSDOMWindow
     JSContextRef context = reinterpret_cast<JSContextRef>(window->globalExec()); 
-    JSObjectRef globalObject = JSContextGetGlobalObject(context);
-
-    IMDNativeBindingObject *object = NULL;
-    size_t size = m_jsTable.size();
-    
-    for (size_t i=0; i<size; i++) {
-        object = m_jsTable.at(i);
-        JSStringRef propertyName = object->propertyName(); //entry->m_propertyName;
-        JSObjectSetProperty(
-                context,
-                globalObject,
-                propertyName,
-                object->propertyValue(context),
-                kJSPropertyAttributeDontEnum | kJSPropertyAttributeDontDelete, NULL);
-
-        JSStringRelease(propertyName);
-    }
+
+    // The window itself, JSContextGetGlobalObject() would give its shell.
+    JSObjectRef chainObject = toRef(window);
+    JSValueRef windowPrototype = JSObjectGetPrototype(context, chainObject);
+    if (JSValueIsObject(context, windowPrototype))
+        chainObject = JSValueToObject(context, windowPrototype, NULL);
+
+    JSValueRef nextPrototype = JSObjectGetPrototype(context, chainObject);
+    if (JSValueIsObjectOfClass(context, nextPrototype, lazyBindingsClass()))
+        return 0;
+
+    JSObjectRef bindingsObject = JSObjectMake(context, lazyBindingsClass(), new LazyNativeBindings);
+    JSObjectSetPrototype(context, bindingsObject, nextPrototype);
+    JSObjectSetPrototype(context, chainObject, bindingsObject);
 
     return 0;
 }
@@ -267,8 +319,7 @@ MDNativeBindingManager::MDNativeBindingManager()
 
 MDNativeBindingManager::~MDNativeBindingManager()
 {
-    for (size_t i = 0; i<m_jsTable.size(); i++)
-        delete m_jsTable.at(i);
+    deleteAllValues(m_jsTable);
 }
 
 }
@@ -19,6 +19,8 @@
 
 #include "mdolphin_binding.h"
 #include "ScriptController.h"
+#include <wtf/HashMap.h>
+#include <wtf/text/StringHash.h>
 
 
 using namespace WTF;
@@ -95,9 +97,11 @@ public:
     bool registerJSNativeFunction(JSNativeFunction *nativeFunc);
     bool unregisterJSNativeFunction(JSNativeFunction *nativeFunc);
 
+    // The bindings are not created in the context until a script uses them.
     int registerNativeJSObjectsToContext(ScriptController *script, DOMWrapperWorld* world);
 
-    int lookupJSNativeObject(const char* name);
+    IMDNativeBindingObject* lookupJSNativeObject(const char* name);
+    IMDNativeBindingObject* lookupJSNativeObject(const String& name);
 
     JSClassRef  lookupJSNativeClass(const char* name);
 
@@ -105,11 +109,11 @@ private:
     MDNativeBindingManager();
     ~MDNativeBindingManager();
 
-    typedef Vector<IMDNativeBindingObject*> MDJSClassRegisterTable;
+    typedef HashMap<String, IMDNativeBindingObject*> MDJSClassRegisterTable;
     MDJSClassRegisterTable m_jsTable ;
 
-    void registerJSNativeObject(IMDNativeBindingObject* object) { m_jsTable.append(object); }; 
-    void unregisterJSNativeObject (int i);
+    bool registerJSNativeObject(IMDNativeBindingObject* object);
+    bool unregisterJSNativeObject(const char* name);
 
 
 };
@@ -0,0 +1,112 @@
+/*
+ ** $Id$
+ **
+ ** MDPaintScheduler.cpp: paces the repaints of MDWebView to a frame rate.
+ **
+ ** Copyright (C) 2003 ~ 2010 Beijing Feynman Software Technology Co., Ltd.
+ **
+ ** All rights reserved by Feynman Software.
+ */
+
+#include "minigui.h"
+
+#include "config.h"
+#include "MDPaintScheduler.h"
+
+#include "GCActivityCallbackMg.h"
+#include "IMDWebCustomDelegate.h"
+#include "MDWebView.h"
+
+#include <algorithm>
+#include <math.h>
+#include <wtf/CurrentTime.h>
+
+using namespace WebCore;
+
+MDPaintScheduler::MDPaintScheduler(MDWebView* webView, int framesPerSecond)
+    : m_webView(webView)
+    , m_lastFrameTime(0)
+    , m_scheduledFrameTime(0)
+    , m_pendingRegion(0)
+    , m_frameTimer(this, &MDPaintScheduler::frameTimerFired)
+{
+    setFrameRate(framesPerSecond);
+}
+
+MDPaintScheduler::~MDPaintScheduler()
+{
+    if (m_pendingRegion)
+        DestroyClipRgn(m_pendingRegion);
+}
+
+void MDPaintScheduler::setFrameRate(int framesPerSecond)
+{
+    m_frameRate = std::max(1, framesPerSecond);
+    m_frameInterval = 1.0 / m_frameRate;
+}
+
+void MDPaintScheduler::invalidate(const IntRect& windowRect)
+{
+    if (windowRect.isEmpty())
+        return;
+
+    if (!m_pendingRegion)
+        m_pendingRegion = CreateClipRgn();
+
+    RECT rect = windowRect;
+    if (m_pendingRegion)
+        AddClipRect(m_pendingRegion, &rect);
+    scheduleFrame();
+}
+
+void MDPaintScheduler::scheduleFrame()
+{
+    if (m_frameTimer.isActive())
+        return;
+
+    double now = currentTime();
+    m_scheduledFrameTime = std::max(now, m_lastFrameTime + m_frameInterval);
+    m_frameTimer.startOneShot(m_scheduledFrameTime - now);
+}
+
+void MDPaintScheduler::flush()
+{
+    m_frameTimer.stop();
+    invalidatePendingRegion();
+}
+
+void MDPaintScheduler::invalidatePendingRegion()
+{
+    if (!m_pendingRegion || IsEmptyClipRgn(m_pendingRegion))
+        return;
+
+    HWND hwnd = m_webView->viewWindow();
+    for (PCLIPRECT pClipRect = m_pendingRegion->head; pClipRect; pClipRect = pClipRect->next) {
+        if (!IsRectEmpty(&pClipRect->rc))
+            InvalidateRect(hwnd, &pClipRect->rc, FALSE);
+    }
+    EmptyClipRgn(m_pendingRegion);
+}
+
+void MDPaintScheduler::frameTimerFired(Timer<MDPaintScheduler>*)
+{
+    double startTime = currentTime();
+    m_lastFrameTime = startTime;
+    GCActivityCallbackMg::noteActivity();
+
+    // Layout and the backing store update happen once for everything that
+    // was invalidated since the previous frame, the window is painted
+    // right away so that the frame time includes the blits.
+    m_webView->updateBackingStoreForFrame();
+    invalidatePendingRegion();
+    UpdateWindow(m_webView->viewWindow(), FALSE);
+
+    // Every frame slot that passed between the scheduled time and the end
+    // of the paint is a frame that did not make it to the screen, whether
+    // the timer fired late or the paint took long.
+    double lateness = currentTime() - m_scheduledFrameTime;
+    unsigned droppedFrames = static_cast<unsigned>(floor(lateness / m_frameInterval));
+    IMDWebCustomDelegate* delegate = m_webView->customDelegate();
+    if (droppedFrames && delegate)
+        delegate->paintFramesDropped(m_webView, droppedFrames, static_cast<unsigned>(lateness * 1000));
+}
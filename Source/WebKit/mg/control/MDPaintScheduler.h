@@ -0,0 +1,57 @@
+/*
+ ** $Id$
+ **
+ ** MDPaintScheduler.h: paces the repaints of MDWebView to a frame rate.
+ **
+ ** Copyright (C) 2003 ~ 2010 Beijing Feynman Software Technology Co., Ltd.
+ **
+ ** All rights reserved by Feynman Software.
+ */
+
+#ifndef MDPaintScheduler_h
+#define MDPaintScheduler_h
+
+#include "minigui.h"
+
+#include "IntRect.h"
+#include "Timer.h"
+#include <wtf/Noncopyable.h>
+
+class MDWebView;
+
+// Collects the invalidations of a view and hands them to the window at
+// most once per frame, so that a page which invalidates far more often
+// than the target frame rate still lays out and updates its backing store
+// once per frame. Frames which start late, or take longer than one frame
+// to paint, are reported to the custom delegate of the view.
+class MDPaintScheduler {
+    WTF_MAKE_NONCOPYABLE(MDPaintScheduler);
+public:
+    MDPaintScheduler(MDWebView*, int framesPerSecond);
+    ~MDPaintScheduler();
+
+    void setFrameRate(int framesPerSecond);
+    int frameRate() const { return m_frameRate; }
+
+    // The window area is invalidated at the next frame.
+    void invalidate(const WebCore::IntRect& windowRect);
+    // The backing store is brought up to date at the next frame.
+    void scheduleFrame();
+
+    // Invalidates what is still pending right away.
+    void flush();
+
+private:
+    void frameTimerFired(WebCore::Timer<MDPaintScheduler>*);
+    void invalidatePendingRegion();
+
+    MDWebView* m_webView;
+    int m_frameRate;
+    double m_frameInterval;
+    double m_lastFrameTime;
+    double m_scheduledFrameTime;
+    PCLIPRGN m_pendingRegion;
+    WebCore::Timer<MDPaintScheduler> m_frameTimer;
+};
+
+#endif // MDPaintScheduler_h
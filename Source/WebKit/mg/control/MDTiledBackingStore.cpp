@@ -0,0 +1,307 @@
+/*
+ ** $Id$
+ **
+ ** MDTiledBackingStore.cpp: the tiled backing store of MDWebView.
+ **
+ ** Copyright (C) 2003 ~ 2010 Beijing Feynman Software Technology Co., Ltd.
+ **
+ ** All rights reserved by Feynman Software.
+ */
+
+#include "minigui.h"
+
+#include "config.h"
+#include "MDTiledBackingStore.h"
+
+#include "Frame.h"
+#include "GCActivityCallbackMg.h"
+#include "FrameView.h"
+#include "GraphicsContext.h"
+
+#include <stdlib.h>
+
+using namespace WebCore;
+
+static const int tileSize = 256;
+static const unsigned tileBytes = tileSize * tileSize * 4;
+static const unsigned defaultMemoryLimit = 32 * tileBytes;
+
+MDTiledBackingStore::MDTiledBackingStore()
+    : m_memoryLimit(defaultMemoryLimit)
+    , m_useCounter(0)
+    , m_prerenderTimer(this, &MDTiledBackingStore::prerenderTimerFired)
+{
+}
+
+MDTiledBackingStore::~MDTiledBackingStore()
+{
+    setView(0);
+}
+
+void MDTiledBackingStore::setMemoryLimit(unsigned bytes)
+{
+    m_memoryLimit = bytes;
+    evictTiles(m_view ? m_view->visibleContentRect() : IntRect(), 0);
+}
+
+unsigned MDTiledBackingStore::memoryUsage() const
+{
+    return m_tiles.size() * tileBytes;
+}
+
+void MDTiledBackingStore::purge()
+{
+    m_prerenderTimer.stop();
+    evictTiles(m_view ? m_view->visibleContentRect() : IntRect(), m_memoryLimit);
+}
+
+void MDTiledBackingStore::setView(FrameView* view)
+{
+    if (m_view == view)
+        return;
+
+    deleteAllTiles();
+    m_prerenderTimer.stop();
+    m_scrollDirection = IntSize();
+
+    // Repaints outside of the visible area have to reach the tiles too.
+    if (m_view)
+        m_view->setPaintsEntireContents(false);
+    m_view = view;
+    if (m_view)
+        m_view->setPaintsEntireContents(true);
+}
+
+void MDTiledBackingStore::invalidate(const IntRect& contentRect)
+{
+    TileMap::iterator end = m_tiles.end();
+    for (TileMap::iterator it = m_tiles.begin(); it != end; ++it) {
+        IntRect dirtyRect = intersection(tileRect(it->first), contentRect);
+        if (!dirtyRect.isEmpty())
+            it->second->dirtyRect.unite(dirtyRect);
+    }
+    schedulePrerender();
+}
+
+void MDTiledBackingStore::invalidateAll()
+{
+    TileMap::iterator end = m_tiles.end();
+    for (TileMap::iterator it = m_tiles.begin(); it != end; ++it)
+        it->second->dirtyRect = tileRect(it->first);
+    schedulePrerender();
+}
+
+void MDTiledBackingStore::paint(HDC hdc, const IntRect& contentRect, const IntPoint& dstPoint)
+{
+    if (!m_view || contentRect.isEmpty())
+        return;
+
+    IntPoint first = tileCoordinateForPoint(contentRect.location());
+    IntPoint last = tileCoordinateForPoint(IntPoint(contentRect.maxX() - 1, contentRect.maxY() - 1));
+
+    for (int y = first.y(); y <= last.y(); ++y) {
+        for (int x = first.x(); x <= last.x(); ++x) {
+            IntPoint coordinate(x, y);
+            // Tiles needed right now may go over the memory limit.
+            Tile* tile = ensureTile(coordinate, contentRect);
+            if (!tile)
+                continue;
+
+            if (!tile->dirtyRect.isEmpty())
+                renderTile(coordinate, tile);
+            tile->lastUse = ++m_useCounter;
+
+            IntRect rect = tileRect(coordinate);
+            IntRect part = intersection(rect, contentRect);
+            BitBlt(tile->dc, part.x() - rect.x(), part.y() - rect.y(), part.width(), part.height(),
+                    hdc, dstPoint.x() + part.x() - contentRect.x(), dstPoint.y() + part.y() - contentRect.y(), 0);
+        }
+    }
+
+    schedulePrerender();
+}
+
+void MDTiledBackingStore::didScroll(const IntSize& delta)
+{
+    // The contents move against the direction the user scrolls to.
+    int dx = delta.width() < 0 ? 1 : (delta.width() > 0 ? -1 : 0);
+    int dy = delta.height() < 0 ? 1 : (delta.height() > 0 ? -1 : 0);
+    m_scrollDirection = IntSize(dx, dy);
+    schedulePrerender();
+}
+
+IntRect MDTiledBackingStore::tileRect(const IntPoint& coordinate) const
+{
+    return IntRect(coordinate.x() * tileSize, coordinate.y() * tileSize, tileSize, tileSize);
+}
+
+IntPoint MDTiledBackingStore::tileCoordinateForPoint(const IntPoint& point) const
+{
+    int x = point.x() < 0 ? (point.x() - tileSize + 1) / tileSize : point.x() / tileSize;
+    int y = point.y() < 0 ? (point.y() - tileSize + 1) / tileSize : point.y() / tileSize;
+    return IntPoint(x, y);
+}
+
+MDTiledBackingStore::Tile* MDTiledBackingStore::ensureTile(const IntPoint& coordinate, const IntRect& keepRect)
+{
+    TileMap::iterator it = m_tiles.find(coordinate);
+    if (it != m_tiles.end())
+        return it->second;
+
+    evictTiles(keepRect, tileBytes);
+
+    HDC dc = CreateMemDC(tileSize, tileSize, 32, MEMDC_FLAG_HWSURFACE,
+            0x00FF0000, 0x0000FF00, 0x000000FF, 0xFF000000);
+    if (dc == HDC_INVALID)
+        return 0;
+
+    Tile* tile = new Tile;
+    tile->dc = dc;
+    tile->dirtyRect = tileRect(coordinate);
+    tile->lastUse = 0;
+    m_tiles.set(coordinate, tile);
+    return tile;
+}
+
+void MDTiledBackingStore::renderTile(const IntPoint& coordinate, Tile* tile)
+{
+    IntRect rect = tileRect(coordinate);
+    IntRect dirtyRect = tile->dirtyRect;
+    tile->dirtyRect = IntRect();
+
+    HDC dc = tile->dc;
+
+    //Fill rectangle with white brush.
+    gal_pixel oldBrushColor = SetBrushColor(dc, PIXEL_lightwhite);
+    FillBox(dc, dirtyRect.x() - rect.x(), dirtyRect.y() - rect.y(), dirtyRect.width(), dirtyRect.height());
+    SetBrushColor(dc, oldBrushColor);
+
+    if (!m_view->frame() || !m_view->frame()->contentRenderer())
+        return;
+
+    GraphicsContext gc(&dc);
+    gc.save();
+    gc.translate(-rect.x(), -rect.y());
+    gc.clip(dirtyRect);
+    m_view->paintContents(&gc, dirtyRect);
+    gc.restore();
+}
+
+void MDTiledBackingStore::evictTiles(const IntRect& keepRect, unsigned bytesNeeded)
+{
+    while (!m_tiles.isEmpty() && m_tiles.size() * tileBytes + bytesNeeded > m_memoryLimit) {
+        TileMap::iterator oldest = m_tiles.end();
+        TileMap::iterator end = m_tiles.end();
+        for (TileMap::iterator it = m_tiles.begin(); it != end; ++it) {
+            if (tileRect(it->first).intersects(keepRect))
+                continue;
+            if (oldest == end || it->second->lastUse < oldest->second->lastUse)
+                oldest = it;
+        }
+        if (oldest == end)
+            return;
+
+        deleteTile(oldest->second);
+        m_tiles.remove(oldest);
+    }
+}
+
+void MDTiledBackingStore::deleteTile(Tile* tile)
+{
+    DeleteMemDC(tile->dc);
+    delete tile;
+}
+
+void MDTiledBackingStore::deleteAllTiles()
+{
+    TileMap::iterator end = m_tiles.end();
+    for (TileMap::iterator it = m_tiles.begin(); it != end; ++it)
+        deleteTile(it->second);
+    m_tiles.clear();
+}
+
+// Tiles are rendered ahead only once input and painting have been quiet
+// for a while, the same idle signal the idle garbage collection waits for.
+void MDTiledBackingStore::schedulePrerender()
+{
+    if (m_view && !m_prerenderTimer.isActive())
+        m_prerenderTimer.startOneShot(GCActivityCallbackMg::timeUntilIdle());
+}
+
+// Renders one tile per run, so that input is still handled in between.
+void MDTiledBackingStore::prerenderTimerFired(Timer<MDTiledBackingStore>*)
+{
+    if (!m_view || !m_view->frame() || !m_view->frame()->contentRenderer())
+        return;
+
+    double delay = GCActivityCallbackMg::timeUntilIdle();
+    if (delay > 0) {
+        m_prerenderTimer.startOneShot(delay);
+        return;
+    }
+
+    m_view->updateLayoutAndStyleIfNeededRecursive();
+    if (m_view->needsLayout())
+        return;
+
+    IntRect visibleRect = m_view->visibleContentRect();
+    if (visibleRect.isEmpty())
+        return;
+
+    // One viewport ahead in the direction of the last scroll, or half a
+    // viewport above and below before the user has scrolled.
+    IntRect wantedRect = visibleRect;
+    if (m_scrollDirection.isZero())
+        wantedRect.inflateY(visibleRect.height() / 2);
+    else {
+        IntRect aheadRect = visibleRect;
+        aheadRect.move(m_scrollDirection.width() * visibleRect.width(), m_scrollDirection.height() * visibleRect.height());
+        wantedRect.unite(aheadRect);
+    }
+    wantedRect.intersect(IntRect(IntPoint(), m_view->contentsSize()));
+    if (wantedRect.isEmpty())
+        return;
+
+    // Visible tiles come first, then the ones closest to the visible area.
+    IntPoint visibleCenter = visibleRect.center();
+    IntPoint first = tileCoordinateForPoint(wantedRect.location());
+    IntPoint last = tileCoordinateForPoint(IntPoint(wantedRect.maxX() - 1, wantedRect.maxY() - 1));
+    bool found = false;
+    bool foundVisible = false;
+    int bestDistance = 0;
+    IntPoint best;
+    for (int y = first.y(); y <= last.y(); ++y) {
+        for (int x = first.x(); x <= last.x(); ++x) {
+            IntPoint coordinate(x, y);
+            TileMap::iterator it = m_tiles.find(coordinate);
+            if (it != m_tiles.end() && it->second->dirtyRect.isEmpty())
+                continue;
+
+            IntRect rect = tileRect(coordinate);
+            bool visible = rect.intersects(visibleRect);
+            IntSize offset = rect.center() - visibleCenter;
+            int distance = abs(offset.width()) + abs(offset.height());
+            if (!found || (visible && !foundVisible) || (visible == foundVisible && distance < bestDistance)) {
+                found = true;
+                foundVisible = visible;
+                bestDistance = distance;
+                best = coordinate;
+            }
+        }
+    }
+    if (!found)
+        return;
+
+    if (!m_tiles.contains(best)) {
+        evictTiles(wantedRect, tileBytes);
+        if (m_tiles.size() * tileBytes + tileBytes > m_memoryLimit)
+            return;
+    }
+
+    Tile* tile = ensureTile(best, wantedRect);
+    if (!tile)
+        return;
+    renderTile(best, tile);
+
+    schedulePrerender();
+}
@@ -0,0 +1,86 @@
+/*
+ ** $Id$
+ **
+ ** MDTiledBackingStore.h: the tiled backing store of MDWebView.
+ **
+ ** Copyright (C) 2003 ~ 2010 Beijing Feynman Software Technology Co., Ltd.
+ **
+ ** All rights reserved by Feynman Software.
+ */
+
+#ifndef MDTiledBackingStore_h
+#define MDTiledBackingStore_h
+
+#include "minigui.h"
+
+#include "IntPointHash.h"
+#include "IntRect.h"
+#include "Timer.h"
+#include <wtf/HashMap.h>
+#include <wtf/Noncopyable.h>
+#include <wtf/RefPtr.h>
+
+namespace WebCore {
+class FrameView;
+}
+
+// Keeps the rendered document of the main frame in fixed size tiles, so
+// that scrolling only copies pixels out of tiles that were rendered
+// before. Tiles live in document coordinates and are dropped least
+// recently used first once the memory limit is reached. While the view is
+// idle, the tiles ahead of the scroll direction are rendered in advance.
+class MDTiledBackingStore {
+    WTF_MAKE_NONCOPYABLE(MDTiledBackingStore);
+public:
+    MDTiledBackingStore();
+    ~MDTiledBackingStore();
+
+    void setMemoryLimit(unsigned bytes);
+    unsigned memoryLimit() const { return m_memoryLimit; }
+    unsigned memoryUsage() const;
+
+    // Drops every tile outside of the visible area.
+    void purge();
+
+    // The tiles hold the contents of view, switching views drops them.
+    void setView(WebCore::FrameView*);
+
+    void invalidate(const WebCore::IntRect& contentRect);
+    void invalidateAll();
+
+    // Copies contentRect to dstPoint of hdc, rendering stale tiles first.
+    // The layout of the view has to be up to date.
+    void paint(HDC hdc, const WebCore::IntRect& contentRect, const WebCore::IntPoint& dstPoint);
+
+    // The visible contents moved by delta, as passed to ChromeClient::scroll().
+    void didScroll(const WebCore::IntSize& delta);
+
+private:
+    struct Tile {
+        HDC dc;
+        WebCore::IntRect dirtyRect; // In document coordinates.
+        unsigned lastUse;
+    };
+
+    WebCore::IntRect tileRect(const WebCore::IntPoint& coordinate) const;
+    WebCore::IntPoint tileCoordinateForPoint(const WebCore::IntPoint&) const;
+
+    Tile* ensureTile(const WebCore::IntPoint& coordinate, const WebCore::IntRect& keepRect);
+    void renderTile(const WebCore::IntPoint& coordinate, Tile*);
+    void evictTiles(const WebCore::IntRect& keepRect, unsigned bytesNeeded);
+    void deleteTile(Tile*);
+    void deleteAllTiles();
+
+    void schedulePrerender();
+    void prerenderTimerFired(WebCore::Timer<MDTiledBackingStore>*);
+
+    typedef HashMap<WebCore::IntPoint, Tile*> TileMap;
+    TileMap m_tiles;
+    RefPtr<WebCore::FrameView> m_view;
+    unsigned m_memoryLimit;
+    unsigned m_useCounter;
+    WebCore::IntSize m_scrollDirection;
+    WebCore::Timer<MDTiledBackingStore> m_prerenderTimer;
+};
+
+#endif // MDTiledBackingStore_h
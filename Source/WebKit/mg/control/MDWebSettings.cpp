@@ -22,6 +22,7 @@
 #include "StringHash.h"
 #include "CString.h"
 #include "FileSystemMg.h"
+#include "ResourceHandleManager.h"
 
 using namespace WTF;
 using namespace WebCore;
@@ -105,6 +106,15 @@ MDWebSettings::PropertyMeta*  MDWebSettings::getPropertyMeta(const char* name, i
         ADD_PROPMETA(allowScriptsToCloseWindows, BoolPropertyMeta, allowScriptsToCloseWindows, setAllowScriptsToCloseWindows);
         ADD_PROPMETA(downloadableBinaryFontsEnabled, BoolPropertyMeta, downloadableBinaryFontsEnabled, setDownloadableBinaryFontsEnabled);
         ADD_PROPMETA(acceleratedCompositingEnabled, BoolPropertyMeta, acceleratedCompositingEnabled, setAcceleratedCompositingEnabled);
+
+        ADD_PROPMETA(maxConnections, IntPropertyMeta, maxConnections, setMaxConnections);
+        ADD_PROPMETA(maxConnectionsPerHost, IntPropertyMeta, maxConnectionsPerHost, setMaxConnectionsPerHost);
+        ADD_PROPMETA(priorityLoadingEnabled, BoolPropertyMeta, priorityLoadingEnabled, setPriorityLoadingEnabled);
+
+        ADD_PROPMETA(tiledBackingStoreEnabled, BoolPropertyMeta, tiledBackingStoreEnabled, setTiledBackingStoreEnabled);
+        ADD_PROPMETA(tiledBackingStoreMemoryLimit, IntPropertyMeta, tiledBackingStoreMemoryLimit, setTiledBackingStoreMemoryLimit);
+        ADD_PROPMETA(paintFrameRate, IntPropertyMeta, paintFrameRate, setPaintFrameRate);
+        ADD_PROPMETA(memoryBudget, IntPropertyMeta, memoryBudget, setMemoryBudget);
         
 
         //....
@@ -130,6 +140,81 @@ void MDWebSettings::updateWebView() {
         m_webView->reload();
 }
 
+// the connection limits live in the network layer and apply to all views
+void MDWebSettings::setMaxConnections(int maxConnections)
+{
+    ResourceHandleManager::sharedInstance()->setMaxConnections(maxConnections);
+}
+
+int MDWebSettings::maxConnections() const
+{
+    return ResourceHandleManager::sharedInstance()->maxConnections();
+}
+
+void MDWebSettings::setMaxConnectionsPerHost(int maxConnections)
+{
+    ResourceHandleManager::sharedInstance()->setMaxConnectionsPerHost(maxConnections);
+}
+
+int MDWebSettings::maxConnectionsPerHost() const
+{
+    return ResourceHandleManager::sharedInstance()->maxConnectionsPerHost();
+}
+
+void MDWebSettings::setPriorityLoadingEnabled(bool enabled)
+{
+    ResourceHandleManager::sharedInstance()->setPriorityLoadingEnabled(enabled);
+}
+
+bool MDWebSettings::priorityLoadingEnabled() const
+{
+    return ResourceHandleManager::sharedInstance()->priorityLoadingEnabled();
+}
+
+void MDWebSettings::setTiledBackingStoreEnabled(bool enabled)
+{
+    if (m_webView)
+        m_webView->setTiledBackingStoreEnabled(enabled);
+}
+
+bool MDWebSettings::tiledBackingStoreEnabled() const
+{
+    return m_webView && m_webView->tiledBackingStoreEnabled();
+}
+
+void MDWebSettings::setTiledBackingStoreMemoryLimit(int kbytes)
+{
+    if (m_webView)
+        m_webView->setTiledBackingStoreMemoryLimit(kbytes);
+}
+
+int MDWebSettings::tiledBackingStoreMemoryLimit() const
+{
+    return m_webView ? m_webView->tiledBackingStoreMemoryLimit() : 0;
+}
+
+void MDWebSettings::setPaintFrameRate(int framesPerSecond)
+{
+    if (m_webView)
+        m_webView->setPaintFrameRate(framesPerSecond);
+}
+
+int MDWebSettings::paintFrameRate() const
+{
+    return m_webView ? m_webView->paintFrameRate() : 0;
+}
+
+void MDWebSettings::setMemoryBudget(int kbytes)
+{
+    if (m_webView)
+        m_webView->setMemoryBudget(kbytes);
+}
+
+int MDWebSettings::memoryBudget() const
+{
+    return m_webView ? m_webView->memoryBudget() : 0;
+}
+
 void MDWebSettings::setValue(const char* name, int ival)
 {
     MDWebSettings::IntPropertyMeta* pm = (MDWebSettings::IntPropertyMeta*)getPropertyMeta(name, PT_INT);
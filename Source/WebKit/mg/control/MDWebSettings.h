@@ -162,6 +162,21 @@ public:
     BOOL_PROP_DEFINE(allowScriptsToCloseWindows, setAllowScriptsToCloseWindows)
     BOOL_PROP_DEFINE(downloadableBinaryFontsEnabled, setDownloadableBinaryFontsEnabled)
     BOOL_PROP_DEFINE(acceleratedCompositingEnabled, setAcceleratedCompositingEnabled)
+
+    void setMaxConnections(int);
+    int maxConnections() const;
+    void setMaxConnectionsPerHost(int);
+    int maxConnectionsPerHost() const;
+    void setPriorityLoadingEnabled(bool);
+    bool priorityLoadingEnabled() const;
+    void setTiledBackingStoreEnabled(bool);
+    bool tiledBackingStoreEnabled() const;
+    void setTiledBackingStoreMemoryLimit(int);
+    int tiledBackingStoreMemoryLimit() const;
+    void setPaintFrameRate(int);
+    int paintFrameRate() const;
+    void setMemoryBudget(int);
+    int memoryBudget() const;
     
     
 
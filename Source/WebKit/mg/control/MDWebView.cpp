@@ -19,6 +19,9 @@
 #include "MDWebView.h"
 #include "MDWebFrame.h"
 #include "MDWebSettings.h"
+#include "MDTiledBackingStore.h"
+#include "MDPaintScheduler.h"
+#include "MDMemoryGovernor.h"
 
 #include "Frame.h"
 #include "FrameTree.h"
@@ -65,6 +68,7 @@
 #include "DragClientMg.h"
 #include "InspectorClientMg.h"
 #include "FrameLoaderClientMg.h"
+#include "GCActivityCallbackMg.h"
 #include "BackForwardListImpl.h"
 
 #include "InspectorController.h"
@@ -99,6 +103,8 @@
 #include "DomSerializer.h"
 #include "FileSystem.h"
 
+#include <limits>
+
 #if ENABLE(PLUGIN)
 #include "mg/PluginApiMg.h"
 #endif
@@ -338,6 +344,10 @@ void MDWebView::loadFinished()
         InvalidateRect(hwnd, NULL, FALSE);
     }
     //added by huangsh end 2011.4.27
+
+    // A finished load has usually decoded its images and run its scripts.
+    if (m_memoryGovernor)
+        m_memoryGovernor->checkSoon();
 }
 
 bool MDWebView::isLoading()
@@ -1098,12 +1108,55 @@ static void OffsetUpdateRegion(PCLIPRGN region,
 
 }
 
-static void getUpdateRects(PCLIPRGN pRgn, Vector<WebCore::IntRect>& rects)
+// Same heuristic as the other ports: too many rects, or rects which
+// cover most of their union, are painted as the union in one go.
+static const int cRectThreshold = 10;
+static const float cWastedSpaceThreshold = 0.75f;
+// Neighbouring rects of a region are blitted as one while their union
+// wastes no more than this part of it.
+static const float cMergedSpaceThreshold = 0.25f;
+
+static float rectArea(const IntRect& rect)
 {
-    PCLIPRECT pClipRect = pRgn->head;
-    while (pClipRect) {
-        rects.append(pClipRect->rc);
-        pClipRect = pClipRect->next;
+    return static_cast<float>(rect.width()) * rect.height();
+}
+
+static void getUpdateRects(PCLIPRGN pRgn, Vector<IntRect, cRectThreshold>& rects)
+{
+    IntRect boundingRect;
+    float singlePixels = 0;
+    int rectCount = 0;
+    for (PCLIPRECT pClipRect = pRgn->head; pClipRect; pClipRect = pClipRect->next) {
+        IntRect rect(pClipRect->rc);
+        // OffsetUpdateRegion leaves emptied rects behind
+        if (rect.isEmpty())
+            continue;
+
+        rectCount++;
+        singlePixels += rectArea(rect);
+        boundingRect.unite(rect);
+
+        // The rects of a region never overlap, what their union has
+        // on top of both is wasted.
+        if (!rects.isEmpty()) {
+            IntRect merged = rects.last();
+            merged.unite(rect);
+            float wastedPixels = rectArea(merged) - rectArea(rects.last()) - rectArea(rect);
+            if (wastedPixels <= cMergedSpaceThreshold * rectArea(merged)) {
+                rects.last() = merged;
+                continue;
+            }
+        }
+        rects.append(rect);
+    }
+
+    if (rects.size() <= 1)
+        return;
+
+    float wastedSpace = 1 - (singlePixels / rectArea(boundingRect));
+    if (rectCount > cRectThreshold || wastedSpace <= cWastedSpaceThreshold) {
+        rects.shrink(0);
+        rects.append(boundingRect);
     }
 }
 
@@ -1185,8 +1238,9 @@ void MDWebView::paint(void)
     updateBackingStore(frameView, backingStoreCompletelyDirty);
 
     // Apply the same heuristic for this update region too.
-    PCLIPRGN pClipRgn = CreateClipRgn();
-    Vector<IntRect> blitRects;
+    if (!m_paintClipRegion)
+        m_paintClipRegion = CreateClipRgn();
+    Vector<IntRect, cRectThreshold> blitRects;
     HDC hdc = BeginPaint(m_viewWindow);
  
     //added by huangsh begin 2011.4.27 
@@ -1225,13 +1279,13 @@ void MDWebView::paint(void)
     }
 #endif
 
-    GetClipRegion(hdc, pClipRgn);
-    if (pClipRgn->type != NULLREGION)
-        getUpdateRects(pClipRgn, blitRects);
+    GetClipRegion(hdc, m_paintClipRegion);
+    if (m_paintClipRegion->type != NULLREGION)
+        getUpdateRects(m_paintClipRegion, blitRects);
     else
         blitRects.append(IntRect(rcPaint));
 
-    DestroyClipRgn(pClipRgn);
+    EmptyClipRgn(m_paintClipRegion);
 
     //modify by huangsh begin 2011.4.27
     if (!settings->areShowAllAtOnceEnabled()) {
@@ -1330,23 +1384,29 @@ void MDWebView::addToDirtyRegion(const IntRect& dirtyRect)
     if (!m_backingStoreDirtyRegion)
         m_backingStoreDirtyRegion = CreateClipRgn();
 
-    if (m_backingStoreDirtyRegion)
-        AddClipRect(m_backingStoreDirtyRegion, &newRect);
+    if (!m_backingStoreDirtyRegion || !AddClipRect(m_backingStoreDirtyRegion, &newRect))
+        return;
 
+    // Many small invalidations between two paints, e.g. from script
+    // animations, end up painted as their union anyway. Collapsing the
+    // region early keeps adding to it cheap.
+    int rectCount = 0;
+    for (PCLIPRECT pClipRect = m_backingStoreDirtyRegion->head; pClipRect; pClipRect = pClipRect->next) {
+        if (++rectCount > cRectThreshold) {
+            RECT bound = m_backingStoreDirtyRegion->rcBound;
+            SetClipRgn(m_backingStoreDirtyRegion, &bound);
+            break;
+        }
+    }
 }
 
 void MDWebView::addToDirtyRegion(PCLIPRGN newRegion)
 {
-    if (m_backingStoreDirtyRegion) {
-        PCLIPRGN combinedRegion = CreateClipRgn();
-
-        UnionRegion(combinedRegion, m_backingStoreDirtyRegion, newRegion);
-        DestroyClipRgn(m_backingStoreDirtyRegion);
-
-        m_backingStoreDirtyRegion = combinedRegion;
-    } else {
-        m_backingStoreDirtyRegion = CreateClipRgn();
-        ClipRgnCopy(m_backingStoreDirtyRegion, newRegion);
+    // Adding the rects in place reuses the dirty region instead of
+    // building a new one for every union.
+    for (PCLIPRECT pClipRect = newRegion->head; pClipRect; pClipRect = pClipRect->next) {
+        if (!IsRectEmpty(&pClipRect->rc))
+            addToDirtyRegion(IntRect(pClipRect->rc));
     }
 
     /*  
@@ -1358,6 +1418,9 @@ void MDWebView::addToDirtyRegion(PCLIPRGN newRegion)
 void MDWebView::scrollBackingStore(FrameView* frameView, int dx, int dy, 
         const IntRect& scrollViewRect, const IntRect& clipRect)
 {
+    if (m_tiledBackingStore)
+        m_tiledBackingStore->didScroll(IntSize(dx, dy));
+
     // If there's no backing store we don't need to update it
     if (!m_backingStoreMemDC) {
         /*  
@@ -1366,7 +1429,9 @@ void MDWebView::scrollBackingStore(FrameView* frameView, int dx, int dy,
         return;
     }
 
-    PCLIPRGN updateRegion = CreateClipRgn();
+    if (!m_scrollUpdateRegion)
+        m_scrollUpdateRegion = CreateClipRgn();
+    PCLIPRGN updateRegion = m_scrollUpdateRegion;
     RECT scrollRectWin(scrollViewRect);
     RECT clipRectWin(clipRect);
 
@@ -1381,13 +1446,14 @@ void MDWebView::scrollBackingStore(FrameView* frameView, int dx, int dy,
 
         // Add the dirty region to the backing store's dirty region.
         addToDirtyRegion(updateRegion);
-        DestroyClipRgn(updateRegion);
 
         /*  
             if (m_uiDelegate)
             m_uiDelegate->webViewScrolled(this);*/
 
     }
+    EmptyClipRgn(updateRegion);
+
     // Update the backing store.
     updateBackingStore(frameView, false);
 }
@@ -1408,12 +1474,31 @@ void MDWebView::deleteBackingStore()
 void MDWebView::repaint(const IntRect& windowRect, bool contentChanged, 
         bool immediate, bool repaintContentOnly)
 {
+    // Paced repaints reach the window with the next frame.
+    bool paced = m_paintScheduler && !immediate;
     if (!repaintContentOnly) {
-        RECT rect = windowRect;
-        InvalidateRect(m_viewWindow, &rect, false);
+        if (paced)
+            m_paintScheduler->invalidate(windowRect);
+        else {
+            RECT rect = windowRect;
+            InvalidateRect(m_viewWindow, &rect, false);
+        }
     }
-    if (contentChanged)
+    if (contentChanged && m_tiledBackingStore) {
+        // The view repaints the whole document for the tiles, only the
+        // visible part goes into the window backing store.
+        if (FrameView* view = core(m_mainFrame) ? core(m_mainFrame)->view() : 0)
+            m_tiledBackingStore->invalidate(view->windowToContents(windowRect));
+
+        RECT clientRect;
+        GetClientRect(m_viewWindow, &clientRect);
+        IntRect visibleRect = intersection(windowRect, IntRect(clientRect));
+        if (!visibleRect.isEmpty())
+            addToDirtyRegion(visibleRect);
+    } else if (contentChanged)
         addToDirtyRegion(windowRect);
+    if (paced && contentChanged)
+        m_paintScheduler->scheduleFrame();
     if (immediate) {
         if (repaintContentOnly)
             updateBackingStore(core(m_mainFrame)->view());
@@ -1425,14 +1510,15 @@ void MDWebView::repaint(const IntRect& windowRect, bool contentChanged,
 void MDWebView::updateBackingStore(FrameView* frameView,
         bool backingStoreCompletelyDirty)
 {
-    if (m_backingStoreMemDC && (m_backingStoreDirtyRegion || backingStoreCompletelyDirty)) {
+    bool hasDirtyRegion = m_backingStoreDirtyRegion && !IsEmptyClipRgn(m_backingStoreDirtyRegion);
+    if (m_backingStoreMemDC && (hasDirtyRegion || backingStoreCompletelyDirty)) {
         // Do a layout first so that everything we render to the backing store is always current.
         if (Frame* coreFrame = core(m_mainFrame))
             if (FrameView* view = coreFrame->view())
                 view->updateLayoutAndStyleIfNeededRecursive();
 
-        Vector<IntRect> paintRects;
-        if (!backingStoreCompletelyDirty && m_backingStoreDirtyRegion) {
+        Vector<IntRect, cRectThreshold> paintRects;
+        if (!backingStoreCompletelyDirty && hasDirtyRegion) {
             getUpdateRects(m_backingStoreDirtyRegion, paintRects);
         } else {
             RECT clientRect;
@@ -1471,11 +1557,113 @@ void MDWebView::paintIntoBackingStore(FrameView* frameView,
 
     //frame view painting
     if (frameView && frameView->frame() && frameView->frame()->contentRenderer()) {
-        gc.clip(dirtyRect);
-        frameView->paint(&gc, dirtyRect);
+        if (m_tiledBackingStore) {
+            // Contents are copied out of the tiles, only the scrollbars are painted here.
+            m_tiledBackingStore->setView(frameView);
+            IntRect contentsRect(0, 0, frameView->visibleWidth(), frameView->visibleHeight());
+            IntRect visibleDirtyRect = intersection(dirtyRect, contentsRect);
+            if (!visibleDirtyRect.isEmpty())
+                m_tiledBackingStore->paint(backingStoreDC, 
+                        frameView->windowToContents(visibleDirtyRect), visibleDirtyRect.location());
+            gc.clip(dirtyRect);
+            frameView->paintScrollbars(&gc, dirtyRect);
+        } else {
+            gc.clip(dirtyRect);
+            frameView->paint(&gc, dirtyRect);
+        }
     }
     gc.restore();
 }
+
+// The limits are set in kilobytes and kept in unsigned bytes. The product
+// is taken in size_t and clamped, a large kbytes must not wrap around.
+static unsigned bytesFromKBytes(int kbytes)
+{
+    size_t bytes = static_cast<size_t>(kbytes);
+    if (bytes > std::numeric_limits<unsigned>::max() / 1024)
+        return std::numeric_limits<unsigned>::max();
+    return bytes * 1024;
+}
+
+void MDWebView::setTiledBackingStoreEnabled(bool enabled)
+{
+    if (enabled == tiledBackingStoreEnabled())
+        return;
+
+    if (enabled) {
+        m_tiledBackingStore = new MDTiledBackingStore;
+        m_tiledBackingStore->setMemoryLimit(bytesFromKBytes(m_tiledBackingStoreMemoryLimit));
+    } else {
+        delete m_tiledBackingStore;
+        m_tiledBackingStore = 0;
+    }
+    invalidateBackingStore(0);
+}
+
+void MDWebView::setPaintFrameRate(int framesPerSecond)
+{
+    if (framesPerSecond < 0)
+        framesPerSecond = 0;
+    m_paintFrameRate = framesPerSecond;
+
+    if (!framesPerSecond) {
+        if (m_paintScheduler) {
+            m_paintScheduler->flush();
+            delete m_paintScheduler;
+            m_paintScheduler = 0;
+        }
+    } else if (m_paintScheduler)
+        m_paintScheduler->setFrameRate(framesPerSecond);
+    else
+        m_paintScheduler = new MDPaintScheduler(this, framesPerSecond);
+}
+
+void MDWebView::setMemoryBudget(int kbytes)
+{
+    if (kbytes < 0)
+        kbytes = 0;
+    m_memoryBudget = kbytes;
+
+    if (!kbytes) {
+        delete m_memoryGovernor;
+        m_memoryGovernor = 0;
+    } else if (m_memoryGovernor)
+        m_memoryGovernor->setBudget(bytesFromKBytes(kbytes));
+    else
+        m_memoryGovernor = new MDMemoryGovernor(this, bytesFromKBytes(kbytes));
+}
+
+unsigned MDWebView::backingStoreMemoryUsage() const
+{
+    unsigned bytes = 0;
+    if (m_backingStoreMemDC)
+        bytes = m_backingStoreSize.cx * m_backingStoreSize.cy * GetGDCapability(m_backingStoreMemDC, GDCAP_BPP);
+    if (m_tiledBackingStore)
+        bytes += m_tiledBackingStore->memoryUsage();
+    return bytes;
+}
+
+void MDWebView::purgeTiledBackingStore()
+{
+    if (m_tiledBackingStore)
+        m_tiledBackingStore->purge();
+}
+
+void MDWebView::updateBackingStoreForFrame()
+{
+    Frame* coreFrame = core(m_mainFrame);
+    if (coreFrame && coreFrame->view())
+        updateBackingStore(coreFrame->view());
+}
+
+void MDWebView::setTiledBackingStoreMemoryLimit(int kbytes)
+{
+    if (kbytes < 0)
+        kbytes = 0;
+    m_tiledBackingStoreMemoryLimit = kbytes;
+    if (m_tiledBackingStore)
+        m_tiledBackingStore->setMemoryLimit(bytesFromKBytes(kbytes));
+}
 //END_MDWEBVIEW_PAINT
 
 //START_MDWEBVIEW_CONSTRUCTOR
@@ -1490,6 +1678,14 @@ MDWebView::MDWebView()
     , m_backingStoreMemDC(0)
     , m_paintCount(0)
     , m_backingStoreDirtyRegion(0)
+    , m_paintClipRegion(0)
+    , m_scrollUpdateRegion(0)
+    , m_tiledBackingStore(0)
+    , m_tiledBackingStoreMemoryLimit(8 * 1024)
+    , m_paintScheduler(0)
+    , m_paintFrameRate(0)
+    , m_memoryGovernor(0)
+    , m_memoryBudget(0)
     , m_uiDelegate(0)
     , m_downloadDelegate(0)
     , m_historyDelegate(0)
@@ -1505,11 +1701,18 @@ MDWebView::MDWebView()
 
 MDWebView::~MDWebView()
 {
+    delete m_memoryGovernor;
+    delete m_paintScheduler;
+    delete m_tiledBackingStore;
     deleteBackingStore();
     if (m_backingStoreDirtyRegion) {
         DestroyClipRgn(m_backingStoreDirtyRegion);
         m_backingStoreDirtyRegion = 0;
     }
+    if (m_paintClipRegion)
+        DestroyClipRgn(m_paintClipRegion);
+    if (m_scrollUpdateRegion)
+        DestroyClipRgn(m_scrollUpdateRegion);
 
 
     if (m_page) {
@@ -1718,6 +1921,9 @@ bool MDWebView::registerWebViewWindowClass()
     //init global delegate
     init_global_delegates();
 
+    JSC::Heap* heap = &JSDOMWindow::commonJSGlobalData()->heap;
+    heap->setActivityCallback(GCActivityCallbackMg::create(heap));
+
     WNDCLASS MDViewClass;
     MDViewClass.spClassName = MDOLPHIN_CTRL;
     MDViewClass.dwStyle = WS_NONE;
@@ -1854,6 +2060,10 @@ void MDWebView::dealWithMDMessages(HWND hwnd, WPARAM wParam, LPARAM lParam)
 LRESULT MDWebView::WebViewWndProc(HWND hwnd, unsigned int message, WPARAM wParam, LPARAM lParam)         // gengyue
 {
     MDWebView* view = reinterpret_cast<MDWebView*>(GetWindowAdditionalData2(hwnd));
+    if ((message >= MSG_FIRSTMOUSEMSG && message <= MSG_LASTMOUSEMSG)
+            || (message >= MSG_FIRSTKEYMSG && message <= MSG_LASTKEYMSG))
+        GCActivityCallbackMg::noteActivity();
+
     switch (message){
         case MSG_CREATE:{
                 IncludeWindowExStyle(hwnd, WS_EX_CLIPCHILDREN);
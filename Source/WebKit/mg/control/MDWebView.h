@@ -34,6 +34,9 @@ class KURL;
 
 class MDWebSettings;
 class MDWebInspector;
+class MDTiledBackingStore;
+class MDPaintScheduler;
+class MDMemoryGovernor;
 
 WebCore::Page* core(MDWebView* WebView);
 
@@ -171,6 +174,26 @@ public:
     void repaint(const WebCore::IntRect&, bool contentChanged, 
             bool immediate = false, bool repaintContentOnly = false);
     virtual bool invalidateBackingStore(const RECT*);
+
+    // Renders the document into tiles that are reused while scrolling.
+    void setTiledBackingStoreEnabled(bool);
+    bool tiledBackingStoreEnabled() const { return m_tiledBackingStore; }
+    // In kilobytes.
+    void setTiledBackingStoreMemoryLimit(int);
+    int tiledBackingStoreMemoryLimit() const { return m_tiledBackingStoreMemoryLimit; }
+
+    // Repaints reach the window at most this many times a second, 0 paints
+    // every repaint as it comes.
+    void setPaintFrameRate(int framesPerSecond);
+    int paintFrameRate() const { return m_paintFrameRate; }
+    void updateBackingStoreForFrame();
+
+    // Caches are purged once the memory this view depends on crosses the
+    // budget, in kilobytes. 0 leaves the caches alone.
+    void setMemoryBudget(int);
+    int memoryBudget() const { return m_memoryBudget; }
+    unsigned backingStoreMemoryUsage() const;
+    void purgeTiledBackingStore();
 //save as
 	void  saveas(bool htmlonly,const char* savedName);
     void drawLoadSplash(HDC hdc);
@@ -204,6 +227,15 @@ private:
     SIZE m_backingStoreSize;
     unsigned int m_paintCount;
     PCLIPRGN m_backingStoreDirtyRegion;
+    // reused by every paint and scroll
+    PCLIPRGN m_paintClipRegion;
+    PCLIPRGN m_scrollUpdateRegion;
+    MDTiledBackingStore* m_tiledBackingStore;
+    int m_tiledBackingStoreMemoryLimit;
+    MDPaintScheduler* m_paintScheduler;
+    int m_paintFrameRate;
+    MDMemoryGovernor* m_memoryGovernor;
+    int m_memoryBudget;
     //END_MDWEBVIEW_BACKINGSTORE
 
     //START_MDWEBVIEW_DELEGATE
@@ -66,6 +66,8 @@ BOOL (*MDCB_PROVIDE_CLIENT_CERT) (MD_CERT_DATA **x509, MD_SSL_PKEY **pkey,
 int  (*MDCB_VERIFY_SERVER_CERT) (int result, MD_CERT_DATA *x509);
 #endif
 void (*MDCB_GET_CARET_RECT) (const RECT* caret);
+void (*MDCB_PAINT_FRAMES_DROPPED) (HWND hWnd, unsigned int frames, unsigned int lateMilliseconds);
+BOOL (*MDCB_ALLOW_IDLE_GC) (void);
 }
 
 
@@ -148,6 +150,8 @@ void init_global_delegates()
     MDCB_VERIFY_SERVER_CERT   = NULL;
 #endif
     MDCB_GET_CARET_RECT       = NULL;
+    MDCB_PAINT_FRAMES_DROPPED = NULL;
+    MDCB_ALLOW_IDLE_GC        = NULL;
 
     _defMDWebUIDelegate = MDDefaultWebUIDelegate::createInstance();
     _defMDWebFrameLoadDelegate = MDDefaultWebFrameLoadDelegate::createInstance();
@@ -212,6 +216,8 @@ void set_global_callbacks(const MDCBInfo *cb)
     MDCB_VERIFY_SERVER_CERT   = cb->MDCB_VERIFY_SERVER_CERT;
 #endif
     MDCB_GET_CARET_RECT       = cb->MDCB_GET_CARET_RECT;
+    MDCB_PAINT_FRAMES_DROPPED = cb->MDCB_PAINT_FRAMES_DROPPED;
+    MDCB_ALLOW_IDLE_GC        = cb->MDCB_ALLOW_IDLE_GC;
 }
 
 #if defined(ENABLE_SSL) && ENABLE_SSL
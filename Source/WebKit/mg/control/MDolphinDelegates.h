@@ -54,6 +54,8 @@ extern void (*MDCB_AFTER_DRAWING) (HWND hWnd, HDC hdc, const RECT* pRect);
 extern void (*MDCB_BEFORE_DRAWING) (HWND hWnd, HDC hdc, const RECT* pRect);
 extern BOOL  (*MDCB_SAVE_AS_FILE_DATA) (char *FileName);
 extern void (*MDCB_GET_CARET_RECT) (const RECT* caret);
+extern void (*MDCB_PAINT_FRAMES_DROPPED) (HWND hWnd, unsigned int frames, unsigned int lateMilliseconds);
+extern BOOL (*MDCB_ALLOW_IDLE_GC) (void);
 }
 
 
@@ -32,7 +32,12 @@
 #include "ScrollbarThemeMg.h"
 #include "Language.h"
 #include "MDCommonFunc.h"
+#include "CachedScript.h"
 #include "MemoryCache.h"
+#include "FunctionPreparser.h"
+#include "JSDOMWindow.h"
+#include "KURL.h"
+#include <runtime/JSLock.h>
 #include "ProxyMg.h"
 
 #include "CookieJar.h"
@@ -50,6 +55,19 @@
 using namespace Control;
 using namespace WebCore;
 
+static MDEGCReason toMDGCReason(JSC::GCReason reason)
+{
+    switch (reason) {
+    case JSC::GCReasonAllocation:
+        return MD_GC_REASON_ALLOCATION;
+    case JSC::GCReasonExtraMemoryCost:
+        return MD_GC_REASON_EXTRA_MEMORY;
+    case JSC::GCReasonExplicit:
+        break;
+    }
+    return MD_GC_REASON_EXPLICIT;
+}
+
 #ifdef __cplusplus
 extern "C" {
 #endif /* __cplusplus */
@@ -727,6 +745,61 @@ extern "C" {
         return !memoryCache()->disabled();
     }
 
+    unsigned int mdGetGCEvents (MDGCEvent* events, unsigned int maxEvents)
+    {
+        JSC::JSLock lock(JSC::SilenceAssertionsOnly);
+        const JSC::GCEventLog& log = JSDOMWindow::commonJSGlobalData()->heap.gcEventLog();
+        if (!events)
+            return log.size();
+        return log.copyEvents(events, maxEvents, toMDGCReason);
+    }
+
+    void mdSetPreparsePolicy (MDEPreparsePolicy policy)
+    {
+        functionPreparser().setPolicy(policy == MD_PREPARSE_EVENT_LISTENERS
+            ? FunctionPreparser::PreparseEventListeners : FunctionPreparser::PreparseNothing);
+    }
+
+    MDEPreparsePolicy mdGetPreparsePolicy (void)
+    {
+        return functionPreparser().policy() == FunctionPreparser::PreparseEventListeners
+            ? MD_PREPARSE_EVENT_LISTENERS : MD_PREPARSE_NOTHING;
+    }
+
+    void mdGetParseStatistics (MDParseStatistics* statistics)
+    {
+        if (!statistics)
+            return;
+
+        JSC::JSLock lock(JSC::SilenceAssertionsOnly);
+        const JSC::ParseStatistics& parseStatistics = JSDOMWindow::commonJSGlobalData()->parseStatistics;
+        statistics->fullParses = parseStatistics.fullParses;
+        statistics->lazyReparses = parseStatistics.lazyReparses;
+        statistics->lazyReparsedCharacters = parseStatistics.lazyReparsedCharacters;
+        statistics->functionCacheHits = parseStatistics.functionCacheHits;
+        statistics->cachedFunctions = parseStatistics.cachedFunctions;
+        statistics->preparsedFunctions = functionPreparser().preparsedFunctions();
+    }
+
+    BOOL mdGetScriptParseStatistics (const char* url, MDParseStatistics* statistics)
+    {
+        if (!url || !statistics)
+            return FALSE;
+
+        CachedResource* resource = memoryCache()->resourceInMemoryForURL(KURL(ParsedURLString, url));
+        if (!resource || resource->type() != CachedResource::Script)
+            return FALSE;
+
+        const JSC::ParseStatistics* parseStatistics = static_cast<CachedScript*>(resource)->parseStatistics();
+        statistics->fullParses = parseStatistics->fullParses;
+        statistics->lazyReparses = parseStatistics->lazyReparses;
+        statistics->lazyReparsedCharacters = parseStatistics->lazyReparsedCharacters;
+        statistics->functionCacheHits = parseStatistics->functionCacheHits;
+        statistics->cachedFunctions = parseStatistics->cachedFunctions;
+        statistics->preparsedFunctions = 0;
+        return TRUE;
+    }
+
     BOOL mdIsCookieEnabled(void)
     {
         return (cookiesEnabled((Document *)0) ? TRUE : FALSE);
@@ -754,6 +827,36 @@ extern "C" {
         return UnregisterSchemeHandler(scheme);
     }
 
+    BOOL mdRegisterSchemeResponder(const char *scheme, MDCB_SCHEME_RESPONDER cb, void *param)
+    {
+        return RegisterSchemeResponder(scheme, cb, param);
+    }
+
+    BOOL mdUnregisterSchemeResponder(const char *scheme)
+    {
+        return UnregisterSchemeResponder(scheme);
+    }
+
+    BOOL mdSchemeJobSetResponse(MDHSchemeJob job, const char* mimeType, const char* encoding, long long contentLength)
+    {
+        return setSchemeJobResponse(job, mimeType, encoding, contentLength);
+    }
+
+    BOOL mdSchemeJobAddHeader(MDHSchemeJob job, const char* name, const char* value)
+    {
+        return addSchemeJobHeader(job, name, value);
+    }
+
+    BOOL mdSchemeJobWrite(MDHSchemeJob job, const void* data, size_t length)
+    {
+        return writeSchemeJob(job, static_cast<const char*>(data), length);
+    }
+
+    void mdSchemeJobFinish(MDHSchemeJob job, BOOL success)
+    {
+        finishSchemeJob(job, success);
+    }
+
 #if ENABLE(SSL) && ENABLE(SSLFILE)
     BOOL mdSetCAPath(const char* path)
     {
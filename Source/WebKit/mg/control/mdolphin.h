@@ -1192,6 +1192,106 @@ BOOL mdRegisterSchemeHandler (const char* scheme, MDCB_SCHEME_HANDLER cb, void*
  */
 BOOL mdUnregisterSchemeHandler (const char* scheme);
 
+/**
+ * \var typedef void* MDHSchemeJob
+ * \brief The handle of a load served by a scheme responder.
+ */
+typedef void* MDHSchemeJob;
+
+/** 
+ * \var typedef BOOL (*MDCB_SCHEME_RESPONDER) (MDHSchemeJob job, const char *url, void *param)
+ * \brief The callback function of the scheme responder.
+ *
+ * It is called for every resource loaded with the scheme. The response is
+ * given to the browser through \a job, right away or later on, and
+ * the load ends with mdSchemeJobFinish.
+ *
+ * \param job The handle of the load.
+ * \param url The loaded url with the specified scheme.
+ * \param param The parameter of the callback function.
+ * \return TRUE if the load is served, FALSE to fail it, \a job is not
+ *      valid any more then.
+ */
+typedef BOOL (*MDCB_SCHEME_RESPONDER) (MDHSchemeJob job, const char *url, void *param);
+
+/**
+ * \fn BOOL mdRegisterSchemeResponder (const char* scheme, MDCB_SCHEME_RESPONDER cb, void* param)
+ *
+ * \brief Register a callback function which serves the resources of a new
+ *      protocol, e.g. the pages and images of the user interface kept in memory.
+ *
+ * \param scheme The scheme of protocol.
+ * \param cb The callback of the scheme responder.
+ * \param param The parameter of the callback function.
+ * \return TRUE on success, FALSE on error.
+ *
+ * \sa mdUnregisterSchemeResponder, mdSchemeJobWrite, mdSchemeJobFinish
+ */
+BOOL mdRegisterSchemeResponder (const char* scheme, MDCB_SCHEME_RESPONDER cb, void* param);
+
+/**
+ * \fn BOOL mdUnregisterSchemeResponder (const char* scheme) 
+ *
+ * \brief Unregister the scheme responder of a protocol.
+ * \param scheme The scheme of protocol.
+ * \return TRUE on success, FALSE on error.
+ *
+ * \sa mdRegisterSchemeResponder
+ */
+BOOL mdUnregisterSchemeResponder (const char* scheme);
+
+/**
+ * \fn BOOL mdSchemeJobSetResponse (MDHSchemeJob job, const char* mimeType, const char* encoding, long long contentLength)
+ *
+ * \brief Describe the response of a load, before its data is written.
+ *
+ * \param job The handle of the load.
+ * \param mimeType The MIME type, NULL to guess it from the extension of the url.
+ * \param encoding The text encoding, or NULL.
+ * \param contentLength The length of the data, or -1 if unknown.
+ * \return TRUE on success, FALSE if the load is cancelled or the
+ *      data is already being written.
+ */
+BOOL mdSchemeJobSetResponse (MDHSchemeJob job, const char* mimeType, const char* encoding, long long contentLength);
+
+/**
+ * \fn BOOL mdSchemeJobAddHeader (MDHSchemeJob job, const char* name, const char* value)
+ *
+ * \brief Add a header field to the response of a load, before its data is written.
+ *
+ * \param job The handle of the load.
+ * \param name The name of the header field.
+ * \param value The value of the header field.
+ * \return TRUE on success, FALSE if the load is cancelled or the
+ *      data is already being written.
+ */
+BOOL mdSchemeJobAddHeader (MDHSchemeJob job, const char* name, const char* value);
+
+/**
+ * \fn BOOL mdSchemeJobWrite (MDHSchemeJob job, const void* data, size_t length)
+ *
+ * \brief Give the next chunk of the data of a load to the browser.
+ *
+ * The data is not kept after the call returns.
+ *
+ * \param job The handle of the load.
+ * \param data The chunk of data.
+ * \param length The length of the chunk.
+ * \return TRUE on success, FALSE once the load is cancelled. The job
+ *      still has to be finished with mdSchemeJobFinish then.
+ */
+BOOL mdSchemeJobWrite (MDHSchemeJob job, const void* data, size_t length);
+
+/**
+ * \fn void mdSchemeJobFinish (MDHSchemeJob job, BOOL success)
+ *
+ * \brief End a load. \a job is not valid any more afterwards.
+ *
+ * \param job The handle of the load.
+ * \param success FALSE to report the load as failed.
+ */
+void mdSchemeJobFinish (MDHSchemeJob job, BOOL success);
+
 /** @} end of scheme */
 
 #endif
@@ -1342,6 +1442,147 @@ BOOL mdSetCacheType (MDECache type, const char* path, unsigned size);
 
 /** @} end of cache */
 
+/**
+ * \addtogroup gc
+ * @{
+ */
+
+/**
+ * What started a garbage collection of the JavaScript heap.
+ */
+typedef enum {
+    /** 
+     * The allocations since the previous collection used up the heap.
+     */
+    MD_GC_REASON_ALLOCATION,
+    /** 
+     * Objects reported a lot of memory outside of the heap.
+     */
+    MD_GC_REASON_EXTRA_MEMORY,
+    /** 
+     * The collection was requested, e.g. while the browser was idle.
+     */
+    MD_GC_REASON_EXPLICIT
+} MDEGCReason;
+
+/**
+ * A garbage collection of the JavaScript heap.
+ *
+ * \sa mdGetGCEvents
+ */
+typedef struct _MDGCEvent {
+    /** When the collection started, in seconds since the epoch. */
+    double startTime;
+    /** How long marking took, in seconds. */
+    double markDuration;
+    /** How long sweeping and releasing empty blocks took, in seconds. */
+    double sweepDuration;
+    /** The bytes of the objects in use before the collection. */
+    size_t sizeBefore;
+    /** The bytes of the objects alive after the collection. */
+    size_t sizeAfter;
+    /** The bytes of the heap before the collection. */
+    size_t capacityBefore;
+    /** The bytes of the heap after the collection. */
+    size_t capacityAfter;
+    /** What started the collection. */
+    MDEGCReason reason;
+} MDGCEvent;
+
+/**
+ * \fn unsigned int mdGetGCEvents (MDGCEvent* events, unsigned int maxEvents)
+ * \brief Get the last garbage collections of the JavaScript heap, oldest first.
+ *
+ * \param events The array the collections are copied to, or NULL.
+ * \param maxEvents The number of collections \a events can hold.
+ * \return The number of collections copied, or the number of collections
+ *      kept if \a events is NULL.
+ */
+unsigned int mdGetGCEvents (MDGCEvent* events, unsigned int maxEvents);
+
+/** @} end of gc */
+
+/**
+ * \addtogroup parser
+ * @{
+ */
+
+/**
+ * Which functions are compiled while the browser is idle, before their
+ * first call.
+ */
+typedef enum {
+    /** 
+     * Functions are compiled when they are first called.
+     */
+    MD_PREPARSE_NOTHING,
+    /** 
+     * The functions added as event listeners are compiled while idle, so
+     * that the first event does not wait for its handler to be compiled.
+     */
+    MD_PREPARSE_EVENT_LISTENERS
+} MDEPreparsePolicy;
+
+/**
+ * The work of the JavaScript parser since the browser started.
+ *
+ * \sa mdGetParseStatistics, mdGetScriptParseStatistics
+ */
+typedef struct _MDParseStatistics {
+    /** The number of scripts and eval code parsed as a whole. */
+    unsigned int fullParses;
+    /** The number of function bodies parsed again when they were first called. */
+    unsigned int lazyReparses;
+    /** The length of the function bodies parsed again, in characters. */
+    unsigned int lazyReparsedCharacters;
+    /** The number of function bodies skipped through the cache of their script. */
+    unsigned int functionCacheHits;
+    /** The number of function bodies added to the cache of their script. */
+    unsigned int cachedFunctions;
+    /** The number of functions compiled while idle. */
+    unsigned int preparsedFunctions;
+} MDParseStatistics;
+
+/**
+ * \fn void mdSetPreparsePolicy (MDEPreparsePolicy policy)
+ * \brief Set which functions are compiled while the browser is idle.
+ *
+ * \param policy The policy, MD_PREPARSE_NOTHING by default.
+ */
+void mdSetPreparsePolicy (MDEPreparsePolicy policy);
+
+/**
+ * \fn MDEPreparsePolicy mdGetPreparsePolicy (void)
+ * \brief Get which functions are compiled while the browser is idle.
+ */
+MDEPreparsePolicy mdGetPreparsePolicy (void);
+
+/**
+ * \fn void mdGetParseStatistics (MDParseStatistics* statistics)
+ * \brief Get the counters of the JavaScript parser.
+ *
+ * \param statistics The structure the counters are copied to.
+ */
+void mdGetParseStatistics (MDParseStatistics* statistics);
+
+/**
+ * \fn BOOL mdGetScriptParseStatistics (const char* url, MDParseStatistics* statistics)
+ * \brief Get the counters of the JavaScript parser for one script file.
+ *
+ * The counters add up over every evaluation of the script since it was
+ * loaded into the memory cache. Inline scripts and eval code are only
+ * counted by mdGetParseStatistics.
+ *
+ * \param url The URL of the script.
+ * \param statistics The structure the counters are copied to,
+ *      preparsedFunctions is always 0.
+ *
+ * \return TRUE if the script is in the memory cache, FALSE otherwise.
+ */
+BOOL mdGetScriptParseStatistics (const char* url, MDParseStatistics* statistics);
+
+/** @} end of parser */
+
 
 /* **************old APIs*************************************************** */
 
@@ -1752,6 +1993,27 @@ typedef struct _MDCBInfo {
      */
     void (*MDCB_GET_CARET_RECT) (const RECT* caret);
 
+    /**
+     * \fn void (*MDCB_PAINT_FRAMES_DROPPED) (HWND hWnd, unsigned int frames, unsigned int lateMilliseconds)
+     * \brief The callback function, which is called when painting at the frame rate
+     *        set by the paintFrameRate setting could not keep up.
+     *
+     * \param hWnd The handle of mdolphin.
+     * \param frames The number of frames which were dropped.
+     * \param lateMilliseconds How long after its scheduled time the frame
+     *        was painted.
+     */
+    void (*MDCB_PAINT_FRAMES_DROPPED) (HWND hWnd, unsigned int frames, unsigned int lateMilliseconds);
+
+    /**
+     * \fn BOOL (*MDCB_ALLOW_IDLE_GC) (void)
+     * \brief The callback function, which is called before the JavaScript heap
+     *        is collected while the browser is idle.
+     *
+     * \return FALSE to put the collection off, for example during an animation.
+     */
+    BOOL (*MDCB_ALLOW_IDLE_GC) (void);
+
 } MDCBInfo;
 
 /**
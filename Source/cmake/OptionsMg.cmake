@@ -36,6 +36,9 @@ FIND_PACKAGE(Threads REQUIRED)
 FIND_PACKAGE(JPEG REQUIRED)
 FIND_PACKAGE(PNG REQUIRED)
 FIND_PACKAGE(CURL REQUIRED)
+
+INCLUDE(CheckIncludeFile)
+CHECK_INCLUDE_FILE(sys/timerfd.h HAVE_SYS_TIMERFD_H)
 # -----------------------------------------------------------------------------
 # Prints dependent libraries path 
 # -----------------------------------------------------------------------------
@@ -88,6 +91,7 @@ WEBKIT_FEATURE(ENABLE_MATHML "Enable MathML" DEFAULT OFF)
 WEBKIT_FEATURE(ENABLE_MEDIA_STATISTICS "Enable media statistics" DEFAULT OFF)
 WEBKIT_FEATURE(ENABLE_METER_TAG "Enable HTML5 meter tag" DEFAULT OFF)
 WEBKIT_FEATURE(ENABLE_NETSCAPE_PLUGIN_API "Enable Netscape plugin API" DEFAULT ON)
+WEBKIT_FEATURE(ENABLE_NETWORK_THREAD "Run network transfers on their own thread" DEFAULT OFF)
 #WEBKIT_FEATURE(ENABLE_NOTIFICATIONS "Enable notifications" DEFAULT OFF)
 #WEBKIT_FEATURE(ENABLE_OFFLINE_WEB_APPLICATIONS "Enable offline web applications" DEFAULT OFF)
 #WEBKIT_FEATURE(ENABLE_OPCODE_STATS "Enable Opcode statistics" DEFAULT OFF)
@@ -45,6 +45,7 @@
 #define ENABLE_MEDIA_STATISTICS             @ENABLE_MEDIA_STATISTICS_VALUE@
 #define ENABLE_METER_TAG                    @ENABLE_METER_TAG_VALUE@
 #define ENABLE_NETSCAPE_PLUGIN_API          @ENABLE_NETSCAPE_PLUGIN_API_VALUE@
+#define ENABLE_NETWORK_THREAD               @ENABLE_NETWORK_THREAD_VALUE@
 #define ENABLE_NO_NPTL                      @ENABLE_NO_NPTL_VALUE@
 #define ENABLE_ORIENTATION_EVENTS           @ENABLE_ORIENTATION_EVENTS_VALUE@
 #define ENABLE_PLUGIN                       @ENABLE_PLUGIN_VALUE@
@@ -73,5 +74,6 @@
 
 #cmakedefine ENABLE_FORCE_DOUBLE_ALIGN           1
 #cmakedefine NDEBUG                              1
+#cmakedefine HAVE_SYS_TIMERFD_H                  1
 
 #endif /* MDCONFIG_H */
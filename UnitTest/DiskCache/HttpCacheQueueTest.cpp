@@ -0,0 +1,197 @@
+#include "config.h"
+#include "HttpCacheQueueTest.h"
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "TestAssert.h"
+
+using namespace disk_cache;
+using namespace WTF;
+
+#define TEST_QUEUE_CAPABILITY   (16 * 1024 * 1024L)
+#define TEST_QUEUE_BODY_SIZE    (1024)
+#define TEST_WRITER_TIMEOUT     (10 * 1000)
+
+namespace UnitTest {
+
+static const char testHeader[] = "HTTP/1.1 200 OK\r\nContent-Type: text/plain\r\n\r\n";
+
+static String entryKey(int i)
+{
+    return String::format("http://www.example.com/queue/%d", i);
+}
+
+static PassRefPtr<WebCore::SharedBuffer> entryBody(int i, unsigned size)
+{
+    Vector<char> data(size);
+    for (unsigned j = 0; j < size; j++)
+        data[j] = (char)(i + j);
+    return WebCore::SharedBuffer::adoptVector(data);
+}
+
+static bool sameBody(WebCore::SharedBuffer* body, int i, unsigned size)
+{
+    if (!body || body->size() != size)
+        return false;
+    RefPtr<WebCore::SharedBuffer> expect = entryBody(i, size);
+    return !memcmp(body->data(), expect->data(), size);
+}
+
+HttpCacheQueueTest::HttpCacheQueueTest()
+    : TestBase()
+    , m_pHttpCache(NULL)
+    , m_nCapability(TEST_QUEUE_CAPABILITY)
+{
+    strcpy(m_szPath, HTTPCACHE_QUEUE_PATH);
+}
+
+HttpCacheQueueTest::~HttpCacheQueueTest()
+{
+    memset(m_szPath, 0, sizeof(m_szPath));
+    m_pHttpCache = NULL;
+}
+
+bool HttpCacheQueueTest::testInit(void)
+{
+    DEBUG_OUTPUT("m_szPath:%s", m_szPath);
+    if (access(m_szPath, F_OK))
+        mkdir(m_szPath, S_IRWXU | S_IRGRP | S_IXGRP | S_IROTH);
+
+    m_pHttpCache = new disk_cache::HttpCache(m_nCapability, m_szPath);
+    if (!m_pHttpCache)
+        return false;
+    m_pHttpCache->clearCache();
+    return true;
+}
+
+void HttpCacheQueueTest::testExit(void)
+{
+    if (m_pHttpCache) {
+        m_pHttpCache->resumeWriter();
+        delete m_pHttpCache;
+        m_pHttpCache = NULL;
+    }
+}
+
+bool HttpCacheQueueTest::testExec(void)
+{
+    DEBUG_OUTPUT("Enter");
+    if (!m_pHttpCache)
+        return false;
+
+    bool ok = this->testEntryLimit();
+    ok = this->testReadQueuedEntry() && ok;
+    ok = this->testReadWrittenEntry() && ok;
+    ok = this->testByteLimit() && ok;
+    DEBUG_OUTPUT("Leave");
+    return ok;
+}
+
+// The writer thread is resumed and the queue drained.
+bool HttpCacheQueueTest::waitForWriter(void)
+{
+    m_pHttpCache->resumeWriter();
+    for (int i = 0; i < TEST_WRITER_TIMEOUT / 10; i++) {
+        if (!m_pHttpCache->pendingWriteCount())
+            return true;
+        usleep(10 * 1000);
+    }
+    return false;
+}
+
+bool HttpCacheQueueTest::testEntryLimit(void)
+{
+    m_pHttpCache->suspendWriter();
+
+    bool isok = true;
+    for (size_t i = 0; i < HttpCache::maxPendingWrites; i++) {
+        RefPtr<WebCore::SharedBuffer> body = entryBody(i, TEST_QUEUE_BODY_SIZE);
+        isok = m_pHttpCache->addEntry(entryKey(i), testHeader, body.get()) && isok;
+    }
+    TEST_ASSERT_OK(isok, "HttpCache", "addEntry", "Queue Up To maxPendingWrites OK");
+    TEST_ASSERT_FAIL(isok, "HttpCache", "addEntry", "Queue Up To maxPendingWrites Fail");
+
+    size_t count = m_pHttpCache->pendingWriteCount();
+    TEST_ASSERT_OK(count == HttpCache::maxPendingWrites, "HttpCache", "pendingWriteCount", "All Writes Queued OK");
+    TEST_ASSERT_FAIL(count == HttpCache::maxPendingWrites, "HttpCache", "pendingWriteCount", "All Writes Queued Fail");
+
+    RefPtr<WebCore::SharedBuffer> body = entryBody(HttpCache::maxPendingWrites, TEST_QUEUE_BODY_SIZE);
+    bool added = m_pHttpCache->addEntry(entryKey(HttpCache::maxPendingWrites), testHeader, body.get());
+    TEST_ASSERT_OK(!added, "HttpCache", "addEntry", "Write Beyond maxPendingWrites Dropped");
+    TEST_ASSERT_FAIL(!added, "HttpCache", "addEntry", "Write Beyond maxPendingWrites Queued");
+
+    count = m_pHttpCache->pendingWriteCount();
+    TEST_ASSERT_OK(count == HttpCache::maxPendingWrites, "HttpCache", "pendingWriteCount", "Queue Unchanged OK");
+    TEST_ASSERT_FAIL(count == HttpCache::maxPendingWrites, "HttpCache", "pendingWriteCount", "Queue Unchanged Fail");
+
+    return isok && !added && count == HttpCache::maxPendingWrites;
+}
+
+// The writer is still suspended, the entries only exist in the queue.
+bool HttpCacheQueueTest::testReadQueuedEntry(void)
+{
+    bool isok = true;
+    for (size_t i = 0; i < HttpCache::maxPendingWrites; i += 7) {
+        String header;
+        RefPtr<WebCore::SharedBuffer> body;
+        bool found = m_pHttpCache->readEntry(entryKey(i), header, body);
+        isok = found && header == testHeader && sameBody(body.get(), i, TEST_QUEUE_BODY_SIZE) && isok;
+    }
+    TEST_ASSERT_OK(isok, "HttpCache", "readEntry", "Read Queued Entry OK");
+    TEST_ASSERT_FAIL(isok, "HttpCache", "readEntry", "Read Queued Entry Fail");
+
+    String header;
+    RefPtr<WebCore::SharedBuffer> body;
+    bool found = m_pHttpCache->readEntry(entryKey(HttpCache::maxPendingWrites), header, body);
+    TEST_ASSERT_OK(!found, "HttpCache", "readEntry", "Dropped Entry Not Found OK");
+    TEST_ASSERT_FAIL(!found, "HttpCache", "readEntry", "Dropped Entry Found");
+
+    return isok && !found;
+}
+
+bool HttpCacheQueueTest::testReadWrittenEntry(void)
+{
+    bool drained = waitForWriter();
+    TEST_ASSERT_OK(drained, "HttpCache", "writerThread", "Write Queue Drained OK");
+    TEST_ASSERT_FAIL(drained, "HttpCache", "writerThread", "Write Queue Drained Fail");
+    if (!drained)
+        return false;
+
+    bool isok = true;
+    for (size_t i = 0; i < HttpCache::maxPendingWrites; i += 7) {
+        String header;
+        RefPtr<WebCore::SharedBuffer> body;
+        bool found = m_pHttpCache->readEntry(entryKey(i), header, body);
+        isok = found && header == testHeader && sameBody(body.get(), i, TEST_QUEUE_BODY_SIZE) && isok;
+    }
+    TEST_ASSERT_OK(isok, "HttpCache", "readEntry", "Read Written Entry OK");
+    TEST_ASSERT_FAIL(isok, "HttpCache", "readEntry", "Read Written Entry Fail");
+    return isok;
+}
+
+bool HttpCacheQueueTest::testByteLimit(void)
+{
+    m_pHttpCache->suspendWriter();
+
+    RefPtr<WebCore::SharedBuffer> body = entryBody(0, HttpCache::maxPendingWriteBytes);
+    bool isok = m_pHttpCache->addEntry(entryKey(0), testHeader, body.get(), true);
+    TEST_ASSERT_OK(isok, "HttpCache", "addEntry", "Queue maxPendingWriteBytes OK");
+    TEST_ASSERT_FAIL(isok, "HttpCache", "addEntry", "Queue maxPendingWriteBytes Fail");
+
+    unsigned bytes = m_pHttpCache->pendingWriteBytes();
+    TEST_ASSERT_OK(bytes == HttpCache::maxPendingWriteBytes, "HttpCache", "pendingWriteBytes", "Queued Bytes OK");
+    TEST_ASSERT_FAIL(bytes == HttpCache::maxPendingWriteBytes, "HttpCache", "pendingWriteBytes", "Queued Bytes Fail");
+
+    RefPtr<WebCore::SharedBuffer> extra = entryBody(1, 1);
+    bool added = m_pHttpCache->addEntry(entryKey(1), testHeader, extra.get(), true);
+    TEST_ASSERT_OK(!added, "HttpCache", "addEntry", "Byte Beyond maxPendingWriteBytes Dropped");
+    TEST_ASSERT_FAIL(!added, "HttpCache", "addEntry", "Byte Beyond maxPendingWriteBytes Queued");
+
+    bool drained = waitForWriter();
+    TEST_ASSERT_OK(drained, "HttpCache", "writerThread", "Large Write Drained OK");
+    TEST_ASSERT_FAIL(drained, "HttpCache", "writerThread", "Large Write Drained Fail");
+
+    return isok && !added && bytes == HttpCache::maxPendingWriteBytes && drained;
+}
+
+}
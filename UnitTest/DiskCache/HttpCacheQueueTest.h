@@ -0,0 +1,44 @@
+#ifndef HttpCacheQueueTest_h
+#define HttpCacheQueueTest_h
+#include "TestBase.h"
+#include "HttpCache.h"
+
+#define HTTPCACHE_QUEUE_PATH  "/tmp/httpcache"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+namespace UnitTest {
+
+// Checks the write queue of disk_cache::HttpCache: the limits on queued
+// writes and reading back entries the writer thread has not written yet.
+class HttpCacheQueueTest : public TestBase {
+public:
+        HttpCacheQueueTest();
+        virtual ~HttpCacheQueueTest();
+
+        virtual bool testInit(void);
+        virtual void testExit(void); 
+        virtual bool testExec(void);
+
+private:
+        bool waitForWriter(void);
+        bool testEntryLimit(void);
+        bool testByteLimit(void);
+        bool testReadQueuedEntry(void);
+        bool testReadWrittenEntry(void);
+
+private:
+        disk_cache::HttpCache*  m_pHttpCache;
+        char        m_szPath[DISKCACHE_PATH_MAX];
+        uint32_t    m_nCapability;
+};
+
+}
+
+#ifdef __cplusplus
+}
+#endif
+#endif //HttpCacheQueueTest_h
@@ -2,6 +2,7 @@
 #define DiskCacheClient_h
 #include "TestManager.h"
 #include "DiskCacheBackendTest.h"
+#include "HttpCacheQueueTest.h"
 #include "TestAssert.h"
 
 namespace UnitTest {
@@ -11,11 +12,13 @@ class TestClient {
         TestClient(PFN_CLIENT_CALLBACK_T pfnClientCallback) 
         : m_pTestManager(new TestManager)
         , m_pTestBackend(new DiskCacheBackendTest)
+        , m_pTestHttpCacheQueue(new HttpCacheQueueTest)
         {
             testNotifyClient()->setNotifyCallback(pfnClientCallback);
 
             if (m_pTestManager) {
                 m_pTestManager->addTest(m_pTestBackend);
+                m_pTestManager->addTest(m_pTestHttpCacheQueue);
                 m_pTestManager->testInit();
             }
         }
@@ -30,6 +33,11 @@ class TestClient {
                 m_pTestBackend = NULL;
             }
 
+            if (m_pTestHttpCacheQueue) {
+                delete m_pTestHttpCacheQueue;
+                m_pTestHttpCacheQueue = NULL;
+            }
+
             if (m_pTestManager) {
                 delete m_pTestManager;
                 m_pTestManager = NULL;
@@ -50,6 +58,7 @@ class TestClient {
     private:
         TestBase* m_pTestManager;
         TestBase* m_pTestBackend;
+        TestBase* m_pTestHttpCacheQueue;
 };
 
 }
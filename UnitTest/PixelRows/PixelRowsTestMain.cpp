@@ -0,0 +1,208 @@
+/*
+** $Id$
+**
+** PixelRowsTestMain.cpp: checks the vector row kernels of ImageBufferMg
+**                        against their scalar versions and times them.
+**
+** Copyright (C) 2003 ~ 2011 Beijing Feynman Software Technology Co., Ltd. 
+** 
+** All rights reserved by Feynman Software.
+*/
+
+#include "config.h"
+#include "PixelRowsMg.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+using namespace WebCore;
+
+// Every alpha value paired with every channel value, channels above alpha
+// included: they do not occur in premultiplied data but must still clamp
+// the same way.
+#define TEST_PIXEL_COUNT    (256 * 256)
+
+// Widths the rows are cut into, so every length of vector tail and rows
+// shorter than one vector are covered.
+static const int testWidths[] = { 1, 2, 3, 4, 5, 7, 8, 9, 15, 16, 17, 31, 33, 63, 65, 255, 257, 1021 };
+#define TEST_WIDTH_COUNT    (sizeof(testWidths) / sizeof(testWidths[0]))
+
+#define BENCH_ROW_SIZE      1024
+#define BENCH_ROW_COUNT     20000
+
+static int s_failures = 0;
+
+static void checkSame(const void* expect, const void* real, size_t size, const char* kernel, int width, int offset)
+{
+    if (!memcmp(expect, real, size))
+        return;
+
+    const unsigned char* e = static_cast<const unsigned char*>(expect);
+    const unsigned char* r = static_cast<const unsigned char*>(real);
+    size_t i = 0;
+    while (e[i] == r[i])
+        i++;
+    printf("FAIL %s: width %d, offset %d, byte %u: expected %02x, got %02x\n",
+            kernel, width, offset, (unsigned)i, e[i], r[i]);
+    s_failures++;
+}
+
+static void fillArgb(unsigned* pixels)
+{
+    for (unsigned i = 0; i < TEST_PIXEL_COUNT; i++) {
+        unsigned alpha = i >> 8;
+        unsigned c = i & 0xFF;
+        pixels[i] = alpha << 24 | c << 16 | (255 - c) << 8 | ((c * 7) & 0xFF);
+    }
+}
+
+static void fillRgba(unsigned char* bytes)
+{
+    for (unsigned i = 0; i < TEST_PIXEL_COUNT; i++) {
+        unsigned char c = i & 0xFF;
+        bytes[i * 4] = c;
+        bytes[i * 4 + 1] = 255 - c;
+        bytes[i * 4 + 2] = (c * 7) & 0xFF;
+        bytes[i * 4 + 3] = i >> 8;
+    }
+}
+
+// The vector kernel is run on rows of width pixels starting at offset, so
+// the loads are misaligned for odd offsets, and compared with the scalar
+// kernel run over all the pixels at once.
+static void testWordsToBytes(const char* kernel, void (*vector)(const unsigned*, unsigned char*, int),
+        void (*scalar)(const unsigned*, unsigned char*, int))
+{
+    unsigned* src = new unsigned[TEST_PIXEL_COUNT + 1];
+    unsigned char* expect = new unsigned char[TEST_PIXEL_COUNT * 4];
+    unsigned char* real = new unsigned char[(TEST_PIXEL_COUNT + 1) * 4];
+
+    for (int offset = 0; offset < 2; offset++) {
+        fillArgb(src + offset);
+        scalar(src + offset, expect, TEST_PIXEL_COUNT);
+        for (unsigned w = 0; w < TEST_WIDTH_COUNT; w++) {
+            int width = testWidths[w];
+            memset(real, 0xA5, (TEST_PIXEL_COUNT + 1) * 4);
+            for (int x = 0; x < TEST_PIXEL_COUNT; x += width) {
+                int count = TEST_PIXEL_COUNT - x < width ? TEST_PIXEL_COUNT - x : width;
+                vector(src + offset + x, real + offset * 4 + x * 4, count);
+            }
+            checkSame(expect, real + offset * 4, TEST_PIXEL_COUNT * 4, kernel, width, offset);
+        }
+    }
+
+    delete[] src;
+    delete[] expect;
+    delete[] real;
+}
+
+static void testBytesToWords(const char* kernel, void (*vector)(const unsigned char*, unsigned*, int),
+        void (*scalar)(const unsigned char*, unsigned*, int))
+{
+    unsigned char* src = new unsigned char[(TEST_PIXEL_COUNT + 1) * 4];
+    unsigned* expect = new unsigned[TEST_PIXEL_COUNT];
+    unsigned* real = new unsigned[TEST_PIXEL_COUNT + 1];
+
+    for (int offset = 0; offset < 2; offset++) {
+        fillRgba(src + offset * 4);
+        scalar(src + offset * 4, expect, TEST_PIXEL_COUNT);
+        for (unsigned w = 0; w < TEST_WIDTH_COUNT; w++) {
+            int width = testWidths[w];
+            memset(real, 0xA5, (TEST_PIXEL_COUNT + 1) * sizeof(unsigned));
+            for (int x = 0; x < TEST_PIXEL_COUNT; x += width) {
+                int count = TEST_PIXEL_COUNT - x < width ? TEST_PIXEL_COUNT - x : width;
+                vector(src + offset * 4 + x * 4, real + offset + x, count);
+            }
+            checkSame(expect, real + offset, TEST_PIXEL_COUNT * sizeof(unsigned), kernel, width, offset);
+        }
+    }
+
+    delete[] src;
+    delete[] expect;
+    delete[] real;
+}
+
+static double now()
+{
+    struct timeval tv;
+    gettimeofday(&tv, 0);
+    return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+static void benchWordsToBytes(const char* kernel, void (*vector)(const unsigned*, unsigned char*, int),
+        void (*scalar)(const unsigned*, unsigned char*, int))
+{
+    unsigned* src = new unsigned[TEST_PIXEL_COUNT];
+    unsigned char* dst = new unsigned char[BENCH_ROW_SIZE * 4];
+    fillArgb(src);
+
+    double start = now();
+    for (int i = 0; i < BENCH_ROW_COUNT; i++)
+        scalar(src + (i * BENCH_ROW_SIZE) % (TEST_PIXEL_COUNT - BENCH_ROW_SIZE), dst, BENCH_ROW_SIZE);
+    double scalarTime = now() - start;
+
+    start = now();
+    for (int i = 0; i < BENCH_ROW_COUNT; i++)
+        vector(src + (i * BENCH_ROW_SIZE) % (TEST_PIXEL_COUNT - BENCH_ROW_SIZE), dst, BENCH_ROW_SIZE);
+    double vectorTime = now() - start;
+
+    double pixels = (double)BENCH_ROW_SIZE * BENCH_ROW_COUNT;
+    printf("%-20s scalar %6.2f ns/pixel, vector %6.2f ns/pixel, %4.1fx\n", kernel,
+            scalarTime * 1e9 / pixels, vectorTime * 1e9 / pixels, vectorTime > 0 ? scalarTime / vectorTime : 0);
+
+    delete[] src;
+    delete[] dst;
+}
+
+static void benchBytesToWords(const char* kernel, void (*vector)(const unsigned char*, unsigned*, int),
+        void (*scalar)(const unsigned char*, unsigned*, int))
+{
+    unsigned char* src = new unsigned char[TEST_PIXEL_COUNT * 4];
+    unsigned* dst = new unsigned[BENCH_ROW_SIZE];
+    fillRgba(src);
+
+    double start = now();
+    for (int i = 0; i < BENCH_ROW_COUNT; i++)
+        scalar(src + (i * BENCH_ROW_SIZE) % (TEST_PIXEL_COUNT - BENCH_ROW_SIZE) * 4, dst, BENCH_ROW_SIZE);
+    double scalarTime = now() - start;
+
+    start = now();
+    for (int i = 0; i < BENCH_ROW_COUNT; i++)
+        vector(src + (i * BENCH_ROW_SIZE) % (TEST_PIXEL_COUNT - BENCH_ROW_SIZE) * 4, dst, BENCH_ROW_SIZE);
+    double vectorTime = now() - start;
+
+    double pixels = (double)BENCH_ROW_SIZE * BENCH_ROW_COUNT;
+    printf("%-20s scalar %6.2f ns/pixel, vector %6.2f ns/pixel, %4.1fx\n", kernel,
+            scalarTime * 1e9 / pixels, vectorTime * 1e9 / pixels, vectorTime > 0 ? scalarTime / vectorTime : 0);
+
+    delete[] src;
+    delete[] dst;
+}
+
+int main(int argc, const char* argv[])
+{
+#if defined(__SSE2__)
+    printf("vector kernels: SSE2\n");
+#elif defined(__ARM_NEON__) || defined(__ARM_NEON)
+    printf("vector kernels: NEON\n");
+#else
+    printf("vector kernels: none, the scalar path is compared with itself\n");
+#endif
+
+    testWordsToBytes("unpremultiplyRow", unpremultiplyRow, unpremultiplyRowScalar);
+    testBytesToWords("premultiplyRow", premultiplyRow, premultiplyRowScalar);
+    testWordsToBytes("swizzleRow(ARGB)", swizzleRow, swizzleRowScalar);
+    testBytesToWords("swizzleRow(RGBA)", swizzleRow, swizzleRowScalar);
+
+    if (argc < 2 || strcmp(argv[1], "--no-bench")) {
+        benchWordsToBytes("unpremultiplyRow", unpremultiplyRow, unpremultiplyRowScalar);
+        benchBytesToWords("premultiplyRow", premultiplyRow, premultiplyRowScalar);
+        benchWordsToBytes("swizzleRow(ARGB)", swizzleRow, swizzleRowScalar);
+        benchBytesToWords("swizzleRow(RGBA)", swizzleRow, swizzleRowScalar);
+    }
+
+    printf("%s: %d failure(s)\n", s_failures ? "FAIL" : "PASS", s_failures);
+    return s_failures ? 1 : 0;
+}